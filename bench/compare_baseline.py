@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Compare Google Benchmark results against the stored baseline.
+
+Both files are --benchmark_out JSON reports. The medians (or the plain runs
+when no aggregates were reported) are matched by name. The script fails when
+a benchmark is slower than the baseline by more than the tolerance.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as report:
+        benchmarks = json.load(report)["benchmarks"]
+
+    times = {}
+    for benchmark in benchmarks:
+        if benchmark.get("error_occurred"):
+            continue
+        name = benchmark.get("run_name", benchmark["name"])
+        aggregate = benchmark.get("aggregate_name")
+        if aggregate == "median" or (aggregate is None and name not in times):
+            times[name] = to_ns(benchmark)
+    return times
+
+
+def to_ns(benchmark):
+    scale = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}[benchmark.get("time_unit", "ns")]
+    return benchmark["real_time"] * scale
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("baseline")
+    parser.add_argument("results")
+    parser.add_argument("--tolerance", type=float, default=0.15, help="allowed relative slowdown (default 0.15)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    results = load(args.results)
+
+    regressions = 0
+    for name in sorted(results):
+        if name not in baseline:
+            print(f"{name:60s} {'new':>10s}")
+            continue
+
+        change = results[name] / baseline[name] - 1.0
+        regressed = change > args.tolerance
+        regressions += regressed
+        print(f"{name:60s} {change * 100:+9.1f}%{'  REGRESSION' if regressed else ''}")
+
+    for name in sorted(set(baseline) - set(results)):
+        print(f"{name:60s} {'missing':>10s}")
+
+    if regressions:
+        print(f"{regressions} benchmark(s) slower than the baseline by more than {args.tolerance * 100:.0f}%")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
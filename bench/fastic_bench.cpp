@@ -0,0 +1,688 @@
+/*
+    Benchmarks of the receive pipeline
+
+    The streams are synthesized by captureSynthesizer with a whole number of 16 frame periods
+    (33 words), so a buffer can be replayed back to back without breaking the framing.
+    The bitslip variants cover the aligned case, the slip of the sample capture and the widest slip.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+#include "aurora.hpp"
+#include "fastic.hpp"
+#include "event_batch.hpp"
+#include "event_filter.hpp"
+#include "histogram.hpp"
+#include "buffer_pool.hpp"
+#include "multi_rx.hpp"
+#include "tx.hpp"
+#include "stream_reader.hpp"
+#include "parallel_rx.hpp"
+#include "capture.hpp"
+#include "sample_databuff.hpp"
+
+namespace{
+    //Raw words of a synthesized stream of the given number of frames
+    std::vector<std::uint32_t> makeStream(std::size_t frames, std::uint8_t bitSlip, std::uint64_t seed = 1){
+        fastic::captureSynthesizer::config config;
+        config.bitSlip = bitSlip;
+        config.seed = seed;
+
+        fastic::captureSynthesizer synthesizer(config);
+        std::vector<std::uint32_t> words;
+        synthesizer.generate(frames, words);
+        synthesizer.finish(words);
+        return words;
+    }
+
+    //Descrambled event words of a synthesized stream
+    std::vector<std::uint64_t> makeEvents(std::size_t count){
+        fastic::captureSynthesizer::config config;
+        config.extensionInterval = 0xFFFFFFFF;
+
+        fastic::captureSynthesizer synthesizer(config);
+        std::vector<std::uint32_t> words;
+        std::vector<std::uint64_t> payloads;
+        synthesizer.generate(count + 1, words, &payloads);
+        payloads.erase(payloads.begin());
+        return payloads;
+    }
+
+    std::vector<std::uint64_t> makeRandomWords(std::size_t count){
+        std::vector<std::uint64_t> words(count);
+        std::uint64_t state = 0x9E3779B97F4A7C15;
+        for(std::uint64_t & word : words){
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            word = state;
+        }
+        return words;
+    }
+
+    //The scalar search rx::synchronize did before the bit-sliced scoring: bitslips 0 - 63 one after another,
+    //each needing its first 5 headers valid, kept as the reference of BM_synchronize
+    bool synchronizeReference(aurora::rx & receiver){
+        for(std::uint8_t bitSlip = 0; bitSlip < 64; bitSlip++){
+            receiver.forceBitSlip(bitSlip);
+            if(receiver.hasValidSync(0) && receiver.hasValidSync(1) && receiver.hasValidSync(2) && receiver.hasValidSync(3) && receiver.hasValidSync(4)){
+                int validPacketCounter = 5;
+                for(int packetIndex = 5; packetIndex < receiver.syncErrorSampleSize_; packetIndex++){
+                    if(receiver.hasValidSync(packetIndex)){
+                        validPacketCounter++;
+                        if(validPacketCounter >= receiver.syncErrorTreshold_){
+                            receiver.bitSlip_ = bitSlip;
+                            receiver.synced_ = true;
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+
+    //The frame loop rx::decodeFrames ran before the block descrambler: the same lock window and counts, every payload
+    //descrambled on its own by the scalar path. A clean stream never relocks, kept as the reference of BM_processRxBufferSink
+    template<typename Sink>
+    std::uint64_t processRxBufferReference(const std::uint32_t * words, std::size_t size, std::uint8_t bitSlip, Sink && sink){
+        aurora::framePeriodUnpacker unpacker = aurora::framePeriodUnpackers[bitSlip % 32];
+        aurora::decodeCounts counts;
+        std::size_t position = bitSlip;
+        int lockErrors = 0;
+        std::uint64_t lockHistory = 0;
+        std::uint64_t previousData = 0;
+        bool hasPreviousData = false;
+
+        std::uint8_t syncBits[aurora::periodFrames];
+        std::uint64_t scrambledData[aurora::periodFrames];
+        while((position / 32 + aurora::periodReadWords) * 32 <= size * 32){
+            unpacker(words + position / 32, syncBits, scrambledData);
+            for(std::size_t idx = 0; idx < aurora::periodFrames; idx++){
+                std::uint8_t header = syncBits[idx];
+                bool invalidHeader = (header == 0b00 || header == 0b11);
+                lockErrors += (int)invalidHeader - (int)(lockHistory >> 63);
+                lockHistory = (lockHistory << 1) | invalidHeader;
+
+                if(header == 0b01){
+                    counts.dataFrames++;
+                }else if(header == 0b10){
+                    counts.controlFrames++;
+                }else{
+                    counts.headerErrors++;
+                }
+
+                if(hasPreviousData){
+                    std::uint64_t data = scrambledData[idx];
+                    aurora::rx::descramblePacketData(data, previousData);
+                    if(header == 0b10) counts.blockTypes[aurora::rxMetrics::blockTypeIndex(data >> 56)]++;
+                    sink(header, data);
+                }
+
+                previousData = scrambledData[idx];
+                hasPreviousData = true;
+                position += 66;
+                counts.frames++;
+            }
+        }
+
+        return counts.frames + counts.headerErrors + (std::uint64_t)lockErrors;
+    }
+
+    void bitSlipArguments(benchmark::internal::Benchmark * benchmark){
+        for(int bitSlip : {0, 26, 65}) benchmark->Arg(bitSlip);
+    }
+
+    void bufferArguments(benchmark::internal::Benchmark * benchmark){
+        for(int frames : {1024, 16384, 262144}){
+            for(int bitSlip : {0, 26, 65}) benchmark->Args({frames, bitSlip});
+        }
+    }
+}
+
+static void BM_getSyncBits(benchmark::State & state){
+    const std::size_t frames = 16384;
+    std::vector<std::uint32_t> words = makeStream(frames, state.range(0));
+    aurora::rx receiver(words.data(), words.size());
+    receiver.forceBitSlip(state.range(0));
+
+    for(auto _ : state){
+        std::uint32_t sum = 0;
+        for(std::size_t idx = 0; idx < frames; idx++) sum += receiver.getSyncBits(idx);
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * frames);
+}
+BENCHMARK(BM_getSyncBits)->Apply(bitSlipArguments);
+
+static void BM_getPacketData(benchmark::State & state){
+    const std::size_t frames = 16384;
+    std::vector<std::uint32_t> words = makeStream(frames, state.range(0));
+    aurora::rx receiver(words.data(), words.size());
+    receiver.forceBitSlip(state.range(0));
+
+    for(auto _ : state){
+        std::uint64_t sum = 0;
+        for(std::size_t idx = 0; idx < frames; idx++) sum ^= receiver.getPacketData(idx);
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * frames);
+}
+BENCHMARK(BM_getPacketData)->Apply(bitSlipArguments);
+
+static void BM_unpackGeneric(benchmark::State & state){
+    //Frame by frame extraction with the positions computed at run time
+    const std::size_t frames = 16384;
+    std::vector<std::uint32_t> words = makeStream(frames, state.range(0));
+
+    for(auto _ : state){
+        std::uint64_t sum = 0;
+        for(std::size_t idx = 0; idx + 1 < frames; idx++){
+            std::size_t bitPosition = state.range(0) + 66 * idx;
+            sum += aurora::rx::extractSyncBits(words.data(), bitPosition) ^ aurora::rx::extractPacketData(words.data(), bitPosition);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * (frames - 1));
+}
+BENCHMARK(BM_unpackGeneric)->Apply(bitSlipArguments);
+
+static void BM_unpackFramePeriod(benchmark::State & state){
+    //Whole periods with the unpacker of the phase selected once
+    const std::size_t frames = 16384;
+    std::vector<std::uint32_t> words = makeStream(frames, state.range(0));
+    aurora::framePeriodUnpacker unpacker = aurora::framePeriodUnpackers[state.range(0) % 32];
+    const std::size_t periods = frames / aurora::periodFrames - 1;
+
+    for(auto _ : state){
+        std::uint64_t sum = 0;
+        std::uint8_t syncBits[aurora::periodFrames];
+        std::uint64_t data[aurora::periodFrames];
+        for(std::size_t period = 0; period < periods; period++){
+            unpacker(words.data() + state.range(0) / 32 + period * aurora::periodWords, syncBits, data);
+            for(std::size_t idx = 0; idx < aurora::periodFrames; idx++) sum += syncBits[idx] ^ data[idx];
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * periods * aurora::periodFrames);
+}
+BENCHMARK(BM_unpackFramePeriod)->Apply(bitSlipArguments);
+
+static void BM_descramblePacketData(benchmark::State & state){
+    std::vector<std::uint64_t> scrambled = makeRandomWords(state.range(0) + 1);
+    std::vector<std::uint64_t> data(state.range(0));
+
+    for(auto _ : state){
+        for(std::size_t idx = 0; idx < data.size(); idx++){
+            data[idx] = scrambled[idx + 1];
+            aurora::rx::descramblePacketData(data[idx], scrambled[idx]);
+        }
+        benchmark::DoNotOptimize(data.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * data.size());
+    state.SetBytesProcessed(state.iterations() * data.size() * sizeof(std::uint64_t));
+}
+BENCHMARK(BM_descramblePacketData)->Range(1 << 10, 1 << 16);
+
+static void BM_descramblePacketBlock(benchmark::State & state){
+    std::vector<std::uint64_t> scrambled = makeRandomWords(state.range(0) + 1);
+    std::vector<std::uint64_t> data(state.range(0));
+
+    for(auto _ : state){
+        std::copy(scrambled.begin() + 1, scrambled.end(), data.begin());
+        benchmark::DoNotOptimize(aurora::rx::descramblePacketBlock(data.data(), data.size(), scrambled[0]));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * data.size());
+    state.SetBytesProcessed(state.iterations() * data.size() * sizeof(std::uint64_t));
+}
+BENCHMARK(BM_descramblePacketBlock)->Range(1 << 10, 1 << 16);
+
+static void BM_synchronize(benchmark::State & state){
+    std::vector<std::uint32_t> words = makeStream(4096, state.range(0));
+    aurora::rx receiver(words.data(), words.size());
+
+    for(auto _ : state){
+        receiver.synced_ = false;
+        benchmark::DoNotOptimize(receiver.synchronize());
+    }
+
+    if(receiver.getBitSlip() != state.range(0)) state.SkipWithError("Wrong bitslip acquired");
+}
+BENCHMARK(BM_synchronize)->Apply(bitSlipArguments);
+
+static void BM_synchronizeReference(benchmark::State & state){
+    std::vector<std::uint32_t> words = makeStream(4096, state.range(0));
+    aurora::rx receiver(words.data(), words.size());
+    bool synced = false;
+
+    for(auto _ : state){
+        receiver.synced_ = false;
+        synced = synchronizeReference(receiver);
+        benchmark::DoNotOptimize(synced);
+    }
+
+    //The reference never tries the bitslips 64 and 65, it runs through all the others and fails
+    state.counters["synced"] = synced && receiver.getBitSlip() == state.range(0);
+}
+BENCHMARK(BM_synchronizeReference)->Apply(bitSlipArguments);
+
+static void BM_synchronizeSampleCapture(benchmark::State & state){
+    aurora::rx receiver(auroraData, sizeof(auroraData) / sizeof(auroraData[0]));
+
+    for(auto _ : state){
+        receiver.synced_ = false;
+        benchmark::DoNotOptimize(receiver.synchronize());
+    }
+}
+BENCHMARK(BM_synchronizeSampleCapture);
+
+static void BM_synchronizeReferenceSampleCapture(benchmark::State & state){
+    aurora::rx receiver(auroraData, sizeof(auroraData) / sizeof(auroraData[0]));
+
+    for(auto _ : state){
+        receiver.synced_ = false;
+        benchmark::DoNotOptimize(synchronizeReference(receiver));
+    }
+}
+BENCHMARK(BM_synchronizeReferenceSampleCapture);
+
+static void BM_processRxBuffer(benchmark::State & state){
+    std::vector<std::uint32_t> words = makeStream(state.range(0), state.range(1));
+    aurora::rx receiver(words.data(), words.size());
+    receiver.synchronize();
+
+    for(auto _ : state){
+        receiver.processRxBuffer();
+        benchmark::DoNotOptimize(receiver.getPacketBuffer().data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * words.size() * sizeof(std::uint32_t));
+}
+BENCHMARK(BM_processRxBuffer)->Apply(bufferArguments);
+
+static void BM_processRxBufferSink(benchmark::State & state){
+    std::vector<std::uint32_t> words = makeStream(state.range(0), state.range(1));
+    aurora::rx receiver(words.data(), words.size());
+    receiver.synchronize();
+
+    for(auto _ : state){
+        std::uint64_t sum = 0;
+        receiver.processRxBuffer([&sum](const aurora::packet & packet){ sum ^= packet.data; });
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * words.size() * sizeof(std::uint32_t));
+}
+BENCHMARK(BM_processRxBufferSink)->Apply(bufferArguments);
+
+static void BM_processRxBufferReference(benchmark::State & state){
+    //Same stream and frame work as BM_processRxBufferSink, every payload descrambled by the scalar path
+    std::vector<std::uint32_t> words = makeStream(state.range(0), state.range(1));
+
+    for(auto _ : state){
+        std::uint64_t sum = 0;
+        benchmark::DoNotOptimize(processRxBufferReference(words.data(), words.size(), state.range(1), [&sum](std::uint8_t, std::uint64_t data){ sum ^= data; }));
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * words.size() * sizeof(std::uint32_t));
+}
+BENCHMARK(BM_processRxBufferReference)->Apply(bufferArguments);
+
+static void BM_feed(benchmark::State & state){
+    //The stream is replayed continuously in chunks of the given size
+    const std::size_t frames = 262144;
+    std::vector<std::uint32_t> words = makeStream(frames, 0);
+    const std::size_t chunkWords = state.range(0);
+    aurora::rx receiver(nullptr, 0);
+
+    for(auto _ : state){
+        std::uint64_t sum = 0;
+        for(std::size_t offset = 0; offset < words.size(); offset += chunkWords){
+            receiver.feed(words.data() + offset, std::min(chunkWords, words.size() - offset), [&sum](const aurora::packet & packet){ sum ^= packet.data; });
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * frames);
+    state.SetBytesProcessed(state.iterations() * words.size() * sizeof(std::uint32_t));
+}
+BENCHMARK(BM_feed)->Arg(1000)->Arg(65536);
+
+static void BM_feedPayloads(benchmark::State & state){
+    //Same stream and chunks as BM_feed through the fused path, no packet is built
+    const std::size_t frames = 262144;
+    std::vector<std::uint32_t> words = makeStream(frames, 0);
+    const std::size_t chunkWords = state.range(0);
+    aurora::rx receiver(nullptr, 0);
+
+    for(auto _ : state){
+        std::uint64_t sum = 0;
+        for(std::size_t offset = 0; offset < words.size(); offset += chunkWords){
+            receiver.feedPayloads(words.data() + offset, std::min(chunkWords, words.size() - offset),
+                [&sum](const std::uint64_t * payloads, std::size_t count){ for(std::size_t idx = 0; idx < count; idx++) sum ^= payloads[idx]; },
+                [&sum](const aurora::controlPacket & control){ sum ^= control.getData(); });
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * frames);
+    state.SetBytesProcessed(state.iterations() * words.size() * sizeof(std::uint32_t));
+}
+BENCHMARK(BM_feedPayloads)->Arg(1000)->Arg(65536);
+
+static void BM_feedEventBatch(benchmark::State & state){
+    //Raw words to a decoded event batch, through the packets (0) or the fused path (1)
+    const std::size_t frames = 262144;
+    std::vector<std::uint32_t> words = makeStream(frames, 0);
+    const std::size_t chunkWords = 65536;
+    const bool fused = state.range(0);
+    aurora::rx receiver(nullptr, 0);
+    fastic::eventBatch batch;
+    batch.reserve(frames);
+    std::vector<aurora::packet> packets;
+    std::vector<std::uint64_t> payloads;
+    packets.reserve(frames);
+    payloads.reserve(frames);
+
+    for(auto _ : state){
+        batch.clear();
+        for(std::size_t offset = 0; offset < words.size(); offset += chunkWords){
+            std::size_t size = std::min(chunkWords, words.size() - offset);
+
+            if(fused){
+                receiver.feedPayloads(words.data() + offset, size,
+                    [&batch](const std::uint64_t * data, std::size_t count){ batch.decode(data, count); },
+                    [](const aurora::controlPacket &){});
+            }else{
+                //Packets are collected first and their data words picked afterwards
+                packets.clear();
+                payloads.clear();
+                receiver.feed(words.data() + offset, size, [&packets](const aurora::packet & packet){ packets.push_back(packet); });
+                for(const aurora::packet & packet : packets){
+                    if(packet.type == aurora::packet::type::data) payloads.push_back(aurora::dataPacket(packet).getData());
+                }
+                batch.decode(payloads.data(), payloads.size());
+            }
+        }
+        benchmark::DoNotOptimize(batch.getParityBitmap());
+    }
+
+    state.SetItemsProcessed(state.iterations() * frames);
+    state.SetBytesProcessed(state.iterations() * words.size() * sizeof(std::uint32_t));
+}
+BENCHMARK(BM_feedEventBatch)->Arg(0)->Arg(1);
+
+static void BM_eventPacketDecode(benchmark::State & state){
+    std::vector<std::uint64_t> events = makeEvents(state.range(0));
+
+    for(auto _ : state){
+        std::uint32_t valid = 0;
+        for(std::uint64_t data : events){
+            fastic::eventPacket event{aurora::dataPacket(data)};
+            valid += event.hasValidParity();
+        }
+        benchmark::DoNotOptimize(valid);
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_eventPacketDecode)->Range(1 << 10, 1 << 16);
+
+static void BM_eventBatchDecode(benchmark::State & state){
+    std::vector<std::uint64_t> events = makeEvents(state.range(0));
+    fastic::eventBatch batch;
+    batch.reserve(events.size());
+
+    for(auto _ : state){
+        batch.clear();
+        batch.decode(events.data(), events.size());
+        benchmark::DoNotOptimize(batch.getParityBitmap());
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_eventBatchDecode)->Range(1 << 10, 1 << 16);
+
+static void BM_eventFilter(benchmark::State & state){
+    //Half of the channels, no empty events and only valid parity, compacted in place
+    std::vector<std::uint64_t> events = makeEvents(state.range(0));
+    std::vector<std::uint64_t> survivors(events.size());
+    fastic::eventFilter::config config;
+    config.channels = 0x0F;
+    config.minPulseWidth = 1;
+    config.parity = fastic::eventFilter::parityPolicy::rejectInvalid;
+    fastic::eventFilter filter(config);
+
+    for(auto _ : state){
+        benchmark::DoNotOptimize(filter.apply(events.data(), events.size(), survivors.data()));
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_eventFilter)->Range(1 << 10, 1 << 16);
+
+static void BM_eventFilterDecode(benchmark::State & state){
+    //Decode of the kept events, filtered on the decoded batch afterwards (0) or on the raw words before the decode (1)
+    std::vector<std::uint64_t> events = makeEvents(65536);
+    fastic::eventFilter::config config;
+    config.channels = 0x0F;
+    config.minPulseWidth = 1;
+    config.parity = fastic::eventFilter::parityPolicy::rejectInvalid;
+    fastic::eventFilter filter(config);
+    const bool early = state.range(0);
+    fastic::eventBatch batch;
+    batch.reserve(events.size());
+
+    for(auto _ : state){
+        batch.clear();
+        std::size_t kept = 0;
+
+        if(early){
+            filter.forward(events.data(), events.size(), [&batch](const std::uint64_t * data, std::size_t count){ batch.decode(data, count); });
+            kept = batch.size();
+        }else{
+            batch.decode(events.data(), events.size());
+            for(std::size_t idx = 0; idx < batch.size(); idx++){
+                kept += ((config.channels >> batch.getChannels()[idx]) & 1) && batch.getPulseWidths()[idx] >= config.minPulseWidth && batch.hasValidParity(idx);
+            }
+        }
+        benchmark::DoNotOptimize(kept);
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_eventFilterDecode)->Arg(0)->Arg(1);
+
+static void BM_histogram(benchmark::State & state){
+    //Event by event (0), bulk update from the raw words (1) or from a decoded batch (2)
+    std::vector<std::uint64_t> events = makeEvents(65536);
+    fastic::eventHistograms histograms(1);
+    fastic::eventHistograms::accumulator & accumulator = histograms.getAccumulator(0);
+    fastic::eventBatch batch;
+    batch.decode(events.data(), events.size());
+    const int mode = state.range(0);
+
+    for(auto _ : state){
+        if(mode == 0){
+            for(std::uint64_t data : events) accumulator.add(data);
+        }else if(mode == 1){
+            accumulator.add(events.data(), events.size());
+        }else{
+            accumulator.add(batch);
+        }
+    }
+    benchmark::DoNotOptimize(accumulator.getEvents());
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_histogram)->Arg(0)->Arg(1)->Arg(2);
+
+static void BM_bufferPool(benchmark::State & state){
+    //Filling a fresh 4 MB buffer, from the heap (0), a pool of base pages (1) or a huge page pool (2)
+    const std::size_t bufferSize = 4 << 20;
+    const int mode = state.range(0);
+    aurora::bufferPool pool(4, bufferSize, mode == 2);
+    std::vector<std::uint32_t> words = makeStream(bufferSize / sizeof(std::uint64_t) * 2 / 66 * 32, 0);
+    words.resize(bufferSize / sizeof(std::uint32_t));
+
+    for(auto _ : state){
+        if(mode == 0){
+            std::vector<std::uint32_t> buffer(words.begin(), words.end());
+            benchmark::DoNotOptimize(buffer.data());
+        }else{
+            std::size_t index;
+            pool.acquire(index);
+            std::copy(words.begin(), words.end(), pool.getBuffer(index));
+            benchmark::DoNotOptimize(pool.getBuffer(index));
+            pool.release(index);
+        }
+    }
+
+    state.counters["backing"] = (int)pool.getMemory().getBacking();
+    state.SetBytesProcessed(state.iterations() * bufferSize);
+}
+BENCHMARK(BM_bufferPool)->Arg(0)->Arg(1)->Arg(2);
+
+static void BM_eventBatchEncode(benchmark::State & state){
+    std::vector<std::uint64_t> events = makeEvents(65536);
+    fastic::eventBatch batch;
+    batch.decode(events.data(), events.size());
+    std::vector<std::uint64_t> encoded(batch.size());
+
+    for(auto _ : state){
+        batch.encode(0, batch.size(), encoded.data());
+        benchmark::DoNotOptimize(encoded.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * batch.size());
+}
+BENCHMARK(BM_eventBatchEncode);
+
+static void BM_txEncode(benchmark::State & state){
+    //Scrambling and framing the data payloads at the given bitslip
+    std::vector<std::uint64_t> events = makeEvents(65536);
+    std::vector<std::uint32_t> words(aurora::tx::getMaxWords(events.size()));
+    const std::uint8_t bitSlip = state.range(0);
+
+    for(auto _ : state){
+        aurora::tx transmitter(bitSlip);
+        std::size_t written = transmitter.encode(events.data(), events.size(), words.data());
+        written += transmitter.finish(words.data() + written);
+        benchmark::DoNotOptimize(written);
+    }
+
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_txEncode)->Arg(0)->Arg(7)->Arg(65);
+
+static void BM_streamReader(benchmark::State & state){
+    //Reading a capture file into 1 MB buffers and decoding them, by blocking reads (0) or by io_uring with 8 reads in flight (1)
+    const char * path = "/tmp/fastic_bench_stream.bin";
+    std::vector<std::uint32_t> words = makeStream(33 * 16 * 16384, 0);
+    if(!fastic::captureFile::write(path, words.data(), words.size())){
+        state.SkipWithError("Failed to write the capture");
+        return;
+    }
+
+    const std::size_t depth = 8;
+    aurora::bufferPool pool(depth + 1, 1 << 20);
+    aurora::streamReader reader(pool, depth, state.range(0) ? aurora::streamReader::backend::ioUring : aurora::streamReader::backend::blocking);
+    aurora::rx receiver(nullptr, 0);
+    std::uint64_t payloads = 0;
+
+    for(auto _ : state){
+        reader.open(path);
+        receiver.resetStream();
+        receiver.synced_ = false;
+        reader.run([&](std::size_t index, std::size_t size){
+            receiver.feedPayloads(pool.getBuffer(index), size,
+                                  [&payloads](const std::uint64_t *, std::size_t count){ payloads += count; },
+                                  [](const aurora::controlPacket &){});
+            pool.release(index);
+        });
+    }
+    benchmark::DoNotOptimize(payloads);
+
+    state.counters["backend"] = (int)reader.getBackend();
+    state.SetBytesProcessed(state.iterations() * words.size() * sizeof(std::uint32_t));
+    std::remove(path);
+}
+BENCHMARK(BM_streamReader)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_parallelRx(benchmark::State & state){
+    //A whole capture decoded by the given number of threads in 64k word chunks
+    std::vector<std::uint32_t> words = makeStream(33 * 16 * 16384, 0);
+    aurora::parallelRx receiver(state.range(0), 1 << 16);
+    std::uint64_t payloads = 0;
+
+    for(auto _ : state){
+        receiver.decodePayloads(words.data(), words.size(),
+                                [&payloads](const std::uint64_t *, std::size_t count){ payloads += count; },
+                                [](const aurora::controlPacket &){});
+    }
+    benchmark::DoNotOptimize(payloads);
+
+    state.counters["redecoded"] = receiver.getRedecodedChunks();
+    state.SetBytesProcessed(state.iterations() * words.size() * sizeof(std::uint32_t));
+}
+BENCHMARK(BM_parallelRx)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_multiRx(benchmark::State & state){
+    //Every lane decodes its own stream, each iteration submits the same number of buffers to all the lanes
+    const std::size_t lanes = state.range(0);
+    const std::size_t workers = std::min<std::size_t>(lanes, std::max(1u, std::thread::hardware_concurrency()));
+    const std::size_t frames = 16384;
+    const std::size_t buffersPerLane = 8;
+
+    std::vector<std::vector<std::uint32_t>> streams;
+    for(std::size_t lane = 0; lane < lanes; lane++) streams.push_back(makeStream(frames, 0, lane + 1));
+
+    fastic::multiRx receiver(lanes, workers);
+    std::vector<std::uint64_t> submitted(lanes, 0);
+    std::uint64_t events = 0;
+
+    for(auto _ : state){
+        for(std::size_t buffer = 0; buffer < buffersPerLane; buffer++){
+            for(std::size_t lane = 0; lane < lanes; lane++){
+                while(!receiver.submit(lane, streams[lane].data(), streams[lane].size())) std::this_thread::yield();
+                submitted[lane]++;
+            }
+        }
+
+        //Drain until every lane decoded all of its buffers
+        for(bool pending = true; pending;){
+            pending = false;
+            for(std::size_t lane = 0; lane < lanes; lane++){
+                events += receiver.drain(lane, [](fastic::eventPacket &){});
+                pending |= receiver.getCompletedBuffers(lane) < submitted[lane];
+            }
+            if(pending) std::this_thread::yield();
+        }
+        for(std::size_t lane = 0; lane < lanes; lane++) events += receiver.drain(lane, [](fastic::eventPacket &){});
+    }
+
+    state.counters["workers"] = workers;
+    state.SetItemsProcessed(events);
+    state.SetBytesProcessed(state.iterations() * lanes * buffersPerLane * streams[0].size() * sizeof(std::uint32_t));
+}
+BENCHMARK(BM_multiRx)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
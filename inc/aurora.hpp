@@ -2,11 +2,18 @@
 #define AURORA_H
 
 #include <cstdint>
+#include <cstddef>
 #include <vector>
+#include <array>
+#include <algorithm>
+#include "frame_unpacker.hpp"
+#include "metrics.hpp"
 
 namespace aurora{
 
     class packet;
+    class dataPacket;
+    class controlPacket;
 
     class rx
     {
@@ -21,17 +28,71 @@ namespace aurora{
             std::uint16_t packetIdx_ = 0;
 
             //Pointer to bitstream with the raw data
-            std::uint32_t * rxBuffer_;
+            const std::uint32_t * rxBuffer_;
             std::size_t rxBufferSize_;
 
             //Buffer of received packets
             std::vector<packet> packetBuffer_;
-            std::uint32_t berCounter_;
+            //Percentage of the frames with an invalid sync header in the last decoded buffer (chunk)
+            std::uint32_t berCounter_ = 0;
+
+            //Streaming state carried from one chunk passed to feed to the next one
+            std::array<std::uint32_t, 4> carryBuffer_;      //Words of the previous chunk holding an incomplete frame
+            std::size_t carryWords_ = 0;                    //Number of valid words in the carry buffer
+            std::size_t streamPosition_ = 0;                //Bit position of the next frame, relative to the carried words
+            std::uint64_t previousData_ = 0;                //Last scrambled payload (the descrambler state)
+            bool hasPreviousData_ = false;                  //Signal if the descrambler state is valid
+            bool streamStarted_ = false;                    //Signal if streamPosition_ holds the position of a running stream
+            std::size_t frameErrors_ = 0;                   //Number of frames with an invalid sync header seen by decodeFrames
+            std::vector<std::uint32_t> syncBuffer_;         //Unsynced input collected until it holds a whole sync sample
+            std::vector<std::uint32_t> relockBuffer_;       //Carried words joined with the chunk following them for a relock
+
+            //Lock monitor, the lock is dropped once lockErrorLimit_ of the last 64 frames had an invalid sync header
+            int lockErrorLimit_ = 16;
+            int lockErrors_ = 0;                            //Number of invalid headers in the window
+            std::uint64_t lockHistory_ = 0;                 //Invalid header flags of the last 64 frames, newest in the LSB
+            std::uint32_t relockCounter_ = 0;               //Number of times the lock was lost
+
+            //Cumulative link health counters and stage timing, readable from any thread
+            rxMetrics metrics_;
+
+            // Update berCounter_ from frameErrors_ and the number of frames decoded since it was cleared
+            void updateBerCounter(std::size_t frames);
+
+            // Re-acquire the alignment after the lock was lost, starting at bitPosition
+            bool relock(const std::uint32_t * buffer, std::size_t bufferBits, std::size_t & bitPosition, const std::uint32_t * chunk = nullptr, std::size_t chunkSize = 0);
+            // Number of words holding a whole sync sample
+            std::size_t getSyncSampleWords() const;
+            // Collect the unsynced input and acquire the alignment of a new stream on it, returns the number of words of the chunk consumed
+            std::size_t acquireStream(const std::uint32_t * data, std::size_t size);
+
+            // Get the synchronization bits of the frame starting at the specified bit of the buffer
+            static std::uint8_t extractSyncBits(const std::uint32_t * buffer, std::size_t bitPosition);
+            // Get the (scrambled) payload of the frame starting at the specified bit of the buffer
+            static std::uint64_t extractPacketData(const std::uint32_t * buffer, std::size_t bitPosition);
+            // Decode all complete frames of the buffer starting at bitPosition into descrambled payloads, advances bitPosition past the last decoded frame
+            template<typename FrameSink>
+            std::size_t decodeFrames(const std::uint32_t * buffer, std::size_t bufferBits, std::size_t & bitPosition, FrameSink && sink, const std::uint32_t * chunk = nullptr, std::size_t chunkSize = 0);
+            // Decode the rx buffer on its own
+            template<typename FrameSink>
+            void processFrames(FrameSink && sink);
+            // Decode a chunk of a continuous stream
+            template<typename FrameSink>
+            void feedFrames(const std::uint32_t * data, std::size_t size, FrameSink && sink);
+            // Decode a chunk of a running stream, returns the number of decoded frames
+            template<typename FrameSink>
+            std::size_t feedStream(const std::uint32_t * data, std::size_t size, FrameSink && sink);
+            // Frame sink building a packet of every frame for the sink
+            template<typename Sink>
+            static auto packetFrameSink(Sink & sink, bool discardControl);
 
             bool hasValidSync(int packetIndex);
             
             std::uint64_t getPacketData(int packetIndex);
-            void descramblePacketData(std::uint64_t & currentData, std::uint64_t previousData);
+            // Descramble a single 64bit payload using the previous (still scrambled) payload as the scrambler state
+            static void descramblePacketData(std::uint64_t & currentData, std::uint64_t previousData);
+            // Descramble a block of consecutive payloads in place, returns the last scrambled payload of the block
+            static std::uint64_t descramblePacketBlock(std::uint64_t * data, std::size_t count, std::uint64_t previousData);
             packet getPacket();
             packet getPacket(int index);
 
@@ -47,13 +108,37 @@ namespace aurora{
 
             int syncErrorTreshold_;
             int syncErrorSampleSize_;
+            std::uint8_t syncErrorTresholdPercentage_;
+
+            // Score all the 66 frame alignments of the buffer starting at bitPosition and return the best one
+            static std::uint8_t acquireAlignment(const std::uint32_t * buffer, std::size_t bufferBits, std::size_t bitPosition, int sampleSize, int & score, int & sampledFrames);
+            // Find the frame alignment of the buffer starting at bitPosition which suffices the sync error treshold
+            bool acquireSync(const std::uint32_t * buffer, std::size_t bufferBits, std::size_t bitPosition, std::uint8_t & alignment);
 
 
         //public:
-            rx(std::uint32_t * rxBuffer, std::size_t rxBufferSize, std::uint8_t syncErrorTresholdPercentage = 90, int syncErrorSampleSize = 64);
+            rx(const std::uint32_t * rxBuffer, std::size_t rxBufferSize, std::uint8_t syncErrorTresholdPercentage = 90, int syncErrorSampleSize = 64);
 
-            void setRxBuffer(std::uint32_t * rxBuffer, std::size_t rxBufferSize);
+            void setRxBuffer(const std::uint32_t * rxBuffer, std::size_t rxBufferSize);
             void processRxBuffer(bool discardControl = false);
+            // Decode the buffer handing every packet to the sink (callable with a const packet &) instead of the packet buffer
+            template<typename Sink>
+            void processRxBuffer(Sink && sink, bool discardControl = false);
+            // Decode the buffer into caller owned memory, returns the number of packets decoded (even those beyond capacity)
+            std::size_t processRxBuffer(packet * output, std::size_t capacity, bool discardControl = false);
+            // Decode the buffer straight into runs of data payloads and single control packets, no packet is built for the data frames
+            template<typename DataSink, typename ControlSink>
+            void processRxPayloads(DataSink && dataSink, ControlSink && controlSink);
+
+            // Decode the next chunk of a continuous stream, frames straddling the chunk boundaries are kept
+            void feed(const std::uint32_t * data, std::size_t size, bool discardControl = false);
+            template<typename Sink>
+            void feed(const std::uint32_t * data, std::size_t size, Sink && sink, bool discardControl = false);
+            // Decode the next chunk of a continuous stream straight into runs of data payloads and single control packets
+            template<typename DataSink, typename ControlSink>
+            void feedPayloads(const std::uint32_t * data, std::size_t size, DataSink && dataSink, ControlSink && controlSink);
+            // Drop the streaming state, the next chunk passed to feed starts a new stream
+            void resetStream();
 
             bool synchronize();
             bool isSynchronized();
@@ -62,6 +147,9 @@ namespace aurora{
             const std::vector<packet> & getPacketBuffer() const;
 
             std::uint8_t getBitSlip();
+            std::uint32_t getRelockCount();
+            // Cumulative counters of the receiver, safe to read while another thread decodes
+            const rxMetrics & getMetrics() const;
     };
 
     class packet
@@ -91,36 +179,36 @@ namespace aurora{
                 bool nr : 1;
                 bool cb : 1;
                 bool cc : 1;
-                btf btf : 8;
+                packet::btf btf : 8;
             };
 
             struct nfc {
                 std::uint64_t raw_ : 47;
                 bool xoff : 1;
                 std::uint8_t pause : 8;
-                btf btf : 8;
+                packet::btf btf : 8;
             };
 
             struct ufc {
                 std::uint64_t data : 48;
                 std::uint8_t size : 8;
-                btf btf : 8;
+                packet::btf btf : 8;
             };
 
             struct separator7 {
                 std::uint64_t data : 56;
-                btf btf : 8;
+                packet::btf btf : 8;
             };
 
             struct separator {
                 std::uint64_t data : 48;
                 std::uint8_t size : 8;
-                btf btf : 8;
+                packet::btf btf : 8;
             };
 
             struct generic {
                 std::uint64_t data : 56;
-                btf btf : 8;
+                packet::btf btf : 8;
             };
 
             union fields {
@@ -140,9 +228,412 @@ namespace aurora{
 
             union {
                 std::uint64_t data;
-                fields fields;
+                packet::fields fields;
             };
     };
+
+    //Descrambled payload of a data frame
+    class dataPacket
+    {
+        private:
+            std::uint64_t data_;
+
+        public:
+            dataPacket(std::uint64_t data);
+            dataPacket(const packet & packet);
+
+            std::uint64_t getData() const;
+    };
+
+    //Descrambled payload of a control frame, the block type field followed by 56 bits of data
+    class controlPacket
+    {
+        private:
+            std::uint64_t data_;
+
+        public:
+            controlPacket(std::uint64_t data);
+            controlPacket(const packet & packet);
+
+            packet::btf getBlockType() const;
+            std::uint64_t getData() const;
+    };
+
+    inline std::uint8_t rx::extractSyncBits(const std::uint32_t * buffer, std::size_t bitPosition){
+        std::size_t syncIndex = bitPosition / 32;
+        std::uint8_t syncShift = bitPosition % 32;
+
+        std::uint8_t syncBits = 0;
+        
+        if(syncShift == 31){
+            // This is the special case where the sync bits are split between the two 32bit data words -> join them
+            syncBits = ((buffer[syncIndex] & 0x00000001) << 1) | ((buffer[syncIndex+1] & 0x80000000) >> 31);
+        }else{
+             // This is the most usual case where the bits are in one data word -> just mask them
+            syncBits = (buffer[syncIndex] & (0xC0000000 >> syncShift)) >> (30 - syncShift);
+        }
+
+        return syncBits;
+    }
+
+    inline std::uint64_t rx::extractPacketData(const std::uint32_t * buffer, std::size_t bitPosition){
+        std::size_t syncIndex = bitPosition / 32;
+        std::uint8_t syncShift = bitPosition % 32;
+
+        std::uint64_t data;
+
+        // Reconstruct the packet data
+        if(syncShift == 31){
+            data = 0
+                   | ((std::uint64_t)(buffer[syncIndex+1] & 0x7FFFFFFF) << 33)
+                   | ((std::uint64_t) buffer[syncIndex+2]               << 1)
+                   | ((std::uint64_t)(buffer[syncIndex+3] & 0x80000000) >> 31);
+        }else{
+            data = 0
+                 | ((std::uint64_t)((buffer[syncIndex]     & (0x3FFFFFFF >> syncShift)))           << (32 + syncShift + 2))
+                 | ((std::uint64_t)  buffer[syncIndex+1])                                          << (syncShift + 2)
+                 | ((std::uint64_t)((buffer[syncIndex+2]   & (0xFFFFFFFF << (30 - syncShift))))    >> (30 - syncShift));
+        }
+
+        return data;
+    }
+
+    /// @brief Descramble the payload of the x^58 + x^39 + 1 self-synchronous scrambler
+    /// @param currentData Scrambled payload which gets replaced by the descrambled one
+    /// @param previousData Scrambled payload of the previous packet, holding the scrambler state
+    inline void rx::descramblePacketData(std::uint64_t & currentData, std::uint64_t previousData){
+        // Every output bit is in[n] ^ in[n-39] ^ in[n-58] over the scrambled stream. Since both taps are shorter
+        // than the payload, all 64 bits can be produced at once from the current and the previous payload
+        currentData = currentData
+                    ^ ((currentData >> 39) | (previousData << 25))
+                    ^ ((currentData >> 58) | (previousData << 6));
+    }
+
+    /// @brief Decode all the frames which fit completely into the buffer
+    /// @param buffer Pointer to the raw data
+    /// @param bufferBits Number of valid bits in the buffer
+    /// @param bitPosition Bit position of the first frame, on return the position of the first frame which did not fit
+    /// @param sink Callable receiving every decoded frame (std::uint8_t syncBits, std::uint64_t data) with the descrambled payload
+    /// @param chunk Chunk following the carried words when the buffer is the stitch buffer of feedStream, nullptr otherwise
+    /// @param chunkSize Number of words in the chunk
+    /// @return Number of decoded frames
+    template<typename FrameSink>
+    std::size_t rx::decodeFrames(const std::uint32_t * buffer, std::size_t bufferBits, std::size_t & bitPosition, FrameSink && sink, const std::uint32_t * chunk, std::size_t chunkSize){
+        std::size_t frames = 0;
+        std::uint64_t startTicks = readTicks();
+        decodeCounts counts;
+
+        //The stream state lives in locals during the loop, the stores of the sink could alias the members and force their reloads
+        std::size_t position = bitPosition;
+        int lockErrors = lockErrors_;
+        std::uint64_t lockHistory = lockHistory_;
+        std::uint64_t previousData = previousData_;
+        bool hasPreviousData = hasPreviousData_;
+
+        //The phase does not change from one period to the next, the unpacker only changes with a relock
+        framePeriodUnpacker unpacker = framePeriodUnpackers[position % 32];
+
+        std::uint8_t syncBits[periodFrames];
+        std::uint64_t scrambledData[periodFrames];
+        std::uint64_t descrambledData[periodFrames];
+
+        while(position + 66 <= bufferBits){
+            std::size_t count = 1;
+
+            if((position / 32 + periodReadWords) * 32 <= bufferBits){
+                //Whole period in the buffer, its payloads are descrambled at once by the vector block path
+                unpacker(buffer + position / 32, syncBits, scrambledData);
+                count = periodFrames;
+                std::copy(scrambledData, scrambledData + periodFrames, descrambledData);
+                descramblePacketBlock(descrambledData, periodFrames, previousData);
+            }else{
+                //Tail of the buffer, frame by frame
+                syncBits[0] = extractSyncBits(buffer, position);
+                scrambledData[0] = extractPacketData(buffer, position);
+                descrambledData[0] = scrambledData[0];
+                descramblePacketData(descrambledData[0], previousData);
+            }
+
+            for(std::size_t idx = 0; idx < count; idx++){
+                std::uint8_t header = syncBits[idx];
+                std::uint64_t scrambled = scrambledData[idx];
+
+                // Slide the lock window by one frame
+                bool invalidHeader = (header == 0b00 || header == 0b11);
+                lockErrors += (int)invalidHeader - (int)(lockHistory >> 63);
+                lockHistory = (lockHistory << 1) | invalidHeader;
+
+                if(lockErrors >= lockErrorLimit_){
+                    // The alignment has drifted, find the new one and continue decoding from there
+                    bool relocked = relock(buffer, bufferBits, position, chunk, chunkSize);
+
+                    //The relock starts a new descrambler chain and a clean lock window
+                    lockErrors = lockErrors_;
+                    lockHistory = lockHistory_;
+                    hasPreviousData = hasPreviousData_;
+
+                    if(!relocked) position = std::max(position, bufferBits);
+                    unpacker = framePeriodUnpackers[position % 32];
+                    break;
+                }
+
+                if(header == 0b01){
+                    counts.dataFrames++;
+                }else if(header == 0b10){
+                    counts.controlFrames++;
+                }else{
+                    counts.headerErrors++;
+                }
+
+                // The very first frame of a stream has no predecessor and only seeds the descrambler, the block
+                // descrambled it with a stale state but every following frame uses its scrambled predecessor
+                if(hasPreviousData){
+                    std::uint64_t data = descrambledData[idx];
+
+                    if(header == 0b10){
+                        counts.blockTypes[rxMetrics::blockTypeIndex(data >> 56)]++;
+                    }
+
+                    sink(header, data);
+                }
+
+                previousData = scrambled;
+                hasPreviousData = true;
+                position += 66;
+                frames++;
+            }
+        }
+
+        bitPosition = position;
+        lockErrors_ = lockErrors;
+        lockHistory_ = lockHistory;
+        previousData_ = previousData;
+        hasPreviousData_ = hasPreviousData;
+        frameErrors_ += counts.headerErrors;
+
+        //Publish the counts once per call, the loop above only touches locals
+        counts.frames = frames;
+        metrics_.add(counts);
+        metrics_.addStage(rxMetrics::stage::decode, readTicks() - startTicks, frames);
+
+        return frames;
+    }
+
+    /// @brief Adapt a packet sink to the frames of decodeFrames
+    /// @param sink Callable receiving every decoded packet (const packet &)
+    /// @param discardControl Do not pass the control frames to the sink
+    /// @return The frame sink
+    template<typename Sink>
+    auto rx::packetFrameSink(Sink & sink, bool discardControl){
+        return [&sink, discardControl](std::uint8_t syncBits, std::uint64_t data){
+            packet p;
+
+            if(syncBits == 0b01){
+                p.type = packet::type::data;
+            }else if(syncBits == 0b10){
+                p.type = packet::type::control;
+                if(discardControl) return;
+            }else{
+                p.type = packet::type::error;
+            }
+
+            p.data = data;
+            sink(static_cast<const packet &>(p));
+        };
+    }
+
+    /*
+        Frame sink of the fused decode path
+
+        The payloads of the data frames are gathered into runs handed to the data sink at once,
+        the control frames go one by one to the control sink right after the data preceding them.
+        The frames with an invalid sync header are dropped (and counted in the receiver metrics).
+    */
+    template<typename DataSink, typename ControlSink>
+    class payloadSplitter
+    {
+        private:
+            //Payloads gathered before the data sink is called, small enough to stay in L1
+            static constexpr std::size_t capacity_ = 256;
+
+            DataSink & dataSink_;
+            ControlSink & controlSink_;
+            std::size_t count_ = 0;
+            alignas(64) std::uint64_t payloads_[capacity_];
+
+        public:
+            payloadSplitter(DataSink & dataSink, ControlSink & controlSink) : dataSink_(dataSink), controlSink_(controlSink) {}
+
+            void operator()(std::uint8_t syncBits, std::uint64_t data){
+                //Every payload is stored, only the data ones advance the run
+                payloads_[count_] = data;
+                count_ += (syncBits == 0b01);
+
+                if(syncBits == 0b10){
+                    flush();
+                    controlSink_(controlPacket(data));
+                }else if(count_ == capacity_){
+                    flush();
+                }
+            }
+
+            // Hand the gathered data payloads to the data sink
+            void flush(){
+                if(!count_) return;
+
+                dataSink_(static_cast<const std::uint64_t *>(payloads_), count_);
+                count_ = 0;
+            }
+    };
+
+    /// @brief Decode the whole buffer, handing the packets to the sink as they are decoded
+    /// @param sink Callable receiving every decoded packet (const packet &)
+    /// @param discardControl Do not pass the control frames to the sink
+    template<typename Sink>
+    void rx::processRxBuffer(Sink && sink, bool discardControl){
+        packetIdx_ = 0;
+        processFrames(packetFrameSink(sink, discardControl));
+    }
+
+    /// @brief Decode the whole buffer straight into payloads, without building any packet
+    /// @param dataSink Callable receiving runs of descrambled data payloads (const std::uint64_t * payloads, std::size_t count)
+    /// @param controlSink Callable receiving every control frame (const controlPacket &), after the data preceding it
+    template<typename DataSink, typename ControlSink>
+    void rx::processRxPayloads(DataSink && dataSink, ControlSink && controlSink){
+        payloadSplitter<DataSink, ControlSink> splitter(dataSink, controlSink);
+        processFrames(splitter);
+        splitter.flush();
+    }
+
+    /// @brief Decode the whole rx buffer on its own
+    /// @param sink Callable receiving every decoded frame
+    template<typename FrameSink>
+    void rx::processFrames(FrameSink && sink){
+        berCounter_ = 0;
+
+        //The buffer is decoded on its own, starting with the frame at the bitslip
+        resetStream();
+        std::size_t bitPosition = this->bitSlip_;
+        std::size_t frames = decodeFrames(rxBuffer_, rxBufferSize_ * 32, bitPosition, sink);
+
+        updateBerCounter(frames);
+    }
+
+    /// @brief Decode a chunk of a continuous stream, keeping the leftover bits and the descrambler state for the next chunk
+    /// @param data Pointer to the raw data chunk with 32bit MSB unscrambled data words
+    /// @param size Number of words in the chunk
+    /// @param sink Callable receiving every decoded packet (const packet &)
+    /// @param discardControl Do not pass the control frames to the sink
+    template<typename Sink>
+    void rx::feed(const std::uint32_t * data, std::size_t size, Sink && sink, bool discardControl){
+        feedFrames(data, size, packetFrameSink(sink, discardControl));
+    }
+
+    /// @brief Decode a chunk of a continuous stream straight into payloads, without building any packet
+    /// @param data Pointer to the raw data chunk with 32bit MSB unscrambled data words
+    /// @param size Number of words in the chunk
+    /// @param dataSink Callable receiving runs of descrambled data payloads (const std::uint64_t * payloads, std::size_t count)
+    /// @param controlSink Callable receiving every control frame (const controlPacket &), after the data preceding it
+    template<typename DataSink, typename ControlSink>
+    void rx::feedPayloads(const std::uint32_t * data, std::size_t size, DataSink && dataSink, ControlSink && controlSink){
+        payloadSplitter<DataSink, ControlSink> splitter(dataSink, controlSink);
+        feedFrames(data, size, splitter);
+        splitter.flush();
+    }
+
+    /// @brief Decode a chunk of a continuous stream, keeping the leftover bits and the descrambler state for the next chunk
+    /// @param data Pointer to the raw data chunk with 32bit MSB unscrambled data words
+    /// @param size Number of words in the chunk
+    /// @param sink Callable receiving every decoded frame
+    template<typename FrameSink>
+    void rx::feedFrames(const std::uint32_t * data, std::size_t size, FrameSink && sink){
+        frameErrors_ = 0;
+        std::size_t frames = 0;
+
+        if(!synced_){
+            //Without sync the carried state is meaningless, a new stream is acquired on the unsynced input collected so far
+            if(syncBuffer_.empty()) resetStream();
+            std::size_t used = acquireStream(data, size);
+            if(!synced_) return;
+
+            //The stream starts in the collected input, the rest of the chunk follows it as the next chunk
+            if(!syncBuffer_.empty()){
+                frames += feedStream(syncBuffer_.data(), syncBuffer_.size(), sink);
+                syncBuffer_.clear();
+            }
+
+            data += used;
+            size -= used;
+        }
+
+        if(synced_) frames += feedStream(data, size, sink);
+
+        updateBerCounter(frames);
+    }
+
+    /// @brief Decode a chunk of a running stream, keeping the leftover bits and the descrambler state for the next chunk
+    /// @param data Pointer to the raw data chunk with 32bit MSB unscrambled data words
+    /// @param size Number of words in the chunk
+    /// @param sink Callable receiving every decoded frame
+    /// @return Number of decoded frames
+    template<typename FrameSink>
+    std::size_t rx::feedStream(const std::uint32_t * data, std::size_t size, FrameSink && sink){
+        //A new stream starts with the frame at the bitslip
+        if(!streamStarted_){
+            streamPosition_ = this->bitSlip_;
+            streamStarted_ = true;
+        }
+
+        std::size_t frames = 0;
+
+        if(carryWords_){
+            //Join the carried words with the beginning of this chunk to complete the frame straddling the boundary
+            std::array<std::uint32_t, 8> stitchBuffer;
+            std::size_t stitchWords = std::min(size, stitchBuffer.size() - carryWords_);
+            std::copy_n(carryBuffer_.begin(), carryWords_, stitchBuffer.begin());
+            std::copy_n(data, stitchWords, stitchBuffer.begin() + carryWords_);
+
+            //Only the frames starting in the carried words are decoded here, the rest is read from the chunk directly,
+            //a relock on a carried frame searches the chunk as the stitch buffer is too short for it
+            std::size_t stitchBits = std::min((carryWords_ + stitchWords) * 32, carryWords_ * 32 + 65);
+            frames += decodeFrames(stitchBuffer.data(), stitchBits, streamPosition_, sink, data, size);
+
+            //The lock was lost and could not be recovered, the next chunk starts a new stream
+            if(!synced_){
+                resetStream();
+                return frames;
+            }
+
+            if(streamPosition_ < carryWords_ * 32){
+                //The chunk was too short to complete the frame, carry all of it to the next one
+                std::size_t carryStart = streamPosition_ / 32;
+                carryWords_ = carryWords_ + stitchWords - carryStart;
+                std::copy_n(stitchBuffer.begin() + carryStart, carryWords_, carryBuffer_.begin());
+                streamPosition_ -= carryStart * 32;
+                return frames;
+            }
+
+            streamPosition_ -= carryWords_ * 32;
+            carryWords_ = 0;
+        }
+
+        //Decode the frames lying completely in the chunk
+        frames += decodeFrames(data, size * 32, streamPosition_, sink);
+
+        //The lock was lost and could not be recovered, the next chunk starts a new stream
+        if(!synced_){
+            resetStream();
+            return frames;
+        }
+
+        //Keep the words of the incomplete last frame for the next chunk
+        std::size_t carryStart = std::min(streamPosition_ / 32, size);
+        carryWords_ = size - carryStart;
+        std::copy_n(data + carryStart, carryWords_, carryBuffer_.begin());
+        streamPosition_ -= carryStart * 32;
+
+        return frames;
+    }
 }
 
 #endif
@@ -0,0 +1,113 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "mpmc_queue.hpp"
+
+namespace aurora{
+
+    //Anonymous memory mapping, optionally backed by huge pages, faulted in when it is allocated
+    class pageMemory
+    {
+        public:
+            enum class backing{
+                none,                   //Not allocated
+                standardPages,          //Base pages (the huge pages were not requested or not available)
+                transparentHugePages,   //Base page mapping advised to the transparent huge pages (MADV_HUGEPAGE)
+                hugeTlb                 //Reserved huge pages (MAP_HUGETLB)
+            };
+
+            static constexpr std::size_t pageSize = 4096;
+            static constexpr std::size_t hugePageSize = 2 * 1024 * 1024;
+
+        private:
+            void * data_ = nullptr;
+            std::size_t size_ = 0;
+            backing backing_ = backing::none;
+            bool locked_ = false;
+
+        public:
+            pageMemory() = default;
+            ~pageMemory();
+
+            pageMemory(const pageMemory &) = delete;
+            pageMemory & operator=(const pageMemory &) = delete;
+
+            // Map at least size bytes, trying the reserved and then the transparent huge pages if hugePages is set
+            bool allocate(std::size_t size, bool hugePages = true, bool lock = false);
+            void release();
+
+            void * data() const;
+            // Mapped size in bytes (rounded up to whole pages)
+            std::size_t size() const;
+            backing getBacking() const;
+            // Signal if the mapping is locked in memory (mlock)
+            bool isLocked() const;
+    };
+
+    /*
+        Pool of fixed size buffers for the raw input and the decoded output
+
+        All the buffers are carved out of one pageMemory mapping, every buffer starts on a page
+        boundary and the whole mapping is faulted in (and optionally locked) when the pool is
+        created, so filling a buffer never allocates or page faults. With the huge pages the
+        buffers are also covered by a few TLB entries only. The free buffers are kept as indices
+        in a lock-free queue, any thread may acquire a buffer and any thread may release it, so
+        a buffer can travel from the producer (DMA, file reader) through the decoder to the
+        consumer and back without locking. A thread finding no free buffer can sleep until the
+        next release (waitForFree), a release only takes the lock while such a thread waits.
+    */
+    class bufferPool
+    {
+        private:
+            pageMemory memory_;
+            std::size_t bufferSize_;
+            std::size_t bufferCount_;
+            mpmcQueue<std::uint32_t> free_;
+
+            //Sleep of the threads waiting for a release
+            std::mutex waitMutex_;
+            std::condition_variable released_;
+            std::atomic<std::size_t> waiters_{0};
+
+        public:
+            bufferPool(std::size_t bufferCount, std::size_t bufferSize, bool hugePages = true, bool lock = false);
+
+            bufferPool(const bufferPool &) = delete;
+            bufferPool & operator=(const bufferPool &) = delete;
+
+            // Signal if the memory of the pool was mapped
+            bool isAllocated() const;
+
+            // Take a free buffer, returns false if all of them are in use
+            bool acquire(std::size_t & index);
+            // Return a buffer to the pool, from any thread
+            void release(std::size_t index);
+            // Block until a buffer is free, another thread may take it before the caller does
+            void waitForFree();
+
+            // Start of the buffer viewed as an array of T
+            template<typename T = std::uint32_t>
+            T * getBuffer(std::size_t index) const;
+            // Index of the buffer containing the address
+            std::size_t getIndex(const void * address) const;
+
+            // Size of every buffer in bytes (rounded up to whole pages)
+            std::size_t getBufferSize() const;
+            std::size_t getBufferCount() const;
+            // Approximate number of free buffers
+            std::size_t getFreeCount() const;
+            const pageMemory & getMemory() const;
+    };
+
+    template<typename T>
+    T * bufferPool::getBuffer(std::size_t index) const{
+        return reinterpret_cast<T *>(static_cast<std::uint8_t *>(memory_.data()) + index * bufferSize_);
+    }
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <random>
+#include <array>
+#include "aurora.hpp"
+#include "fastic.hpp"
+#include "tx.hpp"
+
+namespace fastic{
+
+    /*
+        Synthesizer of raw Aurora captures
+
+        Generates the stream a FastIC+ chip would send: event packets with valid parities and
+        monotonic time, an extension packet (K0 block) every extensionInterval events and
+        optionally idle blocks in between. The payloads are scrambled, framed and packed by
+        aurora::tx starting at the given bitslip, exactly like the receiver buffer. Sync header
+        and bit errors can be injected.
+    */
+    class captureSynthesizer
+    {
+        public:
+            struct config {
+                std::uint8_t bitSlip = 0;
+                double headerErrorRate = 0.0;       //Probability of a corrupted sync header per frame
+                double bitErrorRate = 0.0;          //Probability of a flipped bit of the stream
+                double idleRate = 0.0;              //Probability of an idle block in place of an event
+                std::uint32_t extensionInterval = 1024;
+                std::uint32_t statisticsInterval = 0;   //Events between two statistics packets, 0 for none
+                std::uint32_t meanEventSpacing = 64;    //Mean distance of two events in ToA ticks
+                std::uint64_t seed = 1;
+            };
+
+        private:
+            config config_;
+            std::mt19937_64 random_;
+            aurora::tx tx_;
+
+            std::uint64_t time_ = 0;
+            std::uint32_t sentEvents_ = 0;
+            bool extensionDue_ = true;
+            std::size_t statisticsDue_ = 0;             //Halves of the statistics packet left to send
+            std::array<std::uint64_t, 2> statisticsWords_ = {};
+            std::array<std::uint32_t, 5> statisticsCounters_ = {};
+
+            std::uint64_t eventCounter_ = 0;
+            std::uint64_t extensionCounter_ = 0;
+            std::uint64_t statisticsCounter_ = 0;
+            std::uint64_t idleCounter_ = 0;
+            std::uint64_t headerErrors_ = 0;
+            std::uint64_t bitErrors_ = 0;
+
+            //Payloads and sync headers of the frames of one generate call, handed to the transmitter at once
+            std::vector<std::uint64_t> framePayloads_;
+            std::vector<std::uint8_t> frameHeaders_;
+
+            std::uint64_t nextPayload(bool & control);
+            std::uint8_t nextHeader(bool control);
+
+        public:
+            captureSynthesizer(const config & config);
+
+            // Append the given number of frames to the words (the first call also emits the bitslip bits)
+            void generate(std::size_t frames, std::vector<std::uint32_t> & words, std::vector<std::uint64_t> * payloads = nullptr);
+            // Append the bits of the last partial word padded with zeros, ends the stream
+            void finish(std::vector<std::uint32_t> & words);
+
+            // Raw event data word with all the parities filled in
+            static std::uint64_t eventWord(eventPacket::channel channel, eventPacket::type type, std::uint32_t timestamp, std::uint16_t pulseWidth, bool debug = false);
+            // Control block payload of an extension packet
+            static std::uint64_t extensionWord(std::uint32_t packetCount, std::uint32_t coarseCounter, bool reset = false);
+            // Control block payloads of the two halves of a statistics packet
+            static std::array<std::uint64_t, 2> statisticsWords(const statisticsPacket & packet);
+            // Scramble one payload, state is the previous scrambled word
+            static std::uint64_t scramble(std::uint64_t data, std::uint64_t & state);
+
+            std::uint64_t getEventCount() const;
+            std::uint64_t getExtensionCount() const;
+            std::uint64_t getStatisticsCount() const;
+            std::uint64_t getIdleCount() const;
+            std::uint64_t getHeaderErrors() const;
+            std::uint64_t getBitErrors() const;
+    };
+
+    //Memory mapped raw capture, a file of the 32bit receiver words in the host byte order
+    class captureFile
+    {
+        private:
+            int fd_ = -1;
+            const std::uint32_t * data_ = nullptr;
+            std::size_t size_ = 0;
+
+        public:
+            captureFile() = default;
+            ~captureFile();
+
+            captureFile(const captureFile &) = delete;
+            captureFile & operator=(const captureFile &) = delete;
+
+            bool open(const std::string & path);
+            void close();
+
+            const std::uint32_t * data() const;
+            // Number of 32bit words of the capture
+            std::size_t size() const;
+
+            // Store a capture
+            static bool write(const std::string & path, const std::uint32_t * data, std::size_t size);
+    };
+
+    inline std::uint64_t captureSynthesizer::scramble(std::uint64_t data, std::uint64_t & state){
+        return aurora::tx::scramble(data, state);
+    }
+}
+
+#endif
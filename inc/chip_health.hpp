@@ -0,0 +1,89 @@
+#ifndef CHIP_HEALTH_H
+#define CHIP_HEALTH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include "fastic.hpp"
+
+namespace fastic{
+
+    /*
+        Live health model of one FastIC+ chip
+
+        The chip reports its drop counters in the statistics packets. The counters are free
+        running and wrap at their width, so every update adds the difference to the previous
+        report (modulo the width) to a 64bit total and divides it by the time elapsed to get
+        the rate. The first report only sets the reference. A counter which wraps more than
+        once between two reports can not be told apart from one wrap, the reports have to
+        come often enough for the expected rates.
+
+        The decoding thread is the only writer. The state is published with a sequence lock,
+        so any other thread can take a consistent snapshot at any time without blocking the
+        writer, which makes polling it from the DAQ control loop cheap.
+    */
+    class chipHealth
+    {
+        public:
+            enum class counter{
+                fifoDrop,           //Packets dropped from the FIFO
+                pulseWidthDrop,     //Packets dropped due to out of range pulse width
+                darkCountDrop,      //Dark count drops
+                triggerDrop,        //Packets dropped due to malformed trigger pulse
+                pulseError,         //Malformed pulses
+                count
+            };
+
+            static constexpr std::size_t counterCount = static_cast<std::size_t>(counter::count);
+
+            //Consistent copy of the state
+            struct snapshot {
+                std::array<std::uint64_t, counterCount> totals = {};    //Counts since the first report (wraps resolved)
+                std::array<double, counterCount> rates = {};            //Counts per second between the last two reports
+                std::uint64_t reports = 0;                              //Number of statistics packets received
+                std::uint64_t time = 0;                                 //Time of the last report in nanoseconds
+                std::uint64_t incompletePackets = 0;                    //Statistics halves dropped by the reassembly
+
+                std::uint64_t getTotal(counter counter) const;
+                double getRate(counter counter) const;
+            };
+
+        private:
+            statisticsAssembler assembler_;
+
+            //Writer side state, only touched by the decoding thread
+            std::array<std::uint32_t, counterCount> lastCounters_ = {};
+            std::array<std::uint64_t, counterCount> totals_ = {};
+            std::uint64_t lastTime_ = 0;
+            std::uint64_t reports_ = 0;
+            bool hasReference_ = false;                 //Signal if lastCounters_ hold the previous report
+
+            //Published state, odd sequence while the writer updates it
+            std::atomic<std::uint64_t> sequence_{0};
+            std::array<std::atomic<std::uint64_t>, counterCount> publishedTotals_ = {};
+            std::array<std::atomic<double>, counterCount> publishedRates_ = {};
+            std::atomic<std::uint64_t> publishedReports_{0};
+            std::atomic<std::uint64_t> publishedTime_{0};
+            std::atomic<std::uint64_t> publishedIncomplete_{0};
+
+            static std::array<std::uint32_t, counterCount> getCounters(const statisticsPacket & packet);
+
+        public:
+            // Account a complete statistics packet received at time (nanoseconds, any monotonic clock)
+            void update(const statisticsPacket & packet, std::uint64_t time);
+            // Pass a control packet, the statistics halves are reassembled and accounted, returns true on a complete report
+            bool push(const aurora::controlPacket & control, std::uint64_t time);
+            // Forget the reference values, the next report only sets them again (the chip was reset or the link lost)
+            void reset();
+
+            // Take a consistent copy of the state, callable from any thread
+            snapshot getSnapshot() const;
+            // Number of reports received, a cheap check if the snapshot changed
+            std::uint64_t getReportCount() const;
+            // Width mask of the counter
+            static std::uint32_t getCounterMask(counter counter);
+    };
+}
+
+#endif
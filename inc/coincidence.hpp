@@ -0,0 +1,192 @@
+#ifndef COINCIDENCE_H
+#define COINCIDENCE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "fastic.hpp"
+#include "time_reconstruction.hpp"
+
+namespace fastic{
+
+    //Group of hits found by the coincidence matcher, valid only during the sink call
+    struct coincidence {
+        const timedEvent * trigger;     //Trigger event the hits belong to (nullptr in the cluster mode)
+        const timedEvent * hits;
+        std::size_t hitCount;
+    };
+
+    /*
+        Online coincidence matcher over a time ordered event stream (for example the output of timeMerger)
+
+        In the trigger mode every event on the TRIGGER channel opens a window of +-window around its
+        timestamp and once the stream passed the end of the window, all the detector hits (of any chip)
+        inside it are passed to the sink as one group. In the cluster mode the detector hits group with
+        each other, a group starts at its first hit and collects every hit up to window after it, the
+        TRIGGER events are ignored.
+
+        Only the hits which can still fall into some window are kept, each of them is stored once and
+        dropped once, so the cost per event is constant apart from the size of the emitted groups.
+        Groups smaller than minMultiplicity are discarded. The multiplicity of a trigger group is its
+        number of hits, the one of a cluster is the number of distinct channels (of distinct lanes)
+        it hit, so a burst of hits on a single channel is no coincidence.
+    */
+    class coincidenceMatcher
+    {
+        public:
+            enum class mode{
+                trigger,
+                cluster
+            };
+
+        private:
+            mode mode_;
+            std::uint64_t window_;
+            std::size_t minMultiplicity_;
+
+            //Buffered hits, the live part starts at hitsHead_ and is compacted once the dead part outgrows it
+            std::vector<timedEvent> hits_;
+            std::size_t hitsHead_ = 0;
+            //Triggers waiting for the end of their window
+            std::vector<timedEvent> triggers_;
+            std::size_t triggersHead_ = 0;
+            //Channels hit by the open cluster, bit (lane * 16 + channel)
+            std::vector<std::uint64_t> clusterChannels_;
+            std::size_t clusterMultiplicity_ = 0;
+
+            std::uint64_t lastTimestamp_ = 0;
+            std::uint64_t unorderedEvents_ = 0;
+            std::uint64_t groupCounter_ = 0;
+            std::uint64_t matchedHits_ = 0;
+            std::uint64_t processedEvents_ = 0;
+
+            void dropHits(std::uint64_t cutoff);
+            void compact();
+            // Mark the channel of the hit in the open cluster, returns true if it was not hit yet
+            bool markChannel(const timedEvent & hit);
+
+            template<typename Sink>
+            void emitGroup(const timedEvent * trigger, std::size_t first, std::size_t multiplicity, Sink & sink);
+            template<typename Sink>
+            void closeTrigger(Sink & sink);
+            template<typename Sink>
+            void closeCluster(Sink & sink);
+
+        public:
+            coincidenceMatcher(mode mode, std::uint64_t window, std::size_t minMultiplicity = 1);
+
+            // Feed the next event of the time ordered stream, completed groups are passed to the sink (callable with const coincidence &)
+            template<typename Sink>
+            void push(const timedEvent & event, Sink && sink);
+            // Close all the open windows at the end of the stream
+            template<typename Sink>
+            void flush(Sink && sink);
+
+            static bool isTrigger(const timedEvent & event);
+
+            std::uint64_t getGroupCount() const;
+            std::uint64_t getMatchedHits() const;
+            std::uint64_t getProcessedEvents() const;
+            // Number of events dropped because they broke the time order of the stream
+            std::uint64_t getUnorderedEvents() const;
+    };
+
+    inline bool coincidenceMatcher::isTrigger(const timedEvent & event){
+        return (event.rawData >> 60) == static_cast<std::uint64_t>(eventPacket::channel::TRIGGER);
+    }
+
+    template<typename Sink>
+    void coincidenceMatcher::emitGroup(const timedEvent * trigger, std::size_t first, std::size_t multiplicity, Sink & sink){
+        std::size_t count = hits_.size() - first;
+        if(multiplicity < minMultiplicity_) return;
+
+        groupCounter_++;
+        matchedHits_ += count;
+        sink(coincidence{trigger, hits_.data() + first, count});
+    }
+
+    template<typename Sink>
+    void coincidenceMatcher::closeTrigger(Sink & sink){
+        const timedEvent & trigger = triggers_[triggersHead_];
+
+        //Hits are pruned against the oldest open trigger, which is this one, only its lower edge has to be found
+        std::size_t first = hitsHead_;
+        while(first < hits_.size() && hits_[first].timestamp + window_ < trigger.timestamp) first++;
+        emitGroup(&trigger, first, hits_.size() - first, sink);
+
+        if(++triggersHead_ == triggers_.size()){
+            triggers_.clear();
+            triggersHead_ = 0;
+        }else if(triggersHead_ > 64 && triggersHead_ * 2 > triggers_.size()){
+            triggers_.erase(triggers_.begin(), triggers_.begin() + triggersHead_);
+            triggersHead_ = 0;
+        }
+    }
+
+    template<typename Sink>
+    void coincidenceMatcher::closeCluster(Sink & sink){
+        emitGroup(nullptr, hitsHead_, clusterMultiplicity_, sink);
+
+        //Only the bits of the cluster hits were set
+        for(std::size_t idx = hitsHead_; idx < hits_.size(); idx++){
+            std::size_t bit = (std::size_t)hits_[idx].lane * 16 + (hits_[idx].rawData >> 60);
+            clusterChannels_[bit / 64] = 0;
+        }
+
+        hits_.clear();
+        hitsHead_ = 0;
+        clusterMultiplicity_ = 0;
+    }
+
+    /// @brief Feed the next event of the time ordered stream
+    /// @param event Event with its global timestamp
+    /// @param sink Callable receiving the completed groups (const coincidence &)
+    template<typename Sink>
+    void coincidenceMatcher::push(const timedEvent & event, Sink && sink){
+        if(event.timestamp < lastTimestamp_){
+            unorderedEvents_++;
+            return;
+        }
+        lastTimestamp_ = event.timestamp;
+        processedEvents_++;
+
+        if(mode_ == mode::cluster){
+            if(isTrigger(event)) return;
+
+            //The event lies past the window of the first hit of the group, the group is complete
+            if(hitsHead_ < hits_.size() && event.timestamp > hits_[hitsHead_].timestamp + window_) closeCluster(sink);
+
+            hits_.push_back(event);
+            clusterMultiplicity_ += markChannel(event);
+            return;
+        }
+
+        //Close the windows the stream has passed, before the new event could be added to them
+        while(triggersHead_ < triggers_.size() && triggers_[triggersHead_].timestamp + window_ < event.timestamp){
+            closeTrigger(sink);
+        }
+
+        if(isTrigger(event)) triggers_.push_back(event);
+        else hits_.push_back(event);
+
+        //No open or future window reaches before the oldest open trigger (or the current time)
+        std::uint64_t oldest = triggersHead_ < triggers_.size() ? triggers_[triggersHead_].timestamp : event.timestamp;
+        if(oldest > window_) dropHits(oldest - window_);
+    }
+
+    /// @brief Close all the open windows
+    /// @param sink Callable receiving the completed groups (const coincidence &)
+    template<typename Sink>
+    void coincidenceMatcher::flush(Sink && sink){
+        if(mode_ == mode::cluster){
+            if(hitsHead_ < hits_.size()) closeCluster(sink);
+        }else{
+            while(triggersHead_ < triggers_.size()) closeTrigger(sink);
+        }
+
+        hits_.clear();
+        hitsHead_ = 0;
+    }
+}
+
+#endif
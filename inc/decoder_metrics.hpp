@@ -0,0 +1,68 @@
+#ifndef DECODER_METRICS_H
+#define DECODER_METRICS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include "metrics.hpp"
+
+namespace fastic{
+
+    //Parity checks of the event packets and timing of their decoding
+    class decoderMetrics
+    {
+        public:
+            //Parity checks of an event packet, bit i of a parity error mask is set if the check i failed
+            enum class field{
+                channel,
+                type,
+                timestamp,
+                pulseWidth,
+                combined,
+                count
+            };
+
+            //Counts of one decode call, published at its end
+            struct parityCounts {
+                std::uint64_t events = 0;
+                std::uint64_t invalidEvents = 0;
+                std::array<std::uint64_t, static_cast<std::size_t>(field::count)> fields = {};
+
+                // Account one event with its parity error mask
+                void add(std::uint8_t parityErrors);
+            };
+
+        private:
+            std::atomic<std::uint64_t> events_{0};
+            std::atomic<std::uint64_t> invalidEvents_{0};
+            std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(field::count)> parityErrors_ = {};
+            aurora::stageTiming decode_;
+
+        public:
+            decoderMetrics() = default;
+            decoderMetrics(const decoderMetrics & other);
+            decoderMetrics & operator=(const decoderMetrics & other);
+
+            void add(const parityCounts & counts);
+            void addDecode(std::uint64_t ticks, std::uint64_t events);
+
+            std::uint64_t getEvents() const;
+            // Number of events with at least one failed parity check
+            std::uint64_t getInvalidEvents() const;
+            std::uint64_t getParityErrors(field field) const;
+            const aurora::stageTiming & getDecodeTiming() const;
+    };
+
+    inline void decoderMetrics::parityCounts::add(std::uint8_t parityErrors){
+        events++;
+        if(!parityErrors) return;
+
+        invalidEvents++;
+        for(std::size_t idx = 0; idx < fields.size(); idx++){
+            fields[idx] += (parityErrors >> idx) & 1;
+        }
+    }
+}
+
+#endif
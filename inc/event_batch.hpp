@@ -0,0 +1,69 @@
+#ifndef EVENT_BATCH_H
+#define EVENT_BATCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "fastic.hpp"
+#include "decoder_metrics.hpp"
+
+namespace fastic{
+
+    /*
+        Structure of arrays batch of event packets
+
+        The raw 64bit data words are decoded column by column, every field of the event
+        packet (see fastic.hpp for the layout) gets its own array, the result of all the
+        parity checks of an event is kept as one bit of the parityOk bitmap and its debug
+        flag as one bit of the debug bitmap.
+        The columns only grow, so decoding into a cleared batch of sufficient capacity
+        does not allocate.
+    */
+    class eventBatch
+    {
+        private:
+            std::vector<std::uint8_t> channel_;
+            std::vector<std::uint8_t> type_;
+            std::vector<std::uint32_t> timestamp_;
+            std::vector<std::uint16_t> pulseWidth_;
+            std::vector<std::uint64_t> parityOk_;      //Bit (i % 64) of word (i / 64) is set if all the parities of event i are valid
+            std::vector<std::uint64_t> debug_;         //Bit (i % 64) of word (i / 64) is the debug flag of event i
+            std::size_t size_ = 0;
+            decoderMetrics * metrics_ = nullptr;
+
+            void resize(std::size_t size);
+
+        public:
+            // Decode the raw data words and append them to the batch
+            void decode(const std::uint64_t * rawData, std::size_t count);
+            // Encode count events starting at first back to raw data words with all the parities filled in
+            void encode(std::size_t first, std::size_t count, std::uint64_t * rawData) const;
+
+            void clear();
+            // Account the decoded events and their failed parity checks in metrics (nullptr to stop)
+            void setMetrics(decoderMetrics * metrics);
+            void reserve(std::size_t capacity);
+            std::size_t size() const;
+
+            const std::uint8_t * getChannels() const;
+            const std::uint8_t * getTypes() const;
+            const std::uint32_t * getTimestamps() const;
+            const std::uint16_t * getPulseWidths() const;
+            const std::uint64_t * getParityBitmap() const;
+            const std::uint64_t * getDebugBitmap() const;
+
+            eventPacket::channel getChannel(std::size_t index) const;
+            eventPacket::type getType(std::size_t index) const;
+            std::uint32_t getTimestamp(std::size_t index) const;
+            std::uint16_t getPulseWidth(std::size_t index) const;
+            bool hasValidParity(std::size_t index) const;
+            bool getDebugBit(std::size_t index) const;
+
+            // Check all the parities of a raw event packet at once, same result as all the checks of eventPacket together
+            static bool checkParity(std::uint64_t rawData);
+            // Check the parities of a raw event packet one by one, bit i is set if the check decoderMetrics::field i failed
+            static std::uint8_t checkParityFields(std::uint64_t rawData);
+    };
+}
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef EVENT_FILE_H
+#define EVENT_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+#include "fastic.hpp"
+#include "event_batch.hpp"
+#include "time_reconstruction.hpp"
+
+namespace fastic{
+
+    /*
+        EVENT FILE STRUCTURE
+        All the values are little endian, every section starts 8 byte aligned
+
+        FILE HEADER (64 bytes)
+            [0:7]    MAGIC           - "FASTICEV"
+            [8:11]   VERSION         - Format version (eventFile::version)
+            [12:15]  HEADER SIZE     - Size of the file header in bytes
+            [16:63]  RESERVED
+
+        CHUNK (repeated until the end of the file)
+            CHUNK HEADER (40 bytes)
+            [0:3]    MAGIC           - "CHNK"
+            [4:7]    EVENT COUNT
+            [8:11]   STAT COUNT      - Number of statistics records
+            [12]     DELTA BITS      - Width of one packed timestamp delta
+            [16:23]  FIRST TIMESTAMP - Global timestamp of the first event of the chunk
+            [24:31]  LAST TIMESTAMP  - Global timestamp of the last event of the chunk
+            [32:39]  CHUNK SIZE      - Size of the whole chunk including the header in bytes
+
+            TIMESTAMPS  - Zigzag encoded differences of consecutive timestamps (the first one is 0),
+                          DELTA BITS each, packed LSB first into 64bit words
+            FIELDS      - One 32bit word per event:
+                          [0:3] channel, [4:5] type, [6:19] pulse width, [20] debug, [21] parity ok, [22:31] lane (0 - 1023)
+            STATISTICS  - STAT COUNT statisticsRecord structures
+    */
+
+    namespace eventFile{
+        constexpr std::uint32_t version = 1;
+        constexpr std::size_t defaultChunkEvents = 65536;
+        //Highest lane number the field word can hold
+        constexpr std::uint16_t maxLane = 0x3FF;
+
+        struct fileHeader {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t headerSize;
+            std::uint64_t reserved[6];
+        };
+
+        struct chunkHeader {
+            char magic[4];
+            std::uint32_t eventCount;
+            std::uint32_t statisticsCount;
+            std::uint8_t deltaBits;
+            std::uint8_t reserved[3];
+            std::uint64_t firstTimestamp;
+            std::uint64_t lastTimestamp;
+            std::uint64_t chunkSize;
+        };
+
+        struct statisticsRecord {
+            std::uint64_t timestamp;
+            std::uint32_t fifoDrop;
+            std::uint32_t pulseWidthDrop;
+            std::uint32_t darkCountDrop;
+            std::uint32_t triggerDrop;
+            std::uint16_t pulseError;
+            std::uint16_t lane;
+            std::uint32_t reserved;
+        };
+
+        static_assert(sizeof(fileHeader) == 64, "Unexpected event file header size");
+        static_assert(sizeof(chunkHeader) == 40, "Unexpected event file chunk header size");
+        static_assert(sizeof(statisticsRecord) == 32, "Unexpected statistics record size");
+
+        //Decoded event of the file
+        struct storedEvent {
+            std::uint64_t timestamp;
+            std::uint8_t channel;
+            std::uint8_t type;
+            std::uint16_t pulseWidth;
+            std::uint16_t lane;
+            bool debug;
+            bool parityOk;
+        };
+
+        // Pack the decoded fields of an event into the 32bit field word
+        inline std::uint32_t packFields(std::uint8_t channel, std::uint8_t type, std::uint16_t pulseWidth, bool debug, bool parityOk, std::uint16_t lane){
+            return (std::uint32_t)(channel & 0x0F) | ((std::uint32_t)(type & 0x03) << 4) | ((std::uint32_t)(pulseWidth & 0x3FFF) << 6)
+                 | ((std::uint32_t)debug << 20) | ((std::uint32_t)parityOk << 21) | ((std::uint32_t)(lane & 0x3FF) << 22);
+        }
+
+        inline std::uint8_t getChannel(std::uint32_t fields){ return fields & 0x0F; }
+        inline std::uint8_t getType(std::uint32_t fields){ return (fields >> 4) & 0x03; }
+        inline std::uint16_t getPulseWidth(std::uint32_t fields){ return (fields >> 6) & 0x3FFF; }
+        inline bool getDebugBit(std::uint32_t fields){ return (fields >> 20) & 1; }
+        inline bool getParityOk(std::uint32_t fields){ return (fields >> 21) & 1; }
+        inline std::uint16_t getLane(std::uint32_t fields){ return fields >> 22; }
+    }
+
+    /*
+        Streaming writer of the event files
+
+        The events are collected column by column into the current chunk which is encoded
+        and written with a single write call once it holds chunkEvents events.
+    */
+    class eventFileWriter
+    {
+        private:
+            int fd_ = -1;
+            std::size_t chunkEvents_;
+
+            std::vector<std::uint64_t> timestamps_;
+            std::vector<std::uint32_t> fields_;
+            std::vector<eventFile::statisticsRecord> statistics_;
+            std::vector<std::uint64_t> chunkBuffer_;        //Encoded chunk, 64bit words keep every section aligned
+
+            std::uint64_t writtenEvents_ = 0;
+            std::uint64_t writtenChunks_ = 0;
+
+            bool writeAll(const void * data, std::size_t size);
+
+        public:
+            eventFileWriter(std::size_t chunkEvents = eventFile::defaultChunkEvents);
+            ~eventFileWriter();
+
+            eventFileWriter(const eventFileWriter &) = delete;
+            eventFileWriter & operator=(const eventFileWriter &) = delete;
+
+            // Create (or truncate) the file and write its header
+            bool open(const std::string & path);
+            // Write the pending chunk and close the file
+            bool close();
+            bool isOpen() const;
+
+            // Append one event given by its raw data word, events of lanes above eventFile::maxLane are rejected
+            bool write(const timedEvent & event);
+            // Append a decoded batch of events of one lane with their global timestamps
+            bool write(const eventBatch & batch, const std::uint64_t * globalTimestamps, std::uint16_t lane);
+            // Append a statistics record
+            bool write(const eventFile::statisticsRecord & record);
+            // Append a statistics packet received on the lane at the given global time
+            bool write(const statisticsPacket & packet, std::uint64_t timestamp, std::uint16_t lane);
+
+            // Encode and write the pending events as one chunk
+            bool flush();
+
+            std::uint64_t getWrittenEvents() const;
+            std::uint64_t getWrittenChunks() const;
+    };
+
+    //View of one chunk of a memory mapped event file, valid as long as the reader is open
+    class eventChunk
+    {
+        private:
+            const eventFile::chunkHeader * header_ = nullptr;
+            const std::uint64_t * timestamps_ = nullptr;
+            const std::uint32_t * fields_ = nullptr;
+            const eventFile::statisticsRecord * statistics_ = nullptr;
+
+            friend class eventFileReader;
+
+        public:
+            std::size_t getEventCount() const;
+            std::size_t getStatisticsCount() const;
+            std::uint64_t getFirstTimestamp() const;
+            std::uint64_t getLastTimestamp() const;
+
+            // Packed field words of the events, directly in the mapped file
+            const std::uint32_t * getFields() const;
+            const eventFile::statisticsRecord * getStatistics() const;
+
+            // Decode the timestamp column into the array (of getEventCount() elements)
+            void decodeTimestamps(std::uint64_t * timestamps) const;
+
+            // Pass every event of the chunk to the sink (callable with const eventFile::storedEvent &)
+            template<typename Sink>
+            void forEachEvent(Sink && sink) const;
+    };
+
+    /*
+        Memory mapped reader of the event files
+
+        Only the chunk headers are touched when iterating the chunks, the columns are read
+        straight from the mapping when the events of a chunk are accessed.
+    */
+    class eventFileReader
+    {
+        private:
+            int fd_ = -1;
+            const std::uint8_t * map_ = nullptr;
+            std::size_t size_ = 0;
+            std::size_t offset_ = 0;
+
+        public:
+            eventFileReader() = default;
+            ~eventFileReader();
+
+            eventFileReader(const eventFileReader &) = delete;
+            eventFileReader & operator=(const eventFileReader &) = delete;
+
+            // Map the file and validate its header
+            bool open(const std::string & path);
+            void close();
+            bool isOpen() const;
+
+            // Move to the next chunk, returns false at the end of the file or on a malformed chunk
+            bool nextChunk(eventChunk & chunk);
+            // Start the chunk iteration from the beginning
+            void rewind();
+
+            // Pass every event of the file to the sink (callable with const eventFile::storedEvent &), returns the number of events
+            template<typename Sink>
+            std::uint64_t forEachEvent(Sink && sink);
+    };
+
+    template<typename Sink>
+    void eventChunk::forEachEvent(Sink && sink) const{
+        std::uint32_t width = header_->deltaBits;
+        std::uint64_t mask = width == 64 ? ~(std::uint64_t)0 : ((std::uint64_t)1 << width) - 1;
+        std::uint64_t timestamp = header_->firstTimestamp;
+        std::size_t bitPosition = 0;
+
+        for(std::size_t idx = 0; idx < header_->eventCount; idx++, bitPosition += width){
+            if(width){
+                std::size_t word = bitPosition / 64, offset = bitPosition % 64;
+                std::uint64_t packed = timestamps_[word] >> offset;
+                if(offset + width > 64) packed |= timestamps_[word + 1] << (64 - offset);
+                packed &= mask;
+                //Zigzag decode the difference
+                timestamp += (packed >> 1) ^ (~(packed & 1) + 1);
+            }
+
+            std::uint32_t fields = fields_[idx];
+            sink(eventFile::storedEvent{timestamp, eventFile::getChannel(fields), eventFile::getType(fields), eventFile::getPulseWidth(fields),
+                                        eventFile::getLane(fields), eventFile::getDebugBit(fields), eventFile::getParityOk(fields)});
+        }
+    }
+
+    template<typename Sink>
+    std::uint64_t eventFileReader::forEachEvent(Sink && sink){
+        std::uint64_t events = 0;
+        eventChunk chunk;
+
+        rewind();
+        while(nextChunk(chunk)){
+            chunk.forEachEvent(sink);
+            events += chunk.getEventCount();
+        }
+
+        return events;
+    }
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef EVENT_FILTER_H
+#define EVENT_FILTER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include "fastic.hpp"
+
+namespace fastic{
+
+    /*
+        Filter of the raw event packet words
+
+        The criteria are checked on the raw (descrambled) 64bit data words before any field
+        of an event is extracted, four words at a time with AVX2. Every criterion gives a
+        reject mask, the words passing all of them are compacted in order to the output, so
+        the later stages (eventBatch::decode, the event queues) only see the survivors.
+        A pulse width window starting at 1 suppresses the empty (zero ToT) events.
+
+        The reject counters count every criterion on its own, an event failing two of them
+        is counted by both. They are single writer counters (see metrics.hpp), readable from
+        any other thread while the filter runs.
+    */
+    class eventFilter
+    {
+        public:
+            enum class parityPolicy{
+                accept,         //Keep the events regardless of their parity
+                rejectInvalid,  //Drop the events with any failed parity check
+                keepInvalid     //Keep only the events with a failed parity check (link diagnostics)
+            };
+
+            enum class criterion{
+                channel,        //Channel not in the channel mask
+                type,           //Type not in the type mask
+                pulseWidth,     //Pulse width outside the window
+                parity,         //Parity not matching the parity policy
+                debug,          //Debug flag set while the debug events are rejected
+                count
+            };
+
+            static constexpr std::size_t criterionCount = static_cast<std::size_t>(criterion::count);
+            //Words filtered at once by forward, the survivors of a block stay in L1
+            static constexpr std::size_t blockSize = 256;
+
+            struct config {
+                std::uint16_t channels = 0xFFFF;            //Bit i keeps channel i (CH0 - CH7 are bits 0 - 7, TRIGGER bit 8)
+                std::uint8_t types = 0x0F;                  //Bit i keeps type i (see eventPacket::type)
+                std::uint16_t minPulseWidth = 0;            //Inclusive pulse width window
+                std::uint16_t maxPulseWidth = 0x3FFF;
+                parityPolicy parity = parityPolicy::accept;
+                bool rejectDebug = false;
+            };
+
+        private:
+            config config_;
+            bool passThrough_;                          //Signal if the configuration keeps every event
+
+            std::atomic<std::uint64_t> events_{0};
+            std::atomic<std::uint64_t> accepted_{0};
+            std::array<std::atomic<std::uint64_t>, criterionCount> rejects_ = {};
+
+        public:
+            eventFilter();
+            eventFilter(const config & config);
+
+            // Filter count raw words into survivors (rawData itself or a buffer of count words), returns the number of survivors
+            std::size_t apply(const std::uint64_t * rawData, std::size_t count, std::uint64_t * survivors);
+            // Filter count raw words block by block and pass the survivors of every block to sink(const std::uint64_t *, std::size_t)
+            template<typename Sink>
+            void forward(const std::uint64_t * rawData, std::size_t count, Sink && sink);
+            // Check a single raw word, not accounted in the counters
+            bool accepts(std::uint64_t rawData) const;
+
+            const config & getConfig() const;
+            std::uint64_t getEvents() const;
+            std::uint64_t getAccepted() const;
+            // Number of events rejected by the criterion (events failing several criteria are counted by each)
+            std::uint64_t getRejects(criterion criterion) const;
+    };
+
+    template<typename Sink>
+    void eventFilter::forward(const std::uint64_t * rawData, std::size_t count, Sink && sink){
+        if(passThrough_){
+            aurora::addCounter(events_, count);
+            aurora::addCounter(accepted_, count);
+            if(count) sink(rawData, count);
+            return;
+        }
+
+        alignas(64) std::uint64_t survivors[blockSize];
+
+        for(std::size_t offset = 0; offset < count; offset += blockSize){
+            std::size_t kept = apply(rawData + offset, std::min(blockSize, count - offset), survivors);
+            if(kept) sink(static_cast<const std::uint64_t *>(survivors), kept);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef EVENT_PARITY_H
+#define EVENT_PARITY_H
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace fastic{
+
+    /*
+        Parity checks of the raw event packet words shared by the decoders
+
+        Every field together with its parity bit has to have even parity, the masks select
+        the bits of one check. The vector variant checks four words at once.
+    */
+    namespace eventParity{
+        constexpr std::uint64_t channelMask    = 0xF000000000000010;
+        constexpr std::uint64_t typeMask       = 0x0C00000000000008;
+        constexpr std::uint64_t timestampMask  = 0x000003FFFFF00004;
+        constexpr std::uint64_t pulseWidthMask = 0x00000000000FFFC2;
+        constexpr std::uint64_t combinedMask   = 0xFC0003FFFFFFFFC1;
+
+        // Check all the parities at once, true if they are all valid
+        inline bool check(std::uint64_t rawData){
+            return !(__builtin_parityll(rawData & channelMask)
+                   | __builtin_parityll(rawData & typeMask)
+                   | __builtin_parityll(rawData & timestampMask)
+                   | __builtin_parityll(rawData & pulseWidthMask)
+                   | __builtin_parityll(rawData & combinedMask));
+        }
+
+#if defined(__AVX2__)
+        //Flag the events with any invalid parity, the result is in bit 63 of every qword
+        inline __m256i errors(__m256i data){
+            //Prefix parity, bit k holds the parity of bits 0 - k (a carry-less multiplication by all ones)
+            __m256i prefix = _mm256_xor_si256(data, _mm256_slli_epi64(data, 1));
+            prefix = _mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 2));
+            prefix = _mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 4));
+            prefix = _mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 8));
+            prefix = _mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 16));
+            prefix = _mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 32));
+
+            //The parity of the field spanning bits a - b is prefix[b] ^ prefix[a - 1], align all of them to bit 63
+            __m256i prefix59 = _mm256_slli_epi64(prefix, 4);
+            __m256i prefix57 = _mm256_slli_epi64(prefix, 6);
+            __m256i prefix41 = _mm256_slli_epi64(prefix, 22);
+            __m256i prefix19 = _mm256_slli_epi64(prefix, 44);
+            __m256i prefix5  = _mm256_slli_epi64(prefix, 58);
+
+            __m256i channelError    = _mm256_xor_si256(_mm256_xor_si256(prefix, prefix59), _mm256_slli_epi64(data, 59));
+            __m256i typeError       = _mm256_xor_si256(_mm256_xor_si256(prefix59, prefix57), _mm256_slli_epi64(data, 60));
+            __m256i timestampError  = _mm256_xor_si256(_mm256_xor_si256(prefix41, prefix19), _mm256_slli_epi64(data, 61));
+            __m256i pulseWidthError = _mm256_xor_si256(_mm256_xor_si256(prefix19, prefix5), _mm256_slli_epi64(data, 62));
+            __m256i combinedError   = _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(prefix, prefix57), _mm256_xor_si256(prefix41, prefix5)), _mm256_slli_epi64(data, 63));
+
+            return _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(channelError, typeError), _mm256_or_si256(timestampError, pulseWidthError)), combinedError);
+        }
+#endif
+    }
+}
+
+#endif
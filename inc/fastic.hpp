@@ -38,6 +38,10 @@ namespace fastic{
         [40:59] DCOUNT DROP  - Number of dark count drops (only in High-Energy res mode)
         [60:79] TRIGGER DROP - Number of packets dropped due to malformed trigger pulse
         [80:95] PULSE ERROR  - Malformed pulse counter (malformed = too many edges per clock period)
+
+        The packet is split into two halves of 48 bits sent in the low bits of two consecutive
+        statistics control frames, bits [0:47] in a User K-Block 1 and bits [48:95] in a User
+        K-Block 2. All the counters are free running and wrap at their width.
     */
 
     /*
@@ -101,8 +105,12 @@ namespace fastic{
 
         public:
             eventPacket(aurora::dataPacket packet);
+            // Build the packet from its fields with all the parities filled in
             eventPacket(type type, channel channel, std::uint32_t timestamp, std::uint16_t pulseWidth);
-            
+
+            // Data frame payload of the packet
+            aurora::dataPacket toDataPacket() const;
+
             channel getChannel(bool & isValid);
             type getType(bool & isValid);
             std::uint32_t getTimestamp(bool & isValid);
@@ -110,6 +118,8 @@ namespace fastic{
             bool getDebugBit();
 
             bool hasValidParity();
+            // Failed parity checks, bit i is set if the check decoderMetrics::field i failed
+            std::uint8_t getParityErrors();
 
     };
     
@@ -125,11 +135,47 @@ namespace fastic{
             std::uint16_t statPulseError_;
 
         public:
+            //The first half is sent in a User K-Block 1, the second one in a User K-Block 2
+            static constexpr aurora::packet::btf firstBlockType = aurora::packet::btf::k1;
+            static constexpr aurora::packet::btf secondBlockType = aurora::packet::btf::k2;
+
+            //Width of the drop counters and of the pulse error counter
+            static constexpr unsigned int dropCounterBits = 20;
+            static constexpr unsigned int pulseErrorBits = 16;
+
             statisticsPacket(std::array<aurora::controlPacket, 2> packets);
             statisticsPacket(std::uint32_t fifo, std::uint32_t pulsewidth, std::uint32_t darkcount, std::uint32_t trigger, std::uint16_t pulseError);
-            std::uint32_t getTimestamp();
-            std::uint16_t getPulseWidth();
+            // Control frame payloads of the two halves
+            std::array<aurora::controlPacket, 2> toControlPackets() const;
+            std::uint32_t getFifoDrop() const;
+            std::uint32_t getPulseWidthDrop() const;
+            std::uint32_t getDarkCountDrop() const;
+            std::uint32_t getTriggerDrop() const;
+            std::uint16_t getPulseError() const;
+    };
+
+    /*
+        Reassembly of the statistics packets from the stream of control packets
+
+        A statistics packet is complete once the second half follows the first one. A second
+        half without a preceding first one, or a first half followed by another first one,
+        is counted as incomplete and dropped. The other control packets are ignored.
+    */
+    class statisticsAssembler
+    {
+        private:
+            std::uint64_t firstHalf_ = 0;
+            bool hasFirstHalf_ = false;
+            std::uint64_t incompletePackets_ = 0;
+
+        public:
+            // Pass the next control packet, returns true once packet holds a complete statistics packet
+            bool push(const aurora::controlPacket & control, statisticsPacket & packet);
+            // Drop the pending first half (a new stream starts)
+            void reset();
 
+            // Number of halves dropped because the other half was missing
+            std::uint64_t getIncompletePackets() const;
     };
 
     //Extension counter packet declaration
@@ -142,10 +188,15 @@ namespace fastic{
             bool statReset_;
 
         public:
+            //Extension packets are sent in the User K-Block 0 control frames
+            static constexpr aurora::packet::btf blockType = aurora::packet::btf::k0;
+
             extensionPacket(aurora::controlPacket packet);
             extensionPacket(std::uint32_t packetCount, std::uint32_t coarseCounter, bool reset = false);
+            // Control frame payload of the packet (including the K0 block type)
+            aurora::controlPacket toControlPacket() const;
             std::uint32_t getPacketCount();
-            std::uint16_t getCoarseCounter();
+            std::uint32_t getCoarseCounter();
             bool getReset();
     };
 
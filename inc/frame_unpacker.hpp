@@ -0,0 +1,71 @@
+#ifndef FRAME_UNPACKER_H
+#define FRAME_UNPACKER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <utility>
+
+namespace aurora{
+
+    /*
+        Unpackers of whole frame periods
+
+        A frame is 66 bits long, so 16 frames take exactly 33 words and the position of the
+        frames within the words repeats with that period. The bit phase of the first frame
+        (its position modulo 32) stays the same for every period of a stream, the 66 bitslips
+        therefore map to 32 phases (bitslip s is phase s % 32 starting at word s / 32).
+        Every phase has its own unpacker with all the word indices, shifts and masks known
+        at compile time, the unpacker to use is looked up once the phase is known.
+    */
+
+    //Number of frames in one period and the words they occupy
+    constexpr std::size_t periodFrames = 16;
+    constexpr std::size_t periodWords = 33;
+    //Words the unpacker reads, the frames of the phases above 0 end in the word following the period
+    constexpr std::size_t periodReadWords = periodWords + 1;
+
+    // Unpack the sync header and the (scrambled) payload of one frame of the period
+    template<unsigned int Phase, unsigned int Frame>
+    inline void unpackFrame(const std::uint32_t * words, std::uint8_t * syncBits, std::uint64_t * data){
+        constexpr unsigned int bit = Phase + 66 * Frame;
+        constexpr unsigned int word = bit / 32;
+        constexpr unsigned int shift = bit % 32;
+
+        std::uint64_t high = ((std::uint64_t)words[word] << 32) | words[word + 1];
+        syncBits[Frame] = (high >> (62 - shift)) & 0x03;
+
+        if constexpr(shift <= 30){
+            data[Frame] = (high << (shift + 2)) | (words[word + 2] >> (30 - shift));
+        }else{
+            //The header ends on the last bit of the first word, the payload reaches into a fourth word
+            data[Frame] = (high << 33) | ((std::uint64_t)words[word + 2] << 1) | (words[word + 3] >> 31);
+        }
+    }
+
+    template<unsigned int Phase, std::size_t... Frames>
+    inline void unpackFrames(const std::uint32_t * words, std::uint8_t * syncBits, std::uint64_t * data, std::index_sequence<Frames...>){
+        (unpackFrame<Phase, Frames>(words, syncBits, data), ...);
+    }
+
+    /// @brief Unpack the 16 frames of a period
+    /// @param words Pointer to the word holding the first bit of the period
+    /// @param syncBits Output of the 16 sync headers
+    /// @param data Output of the 16 scrambled payloads
+    template<unsigned int Phase>
+    void unpackFramePeriod(const std::uint32_t * words, std::uint8_t * syncBits, std::uint64_t * data){
+        unpackFrames<Phase>(words, syncBits, data, std::make_index_sequence<periodFrames>{});
+    }
+
+    using framePeriodUnpacker = void (*)(const std::uint32_t * words, std::uint8_t * syncBits, std::uint64_t * data);
+
+    template<std::size_t... Phases>
+    constexpr std::array<framePeriodUnpacker, sizeof...(Phases)> makeFramePeriodUnpackers(std::index_sequence<Phases...>){
+        return {{&unpackFramePeriod<Phases>...}};
+    }
+
+    //Unpacker of every phase (bit position of the period modulo 32)
+    inline constexpr std::array<framePeriodUnpacker, 32> framePeriodUnpackers = makeFramePeriodUnpackers(std::make_index_sequence<32>{});
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include "fastic.hpp"
+#include "event_batch.hpp"
+
+namespace fastic{
+
+    /*
+        Online calibration histograms of the decoded event stream
+
+        Every channel (CH0 - CH7 and TRIGGER) gets a full 14 bit pulse width histogram per
+        event type and a histogram of 1024 fine ToA bins (bits toaShift - toaShift + 9 of the
+        timestamp). The channel codes above TRIGGER are collected in one extra slot.
+
+        Each thread fills its own accumulator, a cache line aligned block of 32bit bins with
+        a single writer, so a bin update is a plain load and store (see metrics.hpp). The
+        snapshot sums the bins of all the accumulators with relaxed loads while the writers
+        keep running, every bin is exact at the moment it is read, the whole snapshot is
+        consistent once the writers stop. A single bin of one accumulator wraps after 2^32
+        counts. The histograms count every event passed in, put an eventFilter in front to
+        keep the ones with invalid parity out.
+    */
+    class eventHistograms
+    {
+        public:
+            static constexpr std::size_t channelCount = 9;                  //CH0 - CH7 and TRIGGER
+            static constexpr std::size_t slotCount = channelCount + 1;      //The last slot collects the invalid channel codes
+            static constexpr std::size_t typeCount = 4;
+            static constexpr unsigned int pulseWidthBits = 14;
+            static constexpr std::size_t pulseWidthBins = (std::size_t)1 << pulseWidthBits;
+            static constexpr unsigned int toaBits = 10;
+            static constexpr std::size_t toaBins = (std::size_t)1 << toaBits;
+            //Largest ToA shift which keeps all the fine bins inside the 22 bit timestamp
+            static constexpr unsigned int maxToaShift = 22 - toaBits;
+
+            //Bins of one thread
+            class alignas(64) accumulator
+            {
+                friend class eventHistograms;
+
+                private:
+                    //Indices of the events processed at once by the bulk update
+                    static constexpr std::size_t blockSize = 256;
+
+                    unsigned int toaShift_;
+                    std::atomic<std::uint64_t> events_{0};
+                    std::atomic<std::uint32_t> pulseWidth_[slotCount * typeCount * pulseWidthBins];
+                    std::atomic<std::uint32_t> toa_[slotCount * toaBins];
+
+                    void increment(const std::uint32_t * pulseWidthIndices, const std::uint32_t * toaIndices, std::size_t count);
+
+                public:
+                    accumulator(unsigned int toaShift);
+
+                    accumulator(const accumulator &) = delete;
+                    accumulator & operator=(const accumulator &) = delete;
+
+                    // Account one raw event word
+                    void add(std::uint64_t rawData);
+                    // Account a run of raw event words (for example a feedPayloads data run), vectorized with AVX2
+                    void add(const std::uint64_t * rawData, std::size_t count);
+                    // Account all the events of a decoded batch
+                    void add(const eventBatch & batch);
+                    // Clear the bins, only from the writing thread
+                    void clear();
+
+                    std::uint64_t getEvents() const;
+            };
+
+            //Sum of all the accumulators
+            struct snapshot {
+                std::vector<std::uint64_t> pulseWidth;      //[slot][type][pulse width]
+                std::vector<std::uint64_t> toa;             //[slot][fine ToA]
+                std::uint64_t events = 0;
+                unsigned int toaShift = 0;
+
+                // Pulse width histogram of the channel and type, pulseWidthBins bins
+                const std::uint64_t * getPulseWidth(eventPacket::channel channel, eventPacket::type type) const;
+                // Fine ToA histogram of the channel, toaBins bins
+                const std::uint64_t * getToa(eventPacket::channel channel) const;
+                // Number of events of the channel (all the types)
+                std::uint64_t getChannelEvents(eventPacket::channel channel) const;
+                // Number of events with a channel code above TRIGGER
+                std::uint64_t getInvalidChannelEvents() const;
+            };
+
+        private:
+            unsigned int toaShift_;
+            std::vector<std::unique_ptr<accumulator>> accumulators_;
+
+        public:
+            eventHistograms(std::size_t accumulatorCount, unsigned int toaShift = 0);
+
+            // Accumulator of one writing thread (for example multiRx worker index)
+            accumulator & getAccumulator(std::size_t index);
+            std::size_t getAccumulatorCount() const;
+
+            // Merge the accumulators, callable from any thread while they are written
+            snapshot getSnapshot() const;
+            // Clear all the accumulators, only while none of them is written
+            void clear();
+
+            // Bin indices of a raw event word (the channel codes above TRIGGER map to the last slot)
+            static std::uint32_t pulseWidthIndex(std::uint64_t rawData);
+            static std::uint32_t toaIndex(std::uint64_t rawData, unsigned int toaShift);
+    };
+
+    inline std::uint32_t eventHistograms::pulseWidthIndex(std::uint64_t rawData){
+        //Channel and type are the top 6 bits, the invalid channel codes are clamped to the last slot (its type is lost)
+        std::uint32_t channelType = std::min<std::uint32_t>(rawData >> 58, slotCount * typeCount - 1);
+        return (channelType << pulseWidthBits) | ((rawData >> 6) & (pulseWidthBins - 1));
+    }
+
+    inline std::uint32_t eventHistograms::toaIndex(std::uint64_t rawData, unsigned int toaShift){
+        std::uint32_t slot = std::min<std::uint32_t>(rawData >> 60, slotCount - 1);
+        return (slot << toaBits) | ((rawData >> (20 + toaShift)) & (toaBins - 1));
+    }
+
+    inline void eventHistograms::accumulator::add(std::uint64_t rawData){
+        std::atomic<std::uint32_t> & pulseWidthBin = pulseWidth_[pulseWidthIndex(rawData)];
+        std::atomic<std::uint32_t> & toaBin = toa_[toaIndex(rawData, toaShift_)];
+
+        pulseWidthBin.store(pulseWidthBin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        toaBin.store(toaBin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        aurora::addCounter(events_, 1);
+    }
+}
+
+#endif
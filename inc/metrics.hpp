@@ -0,0 +1,170 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace aurora{
+
+    /*
+        Hot path counters
+
+        Every counter has a single writer (the thread decoding the stream), so it is updated
+        with a relaxed load and store instead of a locked read-modify-write and can be read
+        from any other thread at any time without stopping the decoding. The decoders collect
+        the counts of a whole call in plain local variables and publish them once at its end.
+
+        The metrics can be copied (with the receiver or the decoder holding them) while no other
+        thread writes them, the copy takes the values of the counters at that moment.
+    */
+
+    // Add to a counter which only the calling thread writes
+    inline void addCounter(std::atomic<std::uint64_t> & counter, std::uint64_t value){
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    // Copy a counter which no thread writes during the copy
+    inline void copyCounter(std::atomic<std::uint64_t> & counter, const std::atomic<std::uint64_t> & other){
+        counter.store(other.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // Timestamp for the stage timing, TSC cycles (rdtsc) on x86, nanoseconds elsewhere
+    inline std::uint64_t readTicks(){
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Number of ticks of readTicks per nanosecond, calibrated against the steady clock on the first call on x86, 1 elsewhere
+    double getTicksPerNanosecond();
+
+    // Convert a duration in ticks of readTicks to nanoseconds
+    inline double ticksToNanoseconds(std::uint64_t ticks){
+        return ticks / getTicksPerNanosecond();
+    }
+
+    //Time spent in one stage of the pipeline
+    class stageTiming
+    {
+        private:
+            std::atomic<std::uint64_t> ticks_{0};
+            std::atomic<std::uint64_t> calls_{0};
+            std::atomic<std::uint64_t> items_{0};
+
+        public:
+            stageTiming() = default;
+            stageTiming(const stageTiming & other);
+            stageTiming & operator=(const stageTiming & other);
+
+            // Account one call of the stage which processed the given number of items (frames, events)
+            void add(std::uint64_t ticks, std::uint64_t items);
+            // Add the calls of another stage, which is no longer written
+            void merge(const stageTiming & other);
+
+            // Time spent in the stage in ticks of readTicks (TSC cycles on x86, nanoseconds elsewhere)
+            std::uint64_t getTicks() const;
+            std::uint64_t getCalls() const;
+            std::uint64_t getItems() const;
+            // Average ticks of readTicks per processed item
+            double getTicksPerItem() const;
+            // Time spent in the stage in nanoseconds
+            double getNanoseconds() const;
+            // Average nanoseconds per processed item
+            double getNanosecondsPerItem() const;
+    };
+
+    //Counts of one decode call, published to rxMetrics at its end
+    struct decodeCounts {
+        std::uint64_t frames = 0;
+        std::uint64_t dataFrames = 0;
+        std::uint64_t controlFrames = 0;
+        std::uint64_t headerErrors = 0;
+        std::array<std::uint32_t, 16> blockTypes = {};
+    };
+
+    //Link health and timing of one aurora::rx
+    class rxMetrics
+    {
+        public:
+            //Every known block type field has its own counter, the unknown ones share the last one
+            static constexpr std::size_t blockTypeCount = 16;
+
+            enum class stage{
+                sync,       //Alignment acquisition (synchronize and relock)
+                decode,     //Frame extraction, lock monitoring and descrambling, including the sink
+                count
+            };
+
+        private:
+            std::atomic<std::uint64_t> frames_{0};
+            std::atomic<std::uint64_t> dataFrames_{0};
+            std::atomic<std::uint64_t> controlFrames_{0};
+            std::atomic<std::uint64_t> headerErrors_{0};
+            std::atomic<std::uint64_t> syncAttempts_{0};
+            std::atomic<std::uint64_t> syncFailures_{0};
+            std::atomic<std::uint64_t> relocks_{0};
+            std::array<std::atomic<std::uint64_t>, blockTypeCount> blockTypes_ = {};
+            std::array<stageTiming, static_cast<std::size_t>(stage::count)> stages_;
+
+        public:
+            rxMetrics() = default;
+            rxMetrics(const rxMetrics & other);
+            rxMetrics & operator=(const rxMetrics & other);
+
+            // Index of the counter of the block type field (the top byte of a descrambled control frame)
+            static std::size_t blockTypeIndex(std::uint8_t blockType);
+            // Block type field of the counter index (0 for the shared counter of the unknown types)
+            static std::uint8_t blockTypeOf(std::size_t index);
+
+            void add(const decodeCounts & counts);
+            void addSync(bool success, std::uint64_t ticks);
+            void addRelock();
+            void addStage(stage stage, std::uint64_t ticks, std::uint64_t items);
+            // Add all the counters of another receiver, which is no longer written (a chunk of a parallel decode)
+            void merge(const rxMetrics & other);
+
+            std::uint64_t getFrames() const;
+            std::uint64_t getDataFrames() const;
+            std::uint64_t getControlFrames() const;
+            std::uint64_t getHeaderErrors() const;
+            std::uint64_t getSyncAttempts() const;
+            std::uint64_t getSyncFailures() const;
+            std::uint64_t getRelocks() const;
+            std::uint64_t getBlockTypeCount(std::uint8_t blockType) const;
+            const stageTiming & getStage(stage stage) const;
+            // Fraction of the frames with an invalid sync header
+            double getHeaderErrorRate() const;
+    };
+
+    inline std::size_t rxMetrics::blockTypeIndex(std::uint8_t blockType){
+        switch(blockType){
+            case 0x78: return 0;    //Idle
+            case 0xaa: return 1;    //NFC
+            case 0x2d: return 2;    //UFC
+            case 0x1e: return 3;    //Separator
+            case 0xe1: return 4;    //Separator 7
+            case 0xd2: return 5;    //K0
+            case 0x99: return 6;    //K1
+            case 0x55: return 7;    //K2
+            case 0xb4: return 8;    //K3
+            case 0xcc: return 9;    //K4
+            case 0x66: return 10;   //K5
+            case 0x33: return 11;   //K6
+            case 0x4b: return 12;   //K7
+            case 0x87: return 13;   //K8
+            case 0xff: return 14;   //Reserved
+            default: return 15;
+        }
+    }
+}
+
+#endif
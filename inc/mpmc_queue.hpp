@@ -0,0 +1,146 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace aurora{
+
+    /*
+        Bounded lock-free queue for any number of producer and consumer threads.
+        Every slot carries a sequence number telling which turn of the ring it is ready for,
+        a producer claims the tail and a consumer the head with a compare-exchange and hands
+        the slot over by advancing its sequence (the Vyukov bounded queue). The capacity is
+        rounded up to a power of two.
+    */
+    template<typename T>
+    class mpmcQueue
+    {
+        private:
+            static constexpr std::size_t cacheLineSize_ = 64;
+
+            struct slot {
+                std::atomic<std::size_t> sequence;
+                T item;
+            };
+
+            std::size_t mask_;
+            slot * storage_;
+
+            alignas(cacheLineSize_) std::atomic<std::size_t> head_;
+            alignas(cacheLineSize_) std::atomic<std::size_t> tail_;
+
+        public:
+            explicit mpmcQueue(std::size_t capacity);
+            ~mpmcQueue();
+
+            mpmcQueue(const mpmcQueue &) = delete;
+            mpmcQueue & operator=(const mpmcQueue &) = delete;
+
+            // Append an item, returns false if the queue is full
+            template<typename U>
+            bool push(U && item);
+            // Remove the oldest item, returns false if the queue is empty
+            bool pop(T & item);
+
+            // Approximate number of queued items
+            std::size_t size() const;
+            std::size_t capacity() const;
+    };
+
+    template<typename T>
+    mpmcQueue<T>::mpmcQueue(std::size_t capacity) : head_(0), tail_(0)
+    {
+        std::size_t roundedCapacity = 1;
+        while(roundedCapacity < capacity) roundedCapacity <<= 1;
+
+        mask_ = roundedCapacity - 1;
+        storage_ = std::allocator<slot>().allocate(roundedCapacity);
+
+        //Slot i is ready for the producer of position i
+        for(std::size_t idx = 0; idx < roundedCapacity; idx++){
+            new (&storage_[idx].sequence) std::atomic<std::size_t>(idx);
+        }
+    }
+
+    template<typename T>
+    mpmcQueue<T>::~mpmcQueue(){
+        //Destroy the items which were never consumed
+        for(std::size_t idx = head_.load(std::memory_order_relaxed); idx != tail_.load(std::memory_order_relaxed); idx++){
+            storage_[idx & mask_].item.~T();
+        }
+
+        std::allocator<slot>().deallocate(storage_, mask_ + 1);
+    }
+
+    template<typename T>
+    template<typename U>
+    bool mpmcQueue<T>::push(U && item){
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        slot * target;
+
+        while(true){
+            target = &storage_[tail & mask_];
+            std::size_t sequence = target->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)tail;
+
+            if(difference == 0){
+                if(tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) break;
+            }else if(difference < 0){
+                //The slot still holds the item of the previous turn
+                return false;
+            }else{
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (&target->item) T(std::forward<U>(item));
+        target->sequence.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename T>
+    bool mpmcQueue<T>::pop(T & item){
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        slot * source;
+
+        while(true){
+            source = &storage_[head & mask_];
+            std::size_t sequence = source->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)(head + 1);
+
+            if(difference == 0){
+                if(head_.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) break;
+            }else if(difference < 0){
+                //The slot was not filled yet
+                return false;
+            }else{
+                head = head_.load(std::memory_order_relaxed);
+            }
+        }
+
+        item = std::move(source->item);
+        source->item.~T();
+        //Ready for the producer of the next turn
+        source->sequence.store(head + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename T>
+    std::size_t mpmcQueue<T>::size() const{
+        std::size_t tail = tail_.load(std::memory_order_acquire);
+        std::size_t head = head_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    template<typename T>
+    std::size_t mpmcQueue<T>::capacity() const{
+        return mask_ + 1;
+    }
+}
+
+#endif
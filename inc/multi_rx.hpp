@@ -0,0 +1,149 @@
+#ifndef MULTI_RX_H
+#define MULTI_RX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include "aurora.hpp"
+#include "fastic.hpp"
+#include "decoder_metrics.hpp"
+#include "chip_health.hpp"
+#include "event_filter.hpp"
+#include "spsc_queue.hpp"
+#include "buffer_pool.hpp"
+
+namespace fastic{
+
+    /*
+        Receiver of several Aurora lanes (one FastIC+ chip each) decoded by a pool of worker threads.
+
+        Every lane is statically assigned to one worker (lane % workerCount), which keeps the
+        per-lane streaming state of aurora::rx on a single core and preserves the order of the
+        lane's buffers and events without any locking. Raw buffers enter through a per-lane SPSC
+        queue and the decoded events leave through another one, so each lane must be submitted
+        to from one thread and drained from one thread. The events are filtered (eventFilter) on
+        their raw words before they are queued, only the survivors reach the consumer.
+
+        A buffer is decoded in slices of sliceWords_ words, one slice per lane and round. A lane
+        whose consumer falls behind does not hold up the other lanes of its worker: the events
+        of a slice which do not fit its full event queue are kept aside in a buffer of fixed
+        capacity and the lane decodes no further until they were queued, the rest of its
+        buffer waits. A worker without any work spins for a while and then sleeps until a
+        buffer is submitted to one of its lanes or a consumer makes room in one of them. Every
+        worker pins itself to its core before it decodes anything, the cores are those allowed
+        to the process and a worker which could not be pinned runs unpinned (see getWorkerCore).
+    */
+    class multiRx
+    {
+        private:
+            //Raw buffer waiting to be decoded
+            struct job {
+                const std::uint32_t * data;
+                std::size_t size;
+                aurora::bufferPool * pool;      //Pool the buffer is returned to once decoded (nullptr for caller managed buffers)
+                std::size_t poolIndex;
+            };
+
+            struct lane {
+                aurora::rx receiver;
+                aurora::spscQueue<job> input;
+                aurora::spscQueue<eventPacket> output;
+                std::atomic<std::uint64_t> completedBuffers;
+                decoderMetrics metrics;
+                chipHealth health;
+                eventFilter filter;
+                std::vector<eventPacket> pending;       //Decoded events of a slice waiting for room in the output queue (worker only, capacity reserved once)
+                std::size_t pendingHead = 0;
+                job current;                            //Buffer being decoded and the words of it already decoded (worker only)
+                std::size_t currentOffset = 0;
+                bool hasCurrent = false;
+
+                lane(std::size_t inputCapacity, std::size_t outputCapacity, const eventFilter::config & filterConfig);
+            };
+
+            //Sleep of an idle worker
+            struct workerState {
+                std::mutex mutex;
+                std::condition_variable wakeup;
+                std::atomic<bool> sleeping{false};
+            };
+
+            //Idle rounds a worker spins before it goes to sleep
+            static constexpr int idleSpinRounds_ = 256;
+            //Words of a buffer decoded at once, bounds the events kept aside for a full event queue
+            static constexpr std::size_t sliceWords_ = 4096;
+            //Most events of a slice, the frames of the slice and the one straddling its start
+            static constexpr std::size_t maxSliceEvents_ = sliceWords_ * 32 / 66 + 2;
+
+            std::vector<std::unique_ptr<lane>> lanes_;
+            std::vector<std::thread> workers_;
+            std::vector<std::unique_ptr<workerState>> workerStates_;
+            std::vector<int> workerCores_;
+            std::size_t workerCount_;
+            std::atomic<bool> running_;
+
+            void workerLoop(std::size_t worker, int core, std::promise<int> pinned);
+            // Pin the calling thread to the core, returns false if it could not be pinned
+            static bool pinThread(int core);
+            void decodeSlice(lane & currentLane);
+            // Move the pending events of the lane to its output queue, returns the number moved
+            std::size_t flushPending(lane & currentLane);
+            // Signal if the worker has a buffer to decode or room for pending events
+            bool hasWork(std::size_t worker) const;
+            void park(std::size_t worker);
+            void wake(std::size_t worker);
+
+        public:
+            multiRx(std::size_t laneCount, std::size_t workerCount, std::size_t eventQueueCapacity = 1 << 16, std::size_t bufferQueueCapacity = 64, std::vector<int> cores = {}, const eventFilter::config & filter = eventFilter::config());
+            ~multiRx();
+
+            multiRx(const multiRx &) = delete;
+            multiRx & operator=(const multiRx &) = delete;
+
+            // Queue a raw buffer of the lane for decoding, returns false if the lane's buffer queue is full
+            bool submit(std::size_t lane, const std::uint32_t * data, std::size_t size);
+            // Queue a filled pool buffer of the lane, the worker releases it back to the pool once it is decoded
+            bool submit(std::size_t lane, aurora::bufferPool & pool, std::size_t index, std::size_t size);
+            // Number of buffers of the lane which were decoded, the first completedBuffers submitted buffers may be reused
+            std::uint64_t getCompletedBuffers(std::size_t lane) const;
+            // Link health counters of the lane's receiver, readable while the workers run
+            const aurora::rxMetrics & getRxMetrics(std::size_t lane) const;
+            // Event and parity counters of the lane, readable while the workers run
+            const decoderMetrics & getDecoderMetrics(std::size_t lane) const;
+            // Drop counters and rates reported by the lane's chip, readable while the workers run
+            const chipHealth & getChipHealth(std::size_t lane) const;
+            // Filter applied to the lane's events before they are queued, its reject counters are readable while the workers run
+            const eventFilter & getFilter(std::size_t lane) const;
+
+            // Hand up to maxEvents decoded events of the lane to the consumer (callable with eventPacket &), returns their count
+            template<typename Consumer>
+            std::size_t drain(std::size_t lane, Consumer && consumer, std::size_t maxEvents = SIZE_MAX);
+
+            // Stop and join the workers, the buffers still queued are not decoded
+            void stop();
+
+            std::size_t getLaneCount() const;
+            std::size_t getWorkerCount() const;
+            // Worker decoding the lane
+            std::size_t getLaneWorker(std::size_t lane) const;
+            // Core the worker is pinned to, -1 if it could not be pinned (core outside of the process cpuset or the pinning failed)
+            int getWorkerCore(std::size_t worker) const;
+    };
+
+    template<typename Consumer>
+    std::size_t multiRx::drain(std::size_t lane, Consumer && consumer, std::size_t maxEvents){
+        std::size_t events = lanes_[lane]->output.consume(consumer, maxEvents);
+
+        //The worker may sleep waiting for room for its pending events
+        if(events) wake(getLaneWorker(lane));
+        return events;
+    }
+}
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef PARALLEL_RX_H
+#define PARALLEL_RX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <array>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include "aurora.hpp"
+
+namespace aurora{
+
+    /*
+        Offline decoder of one capture by several threads
+
+        The capture is split into chunks of chunkWords words, which are decoded by the workers
+        at the same time. The state rx carries from one chunk to the next (alignment, carried
+        words, previous scrambled payload, lock window) can be recovered from the raw data
+        around the chunk start: a worker acquires the alignment there, then reads the frame
+        before the chunk (the descrambler is self synchronizing) and the headers of the last
+        64 frames, and decodes its chunk from that guessed state. Once the previous chunk is
+        done, the state it really ended with is compared to the guess. A chunk whose guess was
+        wrong (a relock or a loss of sync near the boundary) is decoded again from the real
+        state, so the output is exactly that of a single rx fed the same chunks in order.
+
+        The chunks are handed to the sink in order by the calling thread while the workers go
+        on with the next ones, at most two chunks per worker are buffered.
+    */
+    class parallelRx
+    {
+        private:
+            //Streaming state of rx between two chunks
+            struct streamState {
+                bool synced = false;
+                bool streamStarted = false;
+                std::uint8_t bitSlip = 0;
+                std::array<std::uint32_t, 4> carryBuffer = {};
+                std::size_t carryWords = 0;
+                std::size_t streamPosition = 0;
+                std::uint64_t previousData = 0;
+                bool hasPreviousData = false;
+                int lockErrors = 0;
+                std::uint64_t lockHistory = 0;
+                std::vector<std::uint32_t> syncBuffer;     //Unsynced input collected at the end of the chunk
+            };
+
+            //Chunk being decoded or waiting to be handed out
+            struct chunk {
+                std::size_t begin;
+                std::size_t end;
+                streamState entry;                      //State the chunk was decoded from
+                streamState exit;                       //State the chunk ended with
+                std::unique_ptr<rx> receiver;           //Receiver of the chunk, its metrics are merged once the chunk is accepted
+                std::vector<std::uint8_t> syncBits;     //Decoded frames
+                std::vector<std::uint64_t> payloads;
+                std::atomic<std::size_t> index{0};      //Chunk the slot takes next, set once the previous one was handed out
+                std::atomic<bool> ready{false};         //The chunk was decoded into the slot
+            };
+
+            std::size_t workerCount_;
+            std::size_t chunkWords_;
+            std::uint8_t syncErrorTresholdPercentage_;
+            int syncErrorSampleSize_;
+
+            std::vector<std::unique_ptr<chunk>> chunks_;
+            std::vector<std::thread> workers_;
+
+            const std::uint32_t * data_ = nullptr;
+            std::size_t size_ = 0;
+            std::size_t chunkCount_ = 0;
+            std::atomic<std::size_t> nextChunk_{0};     //Next chunk to be taken by a worker
+            std::atomic<bool> cancelled_{false};        //The decoding was abandoned (the sink threw), the workers stop waiting for slots
+            std::size_t acceptedChunks_ = 0;            //Next chunk to be handed out
+            streamState state_;                         //Real state after the chunks handed out
+
+            rxMetrics metrics_;
+            std::uint64_t decodedChunks_ = 0;
+            std::uint64_t redecodedChunks_ = 0;
+
+            void workerLoop();
+            // Guess the state rx would have at the start of the chunk from the data around it
+            streamState guessEntry(std::size_t begin) const;
+            void decodeChunk(chunk & target) const;
+            static streamState saveState(const rx & receiver);
+            static void loadState(rx & receiver, const streamState & state);
+            // Signal if decoding from the entry state gives the same result as from the exit state of the previous chunk
+            static bool continues(const streamState & exit, const streamState & entry);
+
+            void start(const std::uint32_t * data, std::size_t size);
+            // Wait for the next chunk in order and check its entry state, decoding it again if needed
+            const chunk * acceptChunk();
+            void releaseChunk();
+            void finish();
+            // Stop the workers without handing out the remaining chunks
+            void cancel();
+
+            // Decode the capture handing every frame to the sink in order
+            template<typename FrameSink>
+            void decodeFrames(const std::uint32_t * data, std::size_t size, FrameSink && sink);
+
+        public:
+            parallelRx(std::size_t workerCount = 0, std::size_t chunkWords = 1 << 20, std::uint8_t syncErrorTresholdPercentage = 90, int syncErrorSampleSize = 64);
+            ~parallelRx();
+
+            parallelRx(const parallelRx &) = delete;
+            parallelRx & operator=(const parallelRx &) = delete;
+
+            // Decode a whole capture as a new stream, the sink (callable with const packet &) gets the packets of rx::feed in order
+            template<typename Sink>
+            void decode(const std::uint32_t * data, std::size_t size, Sink && sink, bool discardControl = false);
+            // Decode a whole capture as a new stream into runs of data payloads and single control packets, as rx::feedPayloads
+            template<typename DataSink, typename ControlSink>
+            void decodePayloads(const std::uint32_t * data, std::size_t size, DataSink && dataSink, ControlSink && controlSink);
+
+            std::size_t getWorkerCount() const;
+            std::size_t getChunkWords() const;
+            // Signal if the stream was synchronized at the end of the last capture
+            bool isSynchronized() const;
+            // Counters of the accepted chunks, as if a single rx decoded them
+            const rxMetrics & getMetrics() const;
+            std::uint64_t getDecodedChunks() const;
+            // Number of chunks decoded again because their guessed entry state was wrong
+            std::uint64_t getRedecodedChunks() const;
+    };
+
+    /// @brief Decode a capture, the chunks are decoded in parallel and handed to the sink in order
+    /// @param data Pointer to the raw capture with 32bit MSB data words
+    /// @param size Number of words of the capture
+    /// @param sink Callable receiving every decoded frame (std::uint8_t syncBits, std::uint64_t data)
+    template<typename FrameSink>
+    void parallelRx::decodeFrames(const std::uint32_t * data, std::size_t size, FrameSink && sink){
+        start(data, size);
+
+        try{
+            while(const chunk * decoded = acceptChunk()){
+                for(std::size_t idx = 0; idx < decoded->payloads.size(); idx++){
+                    sink(decoded->syncBits[idx], decoded->payloads[idx]);
+                }
+                releaseChunk();
+            }
+        }catch(...){
+            //The workers waiting for the slots of the chunks not handed out would never be released
+            cancel();
+            throw;
+        }
+
+        finish();
+    }
+
+    /// @brief Decode a capture into packets
+    /// @param data Pointer to the raw capture with 32bit MSB data words
+    /// @param size Number of words of the capture
+    /// @param sink Callable receiving every decoded packet (const packet &)
+    /// @param discardControl Do not pass the control frames to the sink
+    template<typename Sink>
+    void parallelRx::decode(const std::uint32_t * data, std::size_t size, Sink && sink, bool discardControl){
+        decodeFrames(data, size, rx::packetFrameSink(sink, discardControl));
+    }
+
+    /// @brief Decode a capture straight into payloads, without building any packet
+    /// @param data Pointer to the raw capture with 32bit MSB data words
+    /// @param size Number of words of the capture
+    /// @param dataSink Callable receiving runs of descrambled data payloads (const std::uint64_t * payloads, std::size_t count)
+    /// @param controlSink Callable receiving every control frame (const controlPacket &), after the data preceding it
+    template<typename DataSink, typename ControlSink>
+    void parallelRx::decodePayloads(const std::uint32_t * data, std::size_t size, DataSink && dataSink, ControlSink && controlSink){
+        payloadSplitter<DataSink, ControlSink> splitter(dataSink, controlSink);
+        decodeFrames(data, size, splitter);
+        splitter.flush();
+    }
+}
+
+#endif
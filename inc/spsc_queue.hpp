@@ -0,0 +1,141 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace aurora{
+
+    /*
+        Bounded lock-free queue for exactly one producer and one consumer thread.
+        The capacity is rounded up to a power of two, the indices only ever grow and
+        each side keeps a cached copy of the other side's index to avoid bouncing
+        its cache line on every operation.
+    */
+    template<typename T>
+    class spscQueue
+    {
+        private:
+            static constexpr std::size_t cacheLineSize_ = 64;
+
+            std::size_t mask_;
+            T * storage_;
+
+            //Consumer side
+            alignas(cacheLineSize_) std::atomic<std::size_t> head_;
+            std::size_t cachedTail_;
+
+            //Producer side
+            alignas(cacheLineSize_) std::atomic<std::size_t> tail_;
+            std::size_t cachedHead_;
+
+        public:
+            explicit spscQueue(std::size_t capacity);
+            ~spscQueue();
+
+            spscQueue(const spscQueue &) = delete;
+            spscQueue & operator=(const spscQueue &) = delete;
+
+            // Producer: append an item, returns false if the queue is full
+            template<typename U>
+            bool push(U && item);
+            // Consumer: remove the oldest item, returns false if the queue is empty
+            bool pop(T & item);
+            // Consumer: hand up to maxItems of the oldest items to the consumer callable in place, returns how many were consumed
+            template<typename Consumer>
+            std::size_t consume(Consumer && consumer, std::size_t maxItems);
+
+            // Approximate number of queued items, exact only when called from one of the two sides while the other is idle
+            std::size_t size() const;
+            std::size_t capacity() const;
+    };
+
+    template<typename T>
+    spscQueue<T>::spscQueue(std::size_t capacity) : head_(0), cachedTail_(0), tail_(0), cachedHead_(0)
+    {
+        std::size_t roundedCapacity = 1;
+        while(roundedCapacity < capacity) roundedCapacity <<= 1;
+
+        mask_ = roundedCapacity - 1;
+        storage_ = std::allocator<T>().allocate(roundedCapacity);
+    }
+
+    template<typename T>
+    spscQueue<T>::~spscQueue(){
+        //Destroy the items which were never consumed
+        for(std::size_t idx = head_.load(std::memory_order_relaxed); idx != tail_.load(std::memory_order_relaxed); idx++){
+            storage_[idx & mask_].~T();
+        }
+
+        std::allocator<T>().deallocate(storage_, mask_ + 1);
+    }
+
+    template<typename T>
+    template<typename U>
+    bool spscQueue<T>::push(U && item){
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+        if(tail - cachedHead_ > mask_){
+            //Looks full, refresh the consumer position
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if(tail - cachedHead_ > mask_) return false;
+        }
+
+        new (&storage_[tail & mask_]) T(std::forward<U>(item));
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename T>
+    bool spscQueue<T>::pop(T & item){
+        std::size_t head = head_.load(std::memory_order_relaxed);
+
+        if(head == cachedTail_){
+            //Looks empty, refresh the producer position
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if(head == cachedTail_) return false;
+        }
+
+        T & slot = storage_[head & mask_];
+        item = std::move(slot);
+        slot.~T();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename T>
+    template<typename Consumer>
+    std::size_t spscQueue<T>::consume(Consumer && consumer, std::size_t maxItems){
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        cachedTail_ = tail_.load(std::memory_order_acquire);
+
+        std::size_t count = std::min(cachedTail_ - head, maxItems);
+
+        for(std::size_t idx = 0; idx < count; idx++){
+            T & slot = storage_[(head + idx) & mask_];
+            consumer(slot);
+            slot.~T();
+        }
+
+        //Release all the consumed slots to the producer at once
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    template<typename T>
+    std::size_t spscQueue<T>::size() const{
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    template<typename T>
+    std::size_t spscQueue<T>::capacity() const{
+        return mask_ + 1;
+    }
+}
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef STREAM_READER_H
+#define STREAM_READER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+#include "buffer_pool.hpp"
+
+namespace aurora{
+
+    /*
+        Pipelined reader of raw Aurora words from a capture file or a character device
+
+        The input is read straight into the buffers of a bufferPool. With io_uring several reads
+        are kept in flight (queueDepth) while the buffers read before them are decoded, the pool
+        buffers are registered with the ring, so the kernel does not map them on every read.
+        Seekable inputs (files, block devices) are read at consecutive offsets in parallel.
+        Non-seekable ones (pipes, streaming devices) have no offset to keep the reads apart, their
+        reads are queued as one chain of linked reads (IOSQE_IO_LINK) the kernel runs in order. A
+        short read breaks the chain, the reads behind it are cancelled and queued again in the
+        next chain, which starts once the previous one completed. A stream delivering whole
+        buffers keeps queueDepth reads queued, one delivering less than a buffer per read gets
+        about one read per chain. Without io_uring (old kernel, seccomp, or requested) the same
+        interface is served by blocking reads.
+
+        The filled buffers are handed out strictly in the input order whatever the order of the
+        completions is. Every buffer holds whole 32bit words, only the last one may be shorter than
+        the buffer size (a trailing partial word of the input is dropped). A handed out buffer
+        belongs to the consumer until it returns it to the pool, from any thread, e.g. through
+        multiRx::submit with the pool. The reader only issues reads into free buffers, so a slow
+        consumer throttles the reads instead of letting the data pile up. Once the consumer holds
+        every buffer, next sleeps until one of them is released (the release has to come from
+        another thread then).
+    */
+    class streamReader
+    {
+        public:
+            enum class backend{
+                none,           //Not opened
+                ioUring,        //Asynchronous reads through io_uring
+                blocking        //Blocking read / pread in the calling thread
+            };
+
+        private:
+            //One read, the slots form a ring indexed by the sequence number of the read
+            struct slot {
+                std::size_t bufferIndex;
+                std::uint64_t offset;       //Input offset of the buffer start (seekable inputs)
+                std::size_t bytes;          //Bytes read so far
+                std::size_t capacity;       //Bytes wanted
+                struct iovec vector;        //Target of a read into an unregistered buffer
+                bool done;
+                bool end;                   //The input ended within this read
+                int error;
+            };
+
+            bufferPool & pool_;
+            std::vector<slot> slots_;
+            std::uint64_t submitted_ = 0;           //Sequence number of the next read
+            std::uint64_t delivered_ = 0;           //Sequence number of the next buffer handed out
+            std::size_t inFlight_ = 0;              //Reads the kernel owns (io_uring)
+
+            int fd_ = -1;
+            bool ownsFd_ = false;
+            bool seekable_ = false;
+            std::uint64_t inputSize_ = 0;           //Size of a regular file, 0 if unknown
+            std::uint64_t nextOffset_ = 0;
+            bool inputEnded_ = false;               //No more reads are issued
+            bool endReached_ = false;               //The buffer with the end of the input was handed out
+            bool finished_ = false;                 //The last buffer was handed out
+            int error_ = 0;
+
+            backend preferred_;
+            backend backend_ = backend::none;
+
+            //io_uring state, the rings are shared with the kernel
+            int ringFd_ = -1;
+            void * sqRing_ = nullptr;
+            void * cqRing_ = nullptr;
+            void * sqes_ = nullptr;
+            std::size_t sqRingSize_ = 0;
+            std::size_t cqRingSize_ = 0;
+            std::size_t sqesSize_ = 0;
+            unsigned * sqTail_;
+            unsigned * sqMask_;
+            unsigned * sqArray_;
+            unsigned * cqHead_;
+            unsigned * cqTail_;
+            unsigned * cqMask_;
+            void * cqes_;
+            unsigned pendingSubmissions_ = 0;       //Queued submission entries not passed to the kernel yet
+            bool registeredBuffers_ = false;
+
+            std::uint64_t bytesRead_ = 0;
+            std::uint64_t reads_ = 0;
+            std::uint64_t stalls_ = 0;
+
+            bool setupRing();
+            void closeRing();
+            bool startRead(std::uint64_t & sequence);
+            void queueRead(std::uint64_t sequence);
+            void queueChain();
+            bool enter(unsigned minComplete);
+            void reapCompletions();
+            void completeRead(std::uint64_t sequence, long result);
+            void readBlocking(std::uint64_t sequence);
+            void drainInFlight();
+
+        public:
+            streamReader(bufferPool & pool, std::size_t queueDepth = 8, backend preferred = backend::ioUring);
+            ~streamReader();
+
+            streamReader(const streamReader &) = delete;
+            streamReader & operator=(const streamReader &) = delete;
+
+            // Open a capture file or a device for reading
+            bool open(const std::string & path);
+            // Read from an already opened descriptor, which is not closed by the reader
+            bool open(int fd);
+            // Wait for the reads in flight and close the input
+            void close();
+
+            // Next filled buffer in the input order, blocking until it is read, returns false at the end of the input or on an error
+            bool next(std::size_t & index, std::size_t & words);
+            // Hand every buffer to the sink (callable with std::size_t index, std::size_t words), returns the number of buffers
+            template<typename Sink>
+            std::size_t run(Sink && sink);
+
+            backend getBackend() const;
+            // Signal if the pool buffers are registered with io_uring (fixed buffer reads), never for pools of more than 65536 buffers
+            bool hasRegisteredBuffers() const;
+            std::size_t getQueueDepth() const;
+            // Error number of the failed read, 0 if the input was read to its end
+            int getError() const;
+
+            std::uint64_t getBytesRead() const;
+            // Number of read requests issued, the partial reads resumed included
+            std::uint64_t getReads() const;
+            // Number of waits for the consumer to return a buffer (backpressure)
+            std::uint64_t getStalls() const;
+    };
+
+    template<typename Sink>
+    std::size_t streamReader::run(Sink && sink){
+        std::size_t buffers = 0;
+        std::size_t index, words;
+
+        while(next(index, words)){
+            sink(index, words);
+            buffers++;
+        }
+
+        return buffers;
+    }
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef TIME_MERGE_H
+#define TIME_MERGE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <limits>
+#include "time_reconstruction.hpp"
+
+namespace fastic{
+
+    /*
+        Bounded latency k-way merge of the timed events of many lanes into one time ordered stream
+
+        Within a lane the events are only roughly time ordered, each lane therefore keeps its
+        pending events in a ring buffer sorted on insertion (cheap, as the events are nearly
+        sorted). Once a lane has seen an event at time t, no event of the lane older than
+        t - reorderWindow is expected anymore, so everything up to the smallest of these
+        horizons over all the lanes can be emitted. The order between the lanes is resolved by
+        a tournament tree over the heads of the lane buffers.
+
+        Events arriving behind the already emitted part of the stream are counted as late
+        and dropped. A lane without events holds the merge back, signal its progress with
+        advance() or finish the run with flush().
+    */
+    class timeMerger
+    {
+        private:
+            static constexpr std::uint64_t emptyLane_ = std::numeric_limits<std::uint64_t>::max();
+
+            struct laneBuffer {
+                std::vector<timedEvent> events;     //Ring buffer sorted by the timestamp
+                std::size_t head = 0;
+                std::size_t count = 0;
+                std::uint64_t horizon = 0;          //No event older than this is expected on the lane anymore
+            };
+
+            std::vector<laneBuffer> lanes_;
+            std::vector<std::uint64_t> heads_;      //Timestamp of the head of every lane, kept flat for the tree
+            std::size_t laneMask_;
+            std::uint64_t reorderWindow_;
+
+            //Tournament tree, node i holds the lane with the oldest head of its subtree, the lanes are the leaves
+            std::vector<std::uint16_t> tree_;
+            std::size_t leafOffset_;
+
+            std::uint64_t lastEmitted_ = 0;
+            std::uint64_t lateEvents_ = 0;
+
+            std::uint64_t headTimestamp(std::size_t lane) const;
+            void updateTree(std::size_t lane);
+            std::uint64_t mergeHorizon() const;
+
+            // Remove the head of the lane and pass it to the sink
+            template<typename Sink>
+            void emitHead(std::size_t lane, Sink & sink);
+
+        public:
+            timeMerger(std::size_t laneCount, std::uint64_t reorderWindow, std::size_t laneCapacity = 4096);
+
+            // Add an event (of the lane event.lane), returns false if the lane buffer is full and emit has to be called first
+            bool push(const timedEvent & event);
+            // Signal that the lane will not produce any event older than timestamp - reorderWindow
+            void advance(std::size_t lane, std::uint64_t timestamp);
+
+            // Pass all the events which can no longer be overtaken to the sink (callable with const timedEvent &) in time order
+            template<typename Sink>
+            std::size_t emit(Sink && sink);
+            // Pass all the pending events to the sink in time order, regardless of the reorder window (end of the run)
+            template<typename Sink>
+            std::size_t flush(Sink && sink);
+
+            std::size_t getPendingEvents() const;
+            // Number of events which arrived too late for the reorder window and were dropped
+            std::uint64_t getLateEvents() const;
+    };
+
+    inline std::uint64_t timeMerger::headTimestamp(std::size_t lane) const{
+        return heads_[lane];
+    }
+
+    template<typename Sink>
+    void timeMerger::emitHead(std::size_t lane, Sink & sink){
+        laneBuffer & buffer = lanes_[lane];
+        const timedEvent & event = buffer.events[buffer.head];
+
+        lastEmitted_ = event.timestamp;
+        sink(event);
+
+        buffer.head = (buffer.head + 1) & laneMask_;
+        buffer.count--;
+        heads_[lane] = buffer.count ? buffer.events[buffer.head].timestamp : emptyLane_;
+        updateTree(lane);
+    }
+
+    /// @brief Emit the events older than the merge horizon in time order
+    /// @param sink Callable receiving the events (const timedEvent &)
+    /// @return Number of emitted events
+    template<typename Sink>
+    std::size_t timeMerger::emit(Sink && sink){
+        std::uint64_t horizon = mergeHorizon();
+        std::size_t emitted = 0;
+
+        for(std::size_t lane = tree_[1]; headTimestamp(lane) <= horizon && headTimestamp(lane) != emptyLane_; lane = tree_[1]){
+            emitHead(lane, sink);
+            emitted++;
+        }
+
+        return emitted;
+    }
+
+    /// @brief Emit all the pending events in time order
+    /// @param sink Callable receiving the events (const timedEvent &)
+    /// @return Number of emitted events
+    template<typename Sink>
+    std::size_t timeMerger::flush(Sink && sink){
+        std::size_t emitted = 0;
+
+        for(std::size_t lane = tree_[1]; headTimestamp(lane) != emptyLane_; lane = tree_[1]){
+            emitHead(lane, sink);
+            emitted++;
+        }
+
+        return emitted;
+    }
+}
+
+#endif
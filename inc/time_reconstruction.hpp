@@ -0,0 +1,120 @@
+#ifndef TIME_RECONSTRUCTION_H
+#define TIME_RECONSTRUCTION_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "aurora.hpp"
+#include "fastic.hpp"
+
+namespace fastic{
+
+    //Event tagged with its reconstructed global timestamp and the lane it was received on
+    struct timedEvent {
+        std::uint64_t timestamp;
+        std::uint64_t rawData;
+        std::uint16_t lane;
+    };
+
+    /*
+        Reconstruction of global 64bit timestamps of a single lane
+
+        The 22 bit ToA of an event packet wraps quickly, so every event is placed at the 64bit
+        time nearest to the latest time reconstructed so far (events may arrive slightly out of
+        order, up to half of the ToA period). Extension packets re-anchor the reference to their
+        coarse counter, which itself is extended over its 24 bit wraps and the counter resets so
+        the time base stays monotonic. Between extension packets, or when some of them are lost,
+        the ToA wraps are followed from the events alone as long as the gaps between events stay
+        below half of the ToA period.
+
+        The coarse counter tick is 2^coarseShift ToA ticks (by default one full ToA period) and
+        the events following an extension packet are expected within one ToA period after it.
+
+        The returned timestamps are the reconstructed ones, they may decrease. An event placed
+        before the latest timestamp returned (a late event, or an event following an extension
+        packet which moved the reference back) is counted as out of order, putting the events
+        of the lanes back in time order is left to timeMerger.
+    */
+    class timeReconstructor
+    {
+        private:
+            static constexpr int timestampBits_ = 22;
+            static constexpr std::uint64_t timestampPeriod_ = (std::uint64_t)1 << timestampBits_;
+
+            unsigned int coarseShift_;
+
+            std::uint64_t reference_ = timestampPeriod_ / 2;    //Latest reconstructed time, the center of the unwrapping window
+            std::uint64_t lastTimestamp_ = 0;                    //Latest returned timestamp
+            std::uint64_t coarseBase_ = 0;                       //Coarse ticks accumulated over the counter wraps and resets
+            std::uint64_t lastCoarse_ = 0;                       //Last extended coarse counter value
+            std::uint32_t lastCoarseCounter_ = 0;
+            std::uint32_t lastPacketCount_ = 0;
+            std::uint32_t eventsSinceExtension_ = 0;
+            bool hasExtension_ = false;
+
+            std::uint64_t lostPackets_ = 0;
+            std::uint32_t resetCounter_ = 0;
+            std::uint64_t extensionCounter_ = 0;
+            std::uint64_t outOfOrderEvents_ = 0;
+
+        public:
+            timeReconstructor(unsigned int coarseShift = timestampBits_);
+
+            // Follow an extension packet of the lane
+            void extension(extensionPacket packet);
+
+            // Extend the 22 bit ToA of the next event of the lane to the 64bit global timestamp
+            std::uint64_t extend(std::uint32_t timestamp);
+            // Extend a run of consecutive events (for example the timestamp column of an eventBatch)
+            void extend(const std::uint32_t * timestamps, std::uint64_t * globalTimestamps, std::size_t count);
+
+            // Follow a decoded frame, returns true and the global timestamp if the frame was an event
+            bool process(const aurora::packet & packet, std::uint64_t & globalTimestamp);
+
+            // Number of event packets the extension packet counters report as not received
+            std::uint64_t getLostPackets() const;
+            std::uint32_t getResetCount() const;
+            std::uint64_t getExtensionCount() const;
+            // Number of events which were placed before an already returned timestamp
+            std::uint64_t getOutOfOrderEvents() const;
+    };
+
+    inline std::uint64_t timeReconstructor::extend(std::uint32_t timestamp){
+        //Sign extended distance of the ToA from the reference, modulo the ToA period
+        std::int64_t distance = (std::int64_t)(((std::uint64_t)timestamp - reference_) << (64 - timestampBits_)) >> (64 - timestampBits_);
+        std::uint64_t globalTimestamp = reference_ + distance;
+
+        //Late events do not pull the reference back
+        reference_ = std::max(reference_, globalTimestamp);
+        eventsSinceExtension_++;
+
+        //The event is returned at its own time even behind the latest one, timeMerger restores the order
+        outOfOrderEvents_ += globalTimestamp < lastTimestamp_;
+        lastTimestamp_ = std::max(lastTimestamp_, globalTimestamp);
+
+        return globalTimestamp;
+    }
+
+    inline void timeReconstructor::extend(const std::uint32_t * timestamps, std::uint64_t * globalTimestamps, std::size_t count){
+        for(std::size_t idx = 0; idx < count; idx++){
+            globalTimestamps[idx] = extend(timestamps[idx]);
+        }
+    }
+
+    inline bool timeReconstructor::process(const aurora::packet & packet, std::uint64_t & globalTimestamp){
+        //Data frames are the hot path, the control frames only need to be checked for extension packets
+        if(packet.type == aurora::packet::type::data){
+            globalTimestamp = extend((packet.data >> 20) & 0x3FFFFF);
+            return true;
+        }
+
+        if(packet.type == aurora::packet::type::control){
+            aurora::controlPacket control(packet);
+            if(control.getBlockType() == extensionPacket::blockType) extension(extensionPacket(control));
+        }
+
+        return false;
+    }
+}
+
+#endif
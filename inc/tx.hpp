@@ -0,0 +1,84 @@
+#ifndef TX_H
+#define TX_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace aurora{
+
+    /*
+        Aurora 64b/66b transmitter
+
+        The inverse of rx: every 64bit payload is scrambled with the self synchronizing
+        x^58 + x^39 + 1 scrambler (a whole word at a time), prefixed with its 2bit sync header
+        (01 data, 10 control) and the 66bit frames are packed MSB first into 32bit words.
+        The stream starts with bitSlip zero bits, so the receiver finds the first frame at
+        that bitslip, the whole zero words of them are written before the first frame. The bits of the last incomplete word are kept until the next call or
+        until finish pads them with zeros, so a stream can be encoded in any chunks.
+    */
+    class tx
+    {
+        public:
+            static constexpr std::uint8_t dataHeader = 0b01;
+            static constexpr std::uint8_t controlHeader = 0b10;
+
+        private:
+            std::uint64_t scramblerState_;
+            unsigned __int128 pendingBits_ = 0;     //Bits not forming a whole word yet, in the LSBs
+            unsigned int pendingCount_ = 0;         //Number of the pending bits, at most 31 between the frames
+            std::uint8_t bitSlip_;
+            bool started_ = false;
+            std::uint64_t frameCounter_ = 0;
+
+            // Write the whole zero words of the bitslip and keep the rest of its bits pending, once per stream
+            std::size_t start(std::uint32_t * words);
+            // Append one frame, returns the number of whole words written
+            std::size_t appendFrame(std::uint8_t syncBits, std::uint64_t scrambledData, std::uint32_t * words);
+
+        public:
+            tx(std::uint8_t bitSlip = 0, std::uint64_t scramblerState = 0);
+
+            // Scramble and frame count payloads of one kind (data or control), returns the number of words written
+            std::size_t encode(const std::uint64_t * payloads, std::size_t count, std::uint32_t * words, bool control = false);
+            // Scramble and frame count payloads with their own sync headers, returns the number of words written
+            std::size_t encode(const std::uint64_t * payloads, const std::uint8_t * syncBits, std::size_t count, std::uint32_t * words);
+            // Write the pending bits padded with zeros, returns the number of words written
+            std::size_t finish(std::uint32_t * words);
+
+            // Scramble a single payload, state is the previous scrambled payload and is advanced
+            static std::uint64_t scramble(std::uint64_t data, std::uint64_t & state);
+            // Scramble a block of payloads in place, returns the last scrambled payload (the next state)
+            static std::uint64_t scrambleBlock(std::uint64_t * data, std::size_t count, std::uint64_t state);
+            // Upper bound of the words written by encoding the given number of frames (including finish and the bitslip)
+            static std::size_t getMaxWords(std::size_t frames);
+
+            std::uint64_t getFrameCount() const;
+            std::uint64_t getScramblerState() const;
+    };
+
+    inline std::uint64_t tx::scramble(std::uint64_t data, std::uint64_t & state){
+        //The inverse of rx::descramblePacketData, the taps of the bits of the same word are resolved by the shifts right
+        std::uint64_t scrambled = data ^ (state << 25) ^ (state << 6);
+        scrambled ^= scrambled >> 39;
+        scrambled ^= scrambled >> 58;
+        state = scrambled;
+        return scrambled;
+    }
+
+    inline std::size_t tx::appendFrame(std::uint8_t syncBits, std::uint64_t scrambledData, std::uint32_t * words){
+        //At most 31 + 66 bits are pending, the whole words of the bitslip went out before the first frame
+        pendingBits_ = (pendingBits_ << 66) | ((unsigned __int128)(syncBits & 0x03) << 64) | scrambledData;
+        pendingCount_ += 66;
+
+        std::size_t written = 0;
+        while(pendingCount_ >= 32){
+            pendingCount_ -= 32;
+            words[written++] = (std::uint32_t)(pendingBits_ >> pendingCount_);
+        }
+
+        pendingBits_ &= ((unsigned __int128)1 << pendingCount_) - 1;
+        return written;
+    }
+}
+
+#endif
@@ -3,6 +3,10 @@
 #include <algorithm>
 #include <cstdint>
 
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
 namespace aurora{
 
     /// @brief Construct the receiver with the buffer specified
@@ -10,17 +14,15 @@ namespace aurora{
     /// @param rxBufferSize Size of the raw buffer
     /// @param syncErrorTresholdPercentage The treshold (in percent) of the ratio of correct to error packets for the stream to be considered in sync
     /// @param syncErrorSampleSize The number of data packets which will be checked to determine if they comply with the error treshold
-    rx::rx(std::uint32_t * rxBuffer, std::size_t rxBufferSize, std::uint8_t syncErrorTresholdPercentage, int syncErrorSampleSize) : 
+    rx::rx(const std::uint32_t * rxBuffer, std::size_t rxBufferSize, std::uint8_t syncErrorTresholdPercentage, int syncErrorSampleSize) : 
         rxBuffer_(rxBuffer), 
         rxBufferSize_(rxBufferSize)
     {
         if(syncErrorTresholdPercentage > 100) syncErrorTresholdPercentage = 100;
+        syncErrorTresholdPercentage_ = syncErrorTresholdPercentage;
 
-        if(rxBufferSize <= syncErrorSampleSize){
-            syncErrorSampleSize_ = rxBufferSize;
-        }else {
-            syncErrorSampleSize_ = syncErrorSampleSize;
-        }
+        //The sample is limited to the frames available in the buffer at the time of the synchronization
+        syncErrorSampleSize_ = syncErrorSampleSize;
 
         syncErrorTreshold_ = (int)((syncErrorSampleSize_ * syncErrorTresholdPercentage) / 100);
     }
@@ -40,20 +42,7 @@ namespace aurora{
     }
 
     std::uint8_t rx::getSyncBits(int packetIndex){
-        int syncIndex = getSyncIndex(packetIndex);
-        std::uint8_t syncShift = getSyncShift(packetIndex);
-
-        std::uint8_t syncBits = 0;
-        
-        if(syncShift == 31){
-            // This is the special case where the sync bits are split between the two 32bit data words -> join them
-            syncBits = ((rxBuffer_[syncIndex] & 0x00000001) << 1) | ((rxBuffer_[syncIndex+1] & 0x80000000) >> 31);
-        }else{
-             // This is the most usual case where the bits are in one data word -> just mask them
-            syncBits = (rxBuffer_[syncIndex] & (0xC0000000 >> syncShift)) >> (30 - syncShift);
-        }
-
-        return syncBits;
+        return extractSyncBits(rxBuffer_, this->bitSlip_ + (66 * packetIndex));
     }
 
     // Check if the sync bits at the specified position are valid
@@ -70,36 +59,123 @@ namespace aurora{
     }
 
 
-    bool rx::synchronize(){ 
-        // Counter for valid packets
-        int validPacketCounter;
-        
-        // Go through all the possible bitslips
-        for(std::uint8_t bitSlip = 0; bitSlip < 64; bitSlip++){
-            // Force the selected bit slip
-            forceBitSlip(bitSlip);
-            // Check the first 5 packets for validity (this usually gets rid of most of the fake syncs)
-            if(hasValidSync(0) && hasValidSync(1) && hasValidSync(2) && hasValidSync(3) && hasValidSync(4)){
-                // If sync candidate was acquired, check if it suffices the sync error treshold
-                validPacketCounter = 5;
-                // Go through all the packets with the selected slip
-                for(int packetIndex = 5; packetIndex < syncErrorSampleSize_; packetIndex++){
-                    //Count how many of them were valid
-                    if(hasValidSync(packetIndex)){
-                        validPacketCounter++;
-                        //If the ratio of good to error packets suffices, return the bit slip
-                        if(validPacketCounter >= syncErrorTreshold_){
-                            this->bitSlip_ = bitSlip;
-                            this->synced_ = true;
-                            return true;
-                        }
-                    }
-                }
+    /// @brief Find the frame alignment with the most valid sync headers
+    /// @param buffer Pointer to the raw data
+    /// @param bufferBits Number of valid bits in the buffer
+    /// @param bitPosition Bit of the buffer where the search starts
+    /// @param sampleSize Maximal number of frames to be scored
+    /// @param score Number of valid sync headers found with the returned alignment
+    /// @param sampledFrames Number of frames which were scored for every alignment
+    /// @return Offset of the best alignment from bitPosition (0 - 65)
+    std::uint8_t rx::acquireAlignment(const std::uint32_t * buffer, std::size_t bufferBits, std::size_t bitPosition, int sampleSize, int & score, int & sampledFrames){
+        // A valid header (01 or 10) is a bit transition. For each frame sized window the transitions at all the 66 offsets
+        // are computed at once and accumulated into bit-sliced counters, where plane p holds bit p of the count of every offset
+        constexpr int counterPlanes = 16;
+        std::array<std::uint64_t, counterPlanes> counters = {};
+        int tailCounters[2] = {0, 0};
+
+        sampleSize = std::min(sampleSize, (1 << counterPlanes) - 1);
+        sampledFrames = 0;
+
+        // Every window reads the four words holding its first bit, so keep 128 bits of margin past the window start
+        for(std::size_t base = bitPosition; base + 128 <= bufferBits && sampledFrames < sampleSize; base += 66){
+            const std::uint32_t * words = buffer + base / 32;
+            std::uint8_t shift = base % 32;
+
+            // Bits base - base+63 and the 32 bits following them
+            std::uint64_t head = ((((std::uint64_t)words[0] << 32) | words[1]) << shift) | (((std::uint64_t)words[2] << shift) >> 32);
+            std::uint32_t tail = (std::uint32_t)(((((std::uint64_t)words[2] << 32) | words[3]) << shift) >> 32);
+
+            // Offsets 0 - 63 occupy the bits 63 - 0, offsets 64 and 65 are counted separately
+            std::uint64_t transitions = head ^ ((head << 1) | (tail >> 31));
+            tailCounters[0] += ((tail >> 31) ^ (tail >> 30)) & 1;
+            tailCounters[1] += ((tail >> 30) ^ (tail >> 29)) & 1;
+
+            // Ripple carry add of one into the counters of all the offsets which have a transition
+            std::uint64_t carry = transitions;
+            for(int plane = 0; carry && plane < counterPlanes; plane++){
+                std::uint64_t nextCarry = counters[plane] & carry;
+                counters[plane] ^= carry;
+                carry = nextCarry;
             }
+
+            sampledFrames++;
         }
-        
-        // Otherwise return false
-        return false;
+
+        // Bit-sliced search of the highest count, going from the top plane down keep only the offsets having the bit set
+        std::uint64_t bestOffsets = ~(std::uint64_t)0;
+        score = 0;
+
+        for(int plane = counterPlanes - 1; plane >= 0; plane--){
+            std::uint64_t candidates = bestOffsets & counters[plane];
+            if(candidates){
+                bestOffsets = candidates;
+                score |= 1 << plane;
+            }
+        }
+
+        // The first offset wins on a tie, offset 0 being the MSB
+        std::uint8_t bestOffset = __builtin_clzll(bestOffsets);
+
+        for(int offset = 64; offset < 66; offset++){
+            if(tailCounters[offset - 64] > score){
+                score = tailCounters[offset - 64];
+                bestOffset = offset;
+            }
+        }
+
+        return bestOffset;
+    }
+
+    /// @brief Acquire the frame alignment of the buffer
+    /// @param buffer Pointer to the raw data
+    /// @param bufferBits Number of valid bits in the buffer
+    /// @param bitPosition Bit of the buffer where the search starts
+    /// @param alignment Offset of the acquired alignment from bitPosition (0 - 65)
+    /// @return True if an alignment sufficing the sync error treshold was found
+    bool rx::acquireSync(const std::uint32_t * buffer, std::size_t bufferBits, std::size_t bitPosition, std::uint8_t & alignment){
+        // Number of frames scored to pick the candidate, a wrong alignment matches all of them with a probability of 2^-16
+        constexpr int candidateSampleSize = 16;
+
+        std::uint64_t startTicks = readTicks();
+        int score;
+        int sampledFrames;
+
+        // First pass, score all the alignments on a short prefix and verify the best one on the whole sample
+        std::uint8_t candidate = acquireAlignment(buffer, bufferBits, bitPosition, std::min(candidateSampleSize, syncErrorSampleSize_), score, sampledFrames);
+
+        score = 0;
+        sampledFrames = 0;
+        for(std::size_t base = bitPosition; base + 128 <= bufferBits && sampledFrames < syncErrorSampleSize_; base += 66){
+            std::uint8_t syncBits = extractSyncBits(buffer, base + candidate);
+            score += (syncBits == 0b01 || syncBits == 0b10);
+            sampledFrames++;
+        }
+
+        // Second pass, if the prefix was too damaged to pick the right candidate, score all the alignments on the whole sample
+        if(score * 100 < sampledFrames * syncErrorTresholdPercentage_){
+            candidate = acquireAlignment(buffer, bufferBits, bitPosition, syncErrorSampleSize_, score, sampledFrames);
+        }
+
+        // At least five frames are needed to tell the correct alignment from a random one,
+        // the best alignment still has to suffice the sync error treshold
+        bool found = sampledFrames >= 5 && score * 100 >= sampledFrames * syncErrorTresholdPercentage_;
+        metrics_.addSync(found, readTicks() - startTicks);
+
+        if(!found) return false;
+
+        alignment = candidate;
+        return true;
+    }
+
+    bool rx::synchronize(){ 
+        std::uint8_t bitSlip;
+
+        if(!acquireSync(rxBuffer_, rxBufferSize_ * 32, 0, bitSlip)) return false;
+
+        this->bitSlip_ = bitSlip;
+        this->synced_ = true;
+        return true;
     }
 
     // Return the current bitslip
@@ -107,36 +183,160 @@ namespace aurora{
         return this->bitSlip_;
     }
 
-    std::uint64_t rx::getPacketData(int packetIndex){
-        int syncIndex = getSyncIndex(packetIndex);
-        std::uint8_t syncShift = getSyncShift(packetIndex);
+    // Return how many times the lock was lost since the construction
+    std::uint32_t rx::getRelockCount(){
+        return this->relockCounter_;
+    }
 
-        std::uint64_t data;
+    const rxMetrics & rx::getMetrics() const{
+        return this->metrics_;
+    }
 
-        // Reconstruct the packet data
-        if(syncShift == 31){
-            data = 0
-                   | ((std::uint64_t)(rxBuffer_[syncIndex+1] & 0x7FFFFFFF) << 33)
-                   | ((std::uint64_t) rxBuffer_[syncIndex+2]               << 1)
-                   | ((std::uint64_t)(rxBuffer_[syncIndex+3] & 0x80000000) >> 31);
-        }else{
-            data = 0
-                 | ((std::uint64_t)((rxBuffer_[syncIndex]     & (0x3FFFFFFF >> syncShift)))           << (32 + syncShift + 2))
-                 | ((std::uint64_t)  rxBuffer_[syncIndex+1])                                          << (syncShift + 2)
-                 | ((std::uint64_t)((rxBuffer_[syncIndex+2]   & (0xFFFFFFFF << (30 - syncShift))))    >> (30 - syncShift));
+    /// @brief Recompute the error percentage of the last decoded buffer
+    /// @param frames Number of frames decoded since frameErrors_ was cleared
+    void rx::updateBerCounter(std::size_t frames){
+        berCounter_ = frames ? (frameErrors_ * 100) / frames : 0;
+    }
+
+    /// @brief Recover from a lost lock by acquiring the alignment again on the rest of the buffer
+    /// @param buffer Pointer to the raw data
+    /// @param bufferBits Number of valid bits in the buffer
+    /// @param bitPosition Bit where the search starts, on success moved to the first frame of the new alignment
+    /// @param chunk Chunk following the carried words when the buffer is the stitch buffer of feedStream, nullptr otherwise
+    /// @param chunkSize Number of words in the chunk
+    /// @return True if the lock was re-acquired, otherwise the receiver drops out of sync
+    bool rx::relock(const std::uint32_t * buffer, std::size_t bufferBits, std::size_t & bitPosition, const std::uint32_t * chunk, std::size_t chunkSize){
+        relockCounter_++;
+        metrics_.addRelock();
+
+        // The frames of the new alignment start a new descrambler chain and a clean lock window
+        hasPreviousData_ = false;
+        lockErrors_ = 0;
+        lockHistory_ = 0;
+
+        if(chunk){
+            // The stitch buffer holds the carried words and only a few words of the chunk, which is too short for the search.
+            // Search the carried words joined with as much of the chunk as the sample needs, the positions stay the same
+            std::size_t sampleBits = bitPosition + (getSyncSampleWords() + 3) * 32;
+            std::size_t chunkWords = std::min(chunkSize, sampleBits / 32 - std::min(sampleBits / 32, carryWords_));
+
+            relockBuffer_.assign(buffer, buffer + carryWords_);
+            relockBuffer_.insert(relockBuffer_.end(), chunk, chunk + chunkWords);
+            buffer = relockBuffer_.data();
+            bufferBits = relockBuffer_.size() * 32;
         }
 
-        return data;
+        std::uint8_t alignment;
+        if(!acquireSync(buffer, bufferBits, bitPosition, alignment)){
+            // Not enough data left to acquire the alignment, the next buffer starts with a full synchronization
+            synced_ = false;
+            return false;
+        }
+
+        bitPosition += alignment;
+        return true;
+    }
+
+    std::size_t rx::getSyncSampleWords() const{
+        //The sample frames start 66 bits apart and every one is read with 128 bits of margin, at least five frames are sampled
+        std::size_t frames = std::max(syncErrorSampleSize_, 5);
+        return ((frames - 1) * 66 + 128 + 31) / 32;
+    }
+
+    /// @brief Acquire the alignment of a new stream on the unsynced input
+    /// @param data Pointer to the raw data chunk
+    /// @param size Number of words in the chunk
+    /// @return Number of words of the chunk moved to the sync buffer or dropped, the stream starts with the sync buffer followed by the rest of the chunk
+    std::size_t rx::acquireStream(const std::uint32_t * data, std::size_t size){
+        std::size_t sampleWords = getSyncSampleWords();
+        std::size_t used = 0;
+        std::uint8_t alignment;
+
+        while(used < size){
+            if(syncBuffer_.empty() && size - used >= sampleWords){
+                //The chunk holds a whole sample, synchronize on it in place
+                if(acquireSync(data + used, (size - used) * 32, 0, alignment)){
+                    this->bitSlip_ = alignment;
+                    this->synced_ = true;
+                    return used;
+                }
+
+                //Only the sample was checked, the search goes on past it
+                used += sampleWords;
+                continue;
+            }
+
+            //The short chunks are collected until they hold a whole sample
+            std::size_t count = std::min(size - used, sampleWords - syncBuffer_.size());
+            syncBuffer_.insert(syncBuffer_.end(), data + used, data + used + count);
+            used += count;
+
+            if(syncBuffer_.size() < sampleWords) break;
+
+            if(acquireSync(syncBuffer_.data(), syncBuffer_.size() * 32, 0, alignment)){
+                this->bitSlip_ = alignment;
+                this->synced_ = true;
+                return used;
+            }
+
+            syncBuffer_.clear();
+        }
+
+        return used;
     }
 
-    void rx::descramblePacketData(std::uint64_t & currentData, std::uint64_t previousData){
-        for(int i = 63; i >= 0; i--){
-            // Shift back the new bit to the previous buffer
-            previousData = (previousData << 1) | ((currentData >> i) & 1);
-            // Clean out a bit in the current data buffer and replace it with the descrambled one
-            currentData = (currentData & ~((std::uint64_t)1 << i)) |
-                          ((std::uint64_t)(((previousData >> 0) & 1) ^ ((previousData >> 39) & 1) ^ ((previousData >> 58) & 1)) << i);
+    std::uint64_t rx::getPacketData(int packetIndex){
+        return extractPacketData(rxBuffer_, this->bitSlip_ + (66 * packetIndex));
+    }
+
+    /// @brief Descramble a block of consecutive payloads in place
+    /// @param data Pointer to the scrambled payloads, replaced by the descrambled ones
+    /// @param count Number of payloads in the block
+    /// @param previousData Scrambled payload preceding the first payload of the block
+    /// @return The last scrambled payload of the block (state to continue with the next block)
+    std::uint64_t rx::descramblePacketBlock(std::uint64_t * data, std::size_t count, std::uint64_t previousData){
+        std::size_t idx = 0;
+
+#if defined(__AVX512F__)
+        // Eight payloads per iteration, the previous payloads are the current ones shifted by one lane
+        __m512i previousVector = _mm512_set1_epi64((long long)previousData);
+        for(; idx + 8 <= count; idx += 8){
+            __m512i currentVector = _mm512_loadu_si512((const void *)(data + idx));
+            __m512i shiftedVector = _mm512_alignr_epi64(currentVector, previousVector, 7);
+
+            __m512i tap39 = _mm512_or_si512(_mm512_srli_epi64(currentVector, 39), _mm512_slli_epi64(shiftedVector, 25));
+            __m512i tap58 = _mm512_or_si512(_mm512_srli_epi64(currentVector, 58), _mm512_slli_epi64(shiftedVector, 6));
+            _mm512_storeu_si512((void *)(data + idx), _mm512_xor_si512(currentVector, _mm512_xor_si512(tap39, tap58)));
+
+            previousVector = currentVector;
+        }
+        if(idx) previousData = (std::uint64_t)_mm_extract_epi64(_mm512_extracti32x4_epi32(previousVector, 3), 1);
+#elif defined(__AVX2__)
+        // Four payloads per iteration, the previous payloads are the current ones rotated by one lane
+        // with the lowest lane taken from the last payload of the previous iteration
+        __m256i previousRotated = _mm256_set1_epi64x((long long)previousData);
+        for(; idx + 4 <= count; idx += 4){
+            __m256i currentVector = _mm256_loadu_si256((const __m256i *)(data + idx));
+            __m256i currentRotated = _mm256_permute4x64_epi64(currentVector, 0x93);
+            __m256i shiftedVector = _mm256_blend_epi32(currentRotated, previousRotated, 0x03);
+
+            __m256i tap39 = _mm256_or_si256(_mm256_srli_epi64(currentVector, 39), _mm256_slli_epi64(shiftedVector, 25));
+            __m256i tap58 = _mm256_or_si256(_mm256_srli_epi64(currentVector, 58), _mm256_slli_epi64(shiftedVector, 6));
+            _mm256_storeu_si256((__m256i *)(data + idx), _mm256_xor_si256(currentVector, _mm256_xor_si256(tap39, tap58)));
+
+            previousRotated = currentRotated;
         }
+        if(idx) previousData = (std::uint64_t)_mm256_extract_epi64(previousRotated, 0);
+#endif
+
+        // Scalar path for the remaining payloads (or the whole block without SIMD support)
+        for(std::uint64_t * word = data + idx; word != data + count; word++){
+            std::uint64_t scrambledData = *word;
+            descramblePacketData(*word, previousData);
+            previousData = scrambledData;
+        }
+
+        return previousData;
     }
 
     packet rx::getPacket(){
@@ -170,30 +370,79 @@ namespace aurora{
         return p;
     }
 
+    void rx::setRxBuffer(const std::uint32_t * rxBuffer, std::size_t rxBufferSize){
+        this->rxBuffer_ = rxBuffer;
+        this->rxBufferSize_ = rxBufferSize;
+    }
+
+    bool rx::isSynchronized(){
+        return this->synced_;
+    }
+
     void rx::processRxBuffer(bool discardControl){
-        //Clear the buffer and zero out BER
+        //Clear the buffer and fill it with all the packets of the rx buffer
         packetBuffer_.clear();
-        packetIdx_ = 0;
-        berCounter_ = 0;
+        processRxBuffer([this](const packet & p){ packetBuffer_.push_back(p); }, discardControl);
+    }
 
-        std::uint16_t maxIndex = 0;
+    /// @brief Decode the buffer straight into caller owned memory
+    /// @param output Array receiving the decoded packets
+    /// @param capacity Number of packets the array can hold, the packets beyond it are counted but not stored
+    /// @param discardControl Do not store the control frames
+    /// @return Number of packets decoded from the buffer
+    std::size_t rx::processRxBuffer(packet * output, std::size_t capacity, bool discardControl){
+        std::size_t count = 0;
 
-        //If there is no bitslip, one more packet can be read
-        if(bitSlip_){
-            maxIndex = (rxBufferSize_*32)/66 - 1;
-        }else maxIndex = (rxBufferSize_*32)/66;
-        
-        //Go through the buffer and retreive all available packets
-        for(int idx = 0; idx < maxIndex; idx++){
-            packet p = getPacket(true);
-            if(p.type == packet::type::error) berCounter_++;
-            if(!(discardControl && p.type == packet::type::control)){
-                packetBuffer_.push_back(p);
-            } 
-        }
+        processRxBuffer([&](const packet & p){
+            if(count < capacity) output[count] = p;
+            count++;
+        }, discardControl);
+
+        return count;
+    }
+
+    void rx::resetStream(){
+        carryWords_ = 0;
+        streamPosition_ = 0;
+        previousData_ = 0;
+        hasPreviousData_ = false;
+        streamStarted_ = false;
+        frameErrors_ = 0;
+        lockErrors_ = 0;
+        lockHistory_ = 0;
+        syncBuffer_.clear();
+    }
+
+    /// @brief Decode a chunk of a continuous stream into the packet buffer
+    /// @param data Pointer to the raw data chunk with 32bit MSB unscrambled data words
+    /// @param size Number of words in the chunk
+    /// @param discardControl Do not store the control frames into the packet buffer
+    void rx::feed(const std::uint32_t * data, std::size_t size, bool discardControl){
+        packetBuffer_.clear();
+        feed(data, size, [this](const packet & p){ packetBuffer_.push_back(p); }, discardControl);
+    }
+
+    dataPacket::dataPacket(std::uint64_t data) : data_(data) {}
+
+    dataPacket::dataPacket(const packet & packet) : data_(packet.data) {}
+
+    //Return the whole 64bit payload
+    std::uint64_t dataPacket::getData() const{
+        return this->data_;
+    }
+
+    controlPacket::controlPacket(std::uint64_t data) : data_(data) {}
+
+    controlPacket::controlPacket(const packet & packet) : data_(packet.data) {}
+
+    //Return the block type field (the top byte of the payload)
+    packet::btf controlPacket::getBlockType() const{
+        return static_cast<packet::btf>(this->data_ >> 56);
+    }
 
-        //Divide the error frames by the number of frames received
-        berCounter_ = (berCounter_ * 100) / (maxIndex + 1);
+    //Return the 56 data bits following the block type field
+    std::uint64_t controlPacket::getData() const{
+        return this->data_ & 0x00FFFFFFFFFFFFFF;
     }
 
     //Return the reference to the internal buffer
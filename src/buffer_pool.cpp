@@ -0,0 +1,166 @@
+#include "buffer_pool.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+
+namespace aurora{
+
+    pageMemory::~pageMemory(){
+        release();
+    }
+
+    /// @brief Map and fault in anonymous memory
+    /// @param size Requested size in bytes
+    /// @param hugePages Try the reserved huge pages first and the transparent huge pages second
+    /// @param lock Lock the mapping in memory, a failure (RLIMIT_MEMLOCK) only leaves it unlocked
+    /// @return True if the memory was mapped
+    bool pageMemory::allocate(std::size_t size, bool hugePages, bool lock){
+        release();
+        if(!size) return false;
+
+        void * map = MAP_FAILED;
+        std::size_t mapSize = (size + pageSize - 1) / pageSize * pageSize;
+
+#if defined(MAP_HUGETLB)
+        if(hugePages){
+            //The reserved huge pages need the size in whole huge pages and fail if the pool (vm.nr_hugepages) is too small
+            std::size_t hugeSize = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+            map = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+            if(map != MAP_FAILED){
+                mapSize = hugeSize;
+                backing_ = backing::hugeTlb;
+            }
+        }
+#endif
+
+        if(map == MAP_FAILED){
+            map = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(map == MAP_FAILED) return false;
+
+            backing_ = backing::standardPages;
+#if defined(MADV_HUGEPAGE)
+            //Has to be advised before the first touch, the pages are faulted in below
+            if(hugePages && madvise(map, mapSize, MADV_HUGEPAGE) == 0) backing_ = backing::transparentHugePages;
+#endif
+        }
+
+        //Fault in every page now instead of in the hot loop
+        std::memset(map, 0, mapSize);
+
+        data_ = map;
+        size_ = mapSize;
+        locked_ = lock && mlock(map, mapSize) == 0;
+
+        return true;
+    }
+
+    void pageMemory::release(){
+        if(data_){
+            if(locked_) munlock(data_, size_);
+            munmap(data_, size_);
+        }
+
+        data_ = nullptr;
+        size_ = 0;
+        backing_ = backing::none;
+        locked_ = false;
+    }
+
+    void * pageMemory::data() const{
+        return this->data_;
+    }
+
+    std::size_t pageMemory::size() const{
+        return this->size_;
+    }
+
+    pageMemory::backing pageMemory::getBacking() const{
+        return this->backing_;
+    }
+
+    bool pageMemory::isLocked() const{
+        return this->locked_;
+    }
+
+    /// @brief Construct the pool and fault in all of its buffers
+    /// @param bufferCount Number of buffers
+    /// @param bufferSize Size of every buffer in bytes, rounded up to whole pages
+    /// @param hugePages Back the pool with huge pages if they are available
+    /// @param lock Lock the pool in memory
+    bufferPool::bufferPool(std::size_t bufferCount, std::size_t bufferSize, bool hugePages, bool lock) :
+        bufferSize_((std::max<std::size_t>(bufferSize, 1) + pageMemory::pageSize - 1) / pageMemory::pageSize * pageMemory::pageSize),
+        bufferCount_(bufferCount),
+        free_(bufferCount)
+    {
+        if(!memory_.allocate(bufferSize_ * bufferCount_, hugePages, lock)){
+            bufferCount_ = 0;
+            return;
+        }
+
+        for(std::size_t idx = 0; idx < bufferCount_; idx++){
+            free_.push((std::uint32_t)idx);
+        }
+    }
+
+    bool bufferPool::isAllocated() const{
+        return memory_.data() != nullptr;
+    }
+
+    /// @brief Take a free buffer
+    /// @param index Index of the taken buffer
+    /// @return False if all the buffers are in use
+    bool bufferPool::acquire(std::size_t & index){
+        std::uint32_t freeIndex;
+        if(!free_.pop(freeIndex)) return false;
+
+        index = freeIndex;
+        return true;
+    }
+
+    /// @brief Return a buffer taken by acquire
+    /// @param index Index of the buffer
+    void bufferPool::release(std::size_t index){
+        //The queue holds every buffer at most once, so it never runs full
+        free_.push((std::uint32_t)index);
+
+        //A waiter announces itself before its last look at the queue, so either it sees the buffer or the release sees it
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(!waiters_.load(std::memory_order_relaxed)) return;
+
+        {
+            std::lock_guard<std::mutex> lock(waitMutex_);
+        }
+        released_.notify_all();
+    }
+
+    /// @brief Sleep until a buffer is returned to the pool, returns at once if one is free
+    void bufferPool::waitForFree(){
+        std::unique_lock<std::mutex> lock(waitMutex_);
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        released_.wait(lock, [this]{ return free_.size() != 0; });
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::size_t bufferPool::getIndex(const void * address) const{
+        return (static_cast<const std::uint8_t *>(address) - static_cast<const std::uint8_t *>(memory_.data())) / bufferSize_;
+    }
+
+    std::size_t bufferPool::getBufferSize() const{
+        return this->bufferSize_;
+    }
+
+    std::size_t bufferPool::getBufferCount() const{
+        return this->bufferCount_;
+    }
+
+    std::size_t bufferPool::getFreeCount() const{
+        return free_.size();
+    }
+
+    const pageMemory & bufferPool::getMemory() const{
+        return memory_;
+    }
+}
@@ -0,0 +1,237 @@
+#include "capture.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace fastic{
+
+    /// @brief Construct the synthesizer
+    /// @param config Stream and error injection settings
+    captureSynthesizer::captureSynthesizer(const config & config) : config_(config), random_(config.seed)
+    {
+        config_.bitSlip %= 66;
+        if(!config_.extensionInterval) config_.extensionInterval = 1;
+        if(!config_.meanEventSpacing) config_.meanEventSpacing = 1;
+
+        tx_ = aurora::tx(config_.bitSlip, random_());
+    }
+
+    /// @brief Sync header of the next block
+    /// @param control True for a control block
+    /// @return The 2bit header, an invalid one at the configured rate
+    std::uint8_t captureSynthesizer::nextHeader(bool control){
+        if(config_.headerErrorRate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(random_) < config_.headerErrorRate){
+            //Both 00 and 11 are invalid sync headers
+            headerErrors_++;
+            return random_() & 1 ? 0b11 : 0b00;
+        }
+
+        return control ? aurora::tx::controlHeader : aurora::tx::dataHeader;
+    }
+
+    /// @brief Produce the payload of the next block
+    /// @param control Set if the payload is a control block
+    /// @return The descrambled payload
+    std::uint64_t captureSynthesizer::nextPayload(bool & control){
+        if(config_.idleRate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(random_) < config_.idleRate){
+            control = true;
+            idleCounter_++;
+            return (std::uint64_t)aurora::packet::btf::idle << 56;
+        }
+
+        //The two halves of the statistics packet go out back to back
+        if(statisticsDue_){
+            control = true;
+            return statisticsWords_[2 - statisticsDue_--];
+        }
+
+        //The extension packet precedes the events it extends
+        if(extensionDue_){
+            control = true;
+            extensionDue_ = false;
+            extensionCounter_++;
+            return extensionWord(sentEvents_, (time_ >> 22) & 0xFFFFFF);
+        }
+
+        control = false;
+        std::uint64_t randomBits = random_();
+        time_ += randomBits % (2 * config_.meanEventSpacing);
+        sentEvents_++;
+        eventCounter_++;
+        if(sentEvents_ % config_.extensionInterval == 0) extensionDue_ = true;
+
+        if(config_.statisticsInterval && sentEvents_ % config_.statisticsInterval == 0){
+            //The free running counters grow by a random amount and wrap at their width
+            for(std::uint32_t & counter : statisticsCounters_) counter += random_() % 4096;
+            statisticsWords_ = statisticsWords(statisticsPacket(statisticsCounters_[0], statisticsCounters_[1], statisticsCounters_[2], statisticsCounters_[3], statisticsCounters_[4]));
+            statisticsDue_ = 2;
+            statisticsCounter_++;
+        }
+
+        //Trigger on every 16th event on average, otherwise one of the detector channels
+        eventPacket::channel channel = (randomBits >> 32) % 16 == 0 ? eventPacket::channel::TRIGGER : static_cast<eventPacket::channel>((randomBits >> 36) & 0x07);
+        return eventWord(channel, eventPacket::type::ToA_and_linear_ToT, time_ & 0x3FFFFF, (randomBits >> 40) & 0x3FFF);
+    }
+
+    /// @brief Append frames of the synthesized stream, bit errors go to the whole words appended by the call (the partial one is flushed by finish)
+    /// @param frames Number of frames to append
+    /// @param words Output words
+    /// @param payloads Optional output of the descrambled payloads of the frames (before the error injection)
+    void captureSynthesizer::generate(std::size_t frames, std::vector<std::uint32_t> & words, std::vector<std::uint64_t> * payloads){
+        std::size_t firstWord = words.size();
+
+        framePayloads_.resize(frames);
+        frameHeaders_.resize(frames);
+        for(std::size_t frame = 0; frame < frames; frame++){
+            bool control;
+            framePayloads_[frame] = nextPayload(control);
+            frameHeaders_[frame] = nextHeader(control);
+        }
+        if(payloads) payloads->insert(payloads->end(), framePayloads_.begin(), framePayloads_.end());
+
+        //The first call also carries the bitslip bits (idle line)
+        words.resize(firstWord + aurora::tx::getMaxWords(frames));
+        words.resize(firstWord + tx_.encode(framePayloads_.data(), frameHeaders_.data(), frames, words.data() + firstWord));
+
+        //Flip random bits, the gaps between the errors are geometrically distributed
+        if(config_.bitErrorRate > 0.0){
+            std::size_t bits = (words.size() - firstWord) * 32;
+            std::geometric_distribution<std::size_t> gap(config_.bitErrorRate);
+
+            for(std::size_t bit = gap(random_); bit < bits; bit += gap(random_) + 1){
+                words[firstWord + bit / 32] ^= (std::uint32_t)1 << (31 - bit % 32);
+                bitErrors_++;
+            }
+        }
+    }
+
+    /// @brief Flush the last partial word
+    /// @param words Output words
+    void captureSynthesizer::finish(std::vector<std::uint32_t> & words){
+        std::size_t firstWord = words.size();
+        words.resize(firstWord + aurora::tx::getMaxWords(0));
+        words.resize(firstWord + tx_.finish(words.data() + firstWord));
+    }
+
+    /// @brief Build a raw event packet
+    /// @return The 64bit data word with valid parities
+    std::uint64_t captureSynthesizer::eventWord(eventPacket::channel channel, eventPacket::type type, std::uint32_t timestamp, std::uint16_t pulseWidth, bool debug){
+        //The debug flag is not covered by any parity
+        return eventPacket(type, channel, timestamp, pulseWidth).toDataPacket().getData() | ((std::uint64_t)debug << 5);
+    }
+
+    /// @brief Build the control block of an extension packet
+    /// @return The 64bit payload including the K0 block type
+    std::uint64_t captureSynthesizer::extensionWord(std::uint32_t packetCount, std::uint32_t coarseCounter, bool reset){
+        return extensionPacket(packetCount, coarseCounter, reset).toControlPacket().getData();
+    }
+
+    /// @brief Build the control blocks of a statistics packet
+    /// @return The 64bit payloads of the K1 and the K2 half
+    std::array<std::uint64_t, 2> captureSynthesizer::statisticsWords(const statisticsPacket & packet){
+        std::array<aurora::controlPacket, 2> packets = packet.toControlPackets();
+        return {packets[0].getData(), packets[1].getData()};
+    }
+
+    std::uint64_t captureSynthesizer::getEventCount() const{
+        return this->eventCounter_;
+    }
+
+    std::uint64_t captureSynthesizer::getExtensionCount() const{
+        return this->extensionCounter_;
+    }
+
+    std::uint64_t captureSynthesizer::getStatisticsCount() const{
+        return this->statisticsCounter_;
+    }
+
+    std::uint64_t captureSynthesizer::getIdleCount() const{
+        return this->idleCounter_;
+    }
+
+    std::uint64_t captureSynthesizer::getHeaderErrors() const{
+        return this->headerErrors_;
+    }
+
+    std::uint64_t captureSynthesizer::getBitErrors() const{
+        return this->bitErrors_;
+    }
+
+    captureFile::~captureFile(){
+        close();
+    }
+
+    /// @brief Map a raw capture
+    /// @param path Path of the capture
+    /// @return True if the capture was mapped
+    bool captureFile::open(const std::string & path){
+        close();
+
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if(fd_ < 0) return false;
+
+        struct stat status;
+        if(fstat(fd_, &status) != 0 || status.st_size < (off_t)sizeof(std::uint32_t)){
+            close();
+            return false;
+        }
+
+        void * map = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if(map == MAP_FAILED){
+            close();
+            return false;
+        }
+
+        madvise(map, status.st_size, MADV_SEQUENTIAL);
+        data_ = static_cast<const std::uint32_t *>(map);
+        size_ = status.st_size / sizeof(std::uint32_t);
+
+        return true;
+    }
+
+    void captureFile::close(){
+        if(data_) munmap(const_cast<std::uint32_t *>(data_), size_ * sizeof(std::uint32_t));
+        if(fd_ >= 0) ::close(fd_);
+
+        data_ = nullptr;
+        fd_ = -1;
+        size_ = 0;
+    }
+
+    const std::uint32_t * captureFile::data() const{
+        return this->data_;
+    }
+
+    std::size_t captureFile::size() const{
+        return this->size_;
+    }
+
+    /// @brief Store a raw capture
+    /// @param path Path of the capture
+    /// @param data The receiver words
+    /// @param size Number of words
+    /// @return True if the whole capture was written
+    bool captureFile::write(const std::string & path, const std::uint32_t * data, std::size_t size){
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) return false;
+
+        const std::uint8_t * bytes = reinterpret_cast<const std::uint8_t *>(data);
+        std::size_t remaining = size * sizeof(std::uint32_t);
+
+        while(remaining){
+            ssize_t written = ::write(fd, bytes, remaining);
+            if(written < 0){
+                if(errno == EINTR) continue;
+                ::close(fd);
+                return false;
+            }
+            bytes += written;
+            remaining -= written;
+        }
+
+        return ::close(fd) == 0;
+    }
+}
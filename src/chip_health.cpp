@@ -0,0 +1,106 @@
+#include "chip_health.hpp"
+
+namespace fastic{
+
+    std::uint64_t chipHealth::snapshot::getTotal(counter counter) const{
+        return totals[static_cast<std::size_t>(counter)];
+    }
+
+    double chipHealth::snapshot::getRate(counter counter) const{
+        return rates[static_cast<std::size_t>(counter)];
+    }
+
+    std::uint32_t chipHealth::getCounterMask(counter counter){
+        unsigned int bits = (counter == counter::pulseError) ? statisticsPacket::pulseErrorBits : statisticsPacket::dropCounterBits;
+        return ((std::uint32_t)1 << bits) - 1;
+    }
+
+    std::array<std::uint32_t, chipHealth::counterCount> chipHealth::getCounters(const statisticsPacket & packet){
+        return {packet.getFifoDrop(), packet.getPulseWidthDrop(), packet.getDarkCountDrop(), packet.getTriggerDrop(), packet.getPulseError()};
+    }
+
+    /// @brief Account a statistics packet and publish the new state
+    /// @param packet Complete statistics packet of the chip
+    /// @param time Time the packet was received at in nanoseconds
+    void chipHealth::update(const statisticsPacket & packet, std::uint64_t time){
+        std::array<std::uint32_t, counterCount> counters = getCounters(packet);
+        std::array<double, counterCount> rates = {};
+
+        if(hasReference_){
+            double seconds = (time - lastTime_) * 1e-9;
+
+            for(std::size_t idx = 0; idx < counterCount; idx++){
+                //The difference modulo the counter width resolves a single wrap
+                std::uint32_t delta = (counters[idx] - lastCounters_[idx]) & getCounterMask(static_cast<counter>(idx));
+                totals_[idx] += delta;
+                rates[idx] = (time > lastTime_) ? delta / seconds : 0.0;
+            }
+        }
+
+        lastCounters_ = counters;
+        lastTime_ = time;
+        hasReference_ = true;
+        reports_++;
+
+        //Sequence lock, the readers retry while the sequence is odd or changed under them
+        std::uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for(std::size_t idx = 0; idx < counterCount; idx++){
+            publishedTotals_[idx].store(totals_[idx], std::memory_order_relaxed);
+            publishedRates_[idx].store(rates[idx], std::memory_order_relaxed);
+        }
+        publishedReports_.store(reports_, std::memory_order_relaxed);
+        publishedTime_.store(time, std::memory_order_relaxed);
+        publishedIncomplete_.store(assembler_.getIncompletePackets(), std::memory_order_relaxed);
+
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    /// @brief Pass a control packet of the chip's stream
+    /// @param control Control packet, the ones which are not statistics halves are ignored
+    /// @param time Time the packet was received at in nanoseconds
+    /// @return True if the packet completed a statistics packet
+    bool chipHealth::push(const aurora::controlPacket & control, std::uint64_t time){
+        statisticsPacket packet(0, 0, 0, 0, 0);
+        if(!assembler_.push(control, packet)) return false;
+
+        update(packet, time);
+        return true;
+    }
+
+    void chipHealth::reset(){
+        assembler_.reset();
+        //The totals stay, only the reference of the next difference is dropped
+        hasReference_ = false;
+    }
+
+    /// @brief Take a consistent copy of the published state
+    /// @return State after the last complete update
+    chipHealth::snapshot chipHealth::getSnapshot() const{
+        snapshot state;
+        std::uint64_t before, after;
+
+        do{
+            before = sequence_.load(std::memory_order_acquire);
+
+            for(std::size_t idx = 0; idx < counterCount; idx++){
+                state.totals[idx] = publishedTotals_[idx].load(std::memory_order_relaxed);
+                state.rates[idx] = publishedRates_[idx].load(std::memory_order_relaxed);
+            }
+            state.reports = publishedReports_.load(std::memory_order_relaxed);
+            state.time = publishedTime_.load(std::memory_order_relaxed);
+            state.incompletePackets = publishedIncomplete_.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence_.load(std::memory_order_relaxed);
+        }while((before & 1) || before != after);
+
+        return state;
+    }
+
+    std::uint64_t chipHealth::getReportCount() const{
+        return publishedReports_.load(std::memory_order_relaxed);
+    }
+}
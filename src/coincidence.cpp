@@ -0,0 +1,60 @@
+#include "coincidence.hpp"
+
+namespace fastic{
+
+    /// @brief Construct the matcher
+    /// @param mode Group the hits around the triggers or with each other
+    /// @param window Coincidence window in ToA ticks
+    /// @param minMultiplicity Minimal number of hits of an emitted trigger group, of distinct (lane, channel) pairs of an emitted cluster
+    coincidenceMatcher::coincidenceMatcher(mode mode, std::uint64_t window, std::size_t minMultiplicity) : mode_(mode), window_(window), minMultiplicity_(minMultiplicity)
+    {
+    }
+
+    /// @brief Drop the buffered hits older than the cutoff
+    /// @param cutoff Oldest timestamp which can still be matched
+    void coincidenceMatcher::dropHits(std::uint64_t cutoff){
+        while(hitsHead_ < hits_.size() && hits_[hitsHead_].timestamp < cutoff) hitsHead_++;
+        compact();
+    }
+
+    /// @brief Mark the channel of a hit in the open cluster
+    /// @param hit The hit
+    /// @return True if the channel of the lane was not hit by the cluster yet
+    bool coincidenceMatcher::markChannel(const timedEvent & hit){
+        std::size_t bit = (std::size_t)hit.lane * 16 + (hit.rawData >> 60);
+        if(bit / 64 >= clusterChannels_.size()) clusterChannels_.resize(bit / 64 + 1, 0);
+
+        std::uint64_t mask = (std::uint64_t)1 << (bit % 64);
+        bool newChannel = !(clusterChannels_[bit / 64] & mask);
+        clusterChannels_[bit / 64] |= mask;
+
+        return newChannel;
+    }
+
+    /// @brief Move the live hits to the front once the dropped ones take more than half of the buffer
+    void coincidenceMatcher::compact(){
+        if(hitsHead_ == hits_.size()){
+            hits_.clear();
+            hitsHead_ = 0;
+        }else if(hitsHead_ > 64 && hitsHead_ * 2 > hits_.size()){
+            hits_.erase(hits_.begin(), hits_.begin() + hitsHead_);
+            hitsHead_ = 0;
+        }
+    }
+
+    std::uint64_t coincidenceMatcher::getGroupCount() const{
+        return this->groupCounter_;
+    }
+
+    std::uint64_t coincidenceMatcher::getMatchedHits() const{
+        return this->matchedHits_;
+    }
+
+    std::uint64_t coincidenceMatcher::getProcessedEvents() const{
+        return this->processedEvents_;
+    }
+
+    std::uint64_t coincidenceMatcher::getUnorderedEvents() const{
+        return this->unorderedEvents_;
+    }
+}
@@ -0,0 +1,52 @@
+#include "decoder_metrics.hpp"
+
+namespace fastic{
+
+    decoderMetrics::decoderMetrics(const decoderMetrics & other){
+        *this = other;
+    }
+
+    decoderMetrics & decoderMetrics::operator=(const decoderMetrics & other){
+        aurora::copyCounter(events_, other.events_);
+        aurora::copyCounter(invalidEvents_, other.invalidEvents_);
+
+        for(std::size_t idx = 0; idx < parityErrors_.size(); idx++){
+            aurora::copyCounter(parityErrors_[idx], other.parityErrors_[idx]);
+        }
+
+        decode_ = other.decode_;
+        return *this;
+    }
+
+    /// @brief Publish the parity counts of a decode call
+    /// @param counts Counts collected by the call
+    void decoderMetrics::add(const parityCounts & counts){
+        aurora::addCounter(events_, counts.events);
+        if(!counts.invalidEvents) return;
+
+        aurora::addCounter(invalidEvents_, counts.invalidEvents);
+        for(std::size_t idx = 0; idx < parityErrors_.size(); idx++){
+            aurora::addCounter(parityErrors_[idx], counts.fields[idx]);
+        }
+    }
+
+    void decoderMetrics::addDecode(std::uint64_t ticks, std::uint64_t events){
+        decode_.add(ticks, events);
+    }
+
+    std::uint64_t decoderMetrics::getEvents() const{
+        return events_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t decoderMetrics::getInvalidEvents() const{
+        return invalidEvents_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t decoderMetrics::getParityErrors(field field) const{
+        return parityErrors_[static_cast<std::size_t>(field)].load(std::memory_order_relaxed);
+    }
+
+    const aurora::stageTiming & decoderMetrics::getDecodeTiming() const{
+        return decode_;
+    }
+}
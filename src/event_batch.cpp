@@ -0,0 +1,256 @@
+#include "event_batch.hpp"
+#include "event_parity.hpp"
+
+#include <cstring>
+
+namespace fastic{
+
+    namespace{
+#if defined(__AVX2__)
+        //Narrow the low dwords of two vectors of four qwords into one vector of eight dwords
+        inline __m256i packLowDwords(__m256i low, __m256i high){
+            const __m256i evenDwords = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            return _mm256_permute2x128_si256(_mm256_permutevar8x32_epi32(low, evenDwords), _mm256_permutevar8x32_epi32(high, evenDwords), 0x20);
+        }
+#endif
+    }
+
+    /// @brief Check all the parities of a raw event packet
+    /// @param rawData Raw 64bit data word of the event
+    /// @return True if the channel, type, timestamp, pulse width and combined parities are all valid
+    bool eventBatch::checkParity(std::uint64_t rawData){
+        return eventParity::check(rawData);
+    }
+
+    /// @brief Check the parities of a raw event packet one by one
+    /// @param rawData Raw 64bit data word of the event
+    /// @return Mask of the failed checks, bit i belongs to decoderMetrics::field i
+    std::uint8_t eventBatch::checkParityFields(std::uint64_t rawData){
+        return __builtin_parityll(rawData & eventParity::channelMask)
+             | __builtin_parityll(rawData & eventParity::typeMask) << 1
+             | __builtin_parityll(rawData & eventParity::timestampMask) << 2
+             | __builtin_parityll(rawData & eventParity::pulseWidthMask) << 3
+             | __builtin_parityll(rawData & eventParity::combinedMask) << 4;
+    }
+
+    void eventBatch::resize(std::size_t size){
+        channel_.resize(size);
+        type_.resize(size);
+        timestamp_.resize(size);
+        pulseWidth_.resize(size);
+        parityOk_.resize((size + 63) / 64);
+        debug_.resize((size + 63) / 64);
+    }
+
+    /// @brief Decode raw event packets column by column and append them to the batch
+    /// @param rawData Pointer to the raw (descrambled) 64bit data words
+    /// @param count Number of data words
+    void eventBatch::decode(const std::uint64_t * rawData, std::size_t count){
+        std::uint64_t startTicks = metrics_ ? aurora::readTicks() : 0;
+        std::size_t offset = size_;
+        if(size_ + count > channel_.size()) resize(size_ + count);
+        size_ += count;
+
+        std::size_t idx = 0;
+
+#if defined(__AVX2__)
+        //The bitmap is filled by whole bytes, so the vector path starts once the batch is byte aligned
+        for(; idx < count && ((offset + idx) % 8); idx++){
+            std::uint64_t data = rawData[idx];
+            channel_[offset + idx] = data >> 60;
+            type_[offset + idx] = (data >> 58) & 0x03;
+            timestamp_[offset + idx] = (data >> 20) & 0x3FFFFF;
+            pulseWidth_[offset + idx] = (data >> 6) & 0x3FFF;
+
+            std::size_t bit = offset + idx;
+            parityOk_[bit / 64] = (parityOk_[bit / 64] & ~((std::uint64_t)1 << (bit % 64))) | ((std::uint64_t)checkParity(data) << (bit % 64));
+            debug_[bit / 64] = (debug_[bit / 64] & ~((std::uint64_t)1 << (bit % 64))) | (((data >> 5) & 1) << (bit % 64));
+        }
+
+        const __m256i timestampMask = _mm256_set1_epi64x(0x3FFFFF);
+        const __m256i pulseWidthMask = _mm256_set1_epi64x(0x3FFF);
+        const __m256i typeMask = _mm256_set1_epi32(0x03);
+
+        //Eight events per iteration, every column is narrowed to its own width and stored at once
+        for(; idx + 8 <= count; idx += 8){
+            __m256i dataLow = _mm256_loadu_si256((const __m256i *)(rawData + idx));
+            __m256i dataHigh = _mm256_loadu_si256((const __m256i *)(rawData + idx + 4));
+            std::size_t position = offset + idx;
+
+            __m256i timestamps = packLowDwords(_mm256_and_si256(_mm256_srli_epi64(dataLow, 20), timestampMask),
+                                               _mm256_and_si256(_mm256_srli_epi64(dataHigh, 20), timestampMask));
+            _mm256_storeu_si256((__m256i *)(timestamp_.data() + position), timestamps);
+
+            __m256i pulseWidths = packLowDwords(_mm256_and_si256(_mm256_srli_epi64(dataLow, 6), pulseWidthMask),
+                                                _mm256_and_si256(_mm256_srli_epi64(dataHigh, 6), pulseWidthMask));
+            pulseWidths = _mm256_permute4x64_epi64(_mm256_packus_epi32(pulseWidths, pulseWidths), 0x08);
+            _mm_storeu_si128((__m128i *)(pulseWidth_.data() + position), _mm256_castsi256_si128(pulseWidths));
+
+            //Channel and type are the top 6 bits, narrowed together down to bytes
+            __m256i channelType = packLowDwords(_mm256_srli_epi64(dataLow, 58), _mm256_srli_epi64(dataHigh, 58));
+            __m256i channels = _mm256_srli_epi32(channelType, 2);
+            __m256i types = _mm256_and_si256(channelType, typeMask);
+            __m256i bytes = _mm256_packus_epi32(channels, types);
+            bytes = _mm256_packus_epi16(bytes, bytes);
+            bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 0, 0, 0, 0));
+            _mm_storel_epi64((__m128i *)(channel_.data() + position), _mm256_castsi256_si128(bytes));
+            _mm_storel_epi64((__m128i *)(type_.data() + position), _mm256_castsi256_si128(_mm256_srli_si256(bytes, 8)));
+
+            //Sign bits of the error flags give one bit per event
+            std::uint64_t errors = _mm256_movemask_pd(_mm256_castsi256_pd(eventParity::errors(dataLow)))
+                                 | (_mm256_movemask_pd(_mm256_castsi256_pd(eventParity::errors(dataHigh))) << 4);
+            reinterpret_cast<std::uint8_t *>(parityOk_.data())[position / 8] = (std::uint8_t)~errors;
+
+            //The debug flag (bit 5) moved to the sign bit
+            std::uint64_t debug = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_slli_epi64(dataLow, 58)))
+                                | (_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_slli_epi64(dataHigh, 58))) << 4);
+            reinterpret_cast<std::uint8_t *>(debug_.data())[position / 8] = (std::uint8_t)debug;
+        }
+#endif
+
+        //Scalar path for the rest of the events (or all of them without AVX2)
+        for(; idx < count; idx++){
+            std::uint64_t data = rawData[idx];
+            channel_[offset + idx] = data >> 60;
+            type_[offset + idx] = (data >> 58) & 0x03;
+            timestamp_[offset + idx] = (data >> 20) & 0x3FFFFF;
+            pulseWidth_[offset + idx] = (data >> 6) & 0x3FFF;
+
+            std::size_t bit = offset + idx;
+            parityOk_[bit / 64] = (parityOk_[bit / 64] & ~((std::uint64_t)1 << (bit % 64))) | ((std::uint64_t)checkParity(data) << (bit % 64));
+            debug_[bit / 64] = (debug_[bit / 64] & ~((std::uint64_t)1 << (bit % 64))) | (((data >> 5) & 1) << (bit % 64));
+        }
+
+        if(!metrics_) return;
+
+        //Only the events which failed the combined check above are checked field by field
+        decoderMetrics::parityCounts counts;
+        for(idx = 0; idx < count; idx++){
+            if(!hasValidParity(offset + idx)) counts.add(checkParityFields(rawData[idx]));
+        }
+        counts.events = count;
+
+        metrics_->add(counts);
+        metrics_->addDecode(aurora::readTicks() - startTicks, count);
+    }
+
+    /// @brief Build raw event packets from the columns
+    /// @param first Index of the first event
+    /// @param count Number of events
+    /// @param rawData Output of the 64bit data words
+    void eventBatch::encode(std::size_t first, std::size_t count, std::uint64_t * rawData) const{
+        std::size_t idx = 0;
+
+#if defined(__AVX2__)
+        const __m256i channelParityBit = _mm256_set1_epi64x(0x10);
+        const __m256i typeParityBit = _mm256_set1_epi64x(0x08);
+        const __m256i timestampParityBit = _mm256_set1_epi64x(0x04);
+        const __m256i pulseWidthParityBit = _mm256_set1_epi64x(0x02);
+
+        //Four events per iteration, the columns are widened to qwords and shifted into place
+        for(; idx + 4 <= count; idx += 4){
+            std::size_t position = first + idx;
+            std::uint32_t channels, types;
+            std::memcpy(&channels, channel_.data() + position, sizeof(channels));
+            std::memcpy(&types, type_.data() + position, sizeof(types));
+
+            __m256i data = _mm256_slli_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128(channels)), 60);
+            data = _mm256_or_si256(data, _mm256_slli_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128(types)), 58));
+            data = _mm256_or_si256(data, _mm256_slli_epi64(_mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(timestamp_.data() + position))), 20));
+            data = _mm256_or_si256(data, _mm256_slli_epi64(_mm256_cvtepu16_epi64(_mm_loadl_epi64((const __m128i *)(pulseWidth_.data() + position))), 6));
+            //The debug flag is not covered by any parity, it is added with them
+            __m256i debug = _mm256_setr_epi64x((long long)getDebugBit(position) << 5, (long long)getDebugBit(position + 1) << 5,
+                                               (long long)getDebugBit(position + 2) << 5, (long long)getDebugBit(position + 3) << 5);
+
+            //Prefix parity as in eventParity::errors, the parity bits are still zero so every field ends at a prefix bit
+            __m256i prefix = _mm256_xor_si256(data, _mm256_slli_epi64(data, 1));
+            prefix = _mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 2));
+            prefix = _mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 4));
+            prefix = _mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 8));
+            prefix = _mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 16));
+            prefix = _mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 32));
+
+            //Channel prefix[63] ^ prefix[59], type prefix[59] ^ prefix[57], timestamp prefix[41] ^ prefix[19], pulse width prefix[19], all of them prefix[63]
+            __m256i parities = _mm256_and_si256(_mm256_srli_epi64(_mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 4)), 59), channelParityBit);
+            parities = _mm256_or_si256(parities, _mm256_and_si256(_mm256_srli_epi64(_mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 2)), 56), typeParityBit));
+            parities = _mm256_or_si256(parities, _mm256_and_si256(_mm256_srli_epi64(_mm256_xor_si256(prefix, _mm256_slli_epi64(prefix, 22)), 39), timestampParityBit));
+            parities = _mm256_or_si256(parities, _mm256_and_si256(_mm256_srli_epi64(prefix, 18), pulseWidthParityBit));
+            parities = _mm256_or_si256(parities, _mm256_srli_epi64(prefix, 63));
+
+            _mm256_storeu_si256((__m256i *)(rawData + idx), _mm256_or_si256(data, _mm256_or_si256(parities, debug)));
+        }
+#endif
+
+        //Scalar path for the rest of the events (or all of them without AVX2)
+        for(; idx < count; idx++){
+            std::size_t position = first + idx;
+            rawData[idx] = eventPacket(static_cast<eventPacket::type>(type_[position]), static_cast<eventPacket::channel>(channel_[position]),
+                                       timestamp_[position], pulseWidth_[position]).toDataPacket().getData()
+                         | ((std::uint64_t)getDebugBit(position) << 5);
+        }
+    }
+
+    void eventBatch::clear(){
+        size_ = 0;
+    }
+
+    void eventBatch::setMetrics(decoderMetrics * metrics){
+        metrics_ = metrics;
+    }
+
+    void eventBatch::reserve(std::size_t capacity){
+        if(capacity > channel_.size()) resize(capacity);
+    }
+
+    std::size_t eventBatch::size() const{
+        return size_;
+    }
+
+    const std::uint8_t * eventBatch::getChannels() const{
+        return channel_.data();
+    }
+
+    const std::uint8_t * eventBatch::getTypes() const{
+        return type_.data();
+    }
+
+    const std::uint32_t * eventBatch::getTimestamps() const{
+        return timestamp_.data();
+    }
+
+    const std::uint16_t * eventBatch::getPulseWidths() const{
+        return pulseWidth_.data();
+    }
+
+    const std::uint64_t * eventBatch::getParityBitmap() const{
+        return parityOk_.data();
+    }
+
+    const std::uint64_t * eventBatch::getDebugBitmap() const{
+        return debug_.data();
+    }
+
+    eventPacket::channel eventBatch::getChannel(std::size_t index) const{
+        return static_cast<eventPacket::channel>(channel_[index]);
+    }
+
+    eventPacket::type eventBatch::getType(std::size_t index) const{
+        return static_cast<eventPacket::type>(type_[index]);
+    }
+
+    std::uint32_t eventBatch::getTimestamp(std::size_t index) const{
+        return timestamp_[index];
+    }
+
+    std::uint16_t eventBatch::getPulseWidth(std::size_t index) const{
+        return pulseWidth_[index];
+    }
+
+    bool eventBatch::hasValidParity(std::size_t index) const{
+        return (parityOk_[index / 64] >> (index % 64)) & 1;
+    }
+
+    bool eventBatch::getDebugBit(std::size_t index) const{
+        return (debug_[index / 64] >> (index % 64)) & 1;
+    }
+}
@@ -0,0 +1,366 @@
+#include "event_file.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace fastic{
+
+    namespace{
+        constexpr char fileMagic[8] = {'F', 'A', 'S', 'T', 'I', 'C', 'E', 'V'};
+        constexpr char chunkMagic[4] = {'C', 'H', 'N', 'K'};
+
+        //Size of the packed timestamp column in 64bit words
+        inline std::size_t timestampWords(std::size_t events, std::uint32_t width){
+            return (events * width + 63) / 64;
+        }
+
+        //Size of the field column in 64bit words
+        inline std::size_t fieldWords(std::size_t events){
+            return (events + 1) / 2;
+        }
+    }
+
+    /// @brief Construct the writer
+    /// @param chunkEvents Number of events per chunk
+    eventFileWriter::eventFileWriter(std::size_t chunkEvents) : chunkEvents_(chunkEvents ? chunkEvents : eventFile::defaultChunkEvents)
+    {
+        timestamps_.reserve(chunkEvents_);
+        fields_.reserve(chunkEvents_);
+    }
+
+    eventFileWriter::~eventFileWriter(){
+        close();
+    }
+
+    bool eventFileWriter::writeAll(const void * data, std::size_t size){
+        const std::uint8_t * bytes = static_cast<const std::uint8_t *>(data);
+
+        while(size){
+            ssize_t written = ::write(fd_, bytes, size);
+            if(written < 0){
+                if(errno == EINTR) continue;
+                return false;
+            }
+            bytes += written;
+            size -= written;
+        }
+
+        return true;
+    }
+
+    /// @brief Create the file and write its header
+    /// @param path Path of the file
+    /// @return True if the file was created
+    bool eventFileWriter::open(const std::string & path){
+        close();
+
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd_ < 0) return false;
+
+        eventFile::fileHeader header = {};
+        std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+        header.version = eventFile::version;
+        header.headerSize = sizeof(header);
+
+        if(!writeAll(&header, sizeof(header))){
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+
+        writtenEvents_ = 0;
+        writtenChunks_ = 0;
+        return true;
+    }
+
+    /// @brief Write the pending chunk and close the file
+    /// @return False if the last chunk could not be written
+    bool eventFileWriter::close(){
+        if(fd_ < 0) return true;
+
+        bool success = flush();
+        if(::close(fd_) != 0) success = false;
+        fd_ = -1;
+
+        return success;
+    }
+
+    bool eventFileWriter::isOpen() const{
+        return fd_ >= 0;
+    }
+
+    /// @brief Append one event
+    /// @param event Raw event data word with its global timestamp and lane
+    /// @return False if the lane does not fit the field word or a full chunk could not be written
+    bool eventFileWriter::write(const timedEvent & event){
+        if(event.lane > eventFile::maxLane) return false;
+
+        std::uint64_t data = event.rawData;
+
+        timestamps_.push_back(event.timestamp);
+        fields_.push_back(eventFile::packFields(data >> 60, (data >> 58) & 0x03, (data >> 6) & 0x3FFF, (data >> 5) & 1, eventBatch::checkParity(data), event.lane));
+
+        return timestamps_.size() < chunkEvents_ || flush();
+    }
+
+    /// @brief Append a decoded batch of one lane
+    /// @param batch Decoded events
+    /// @param globalTimestamps Global timestamps of the events of the batch (see timeReconstructor)
+    /// @param lane Lane the events were received on
+    /// @return False if the lane does not fit the field word or a full chunk could not be written
+    bool eventFileWriter::write(const eventBatch & batch, const std::uint64_t * globalTimestamps, std::uint16_t lane){
+        if(lane > eventFile::maxLane) return false;
+
+        const std::uint8_t * channels = batch.getChannels();
+        const std::uint8_t * types = batch.getTypes();
+        const std::uint16_t * pulseWidths = batch.getPulseWidths();
+
+        for(std::size_t idx = 0; idx < batch.size();){
+            std::size_t count = std::min(batch.size() - idx, chunkEvents_ - timestamps_.size());
+
+            timestamps_.insert(timestamps_.end(), globalTimestamps + idx, globalTimestamps + idx + count);
+            for(std::size_t end = idx + count; idx < end; idx++){
+                fields_.push_back(eventFile::packFields(channels[idx], types[idx], pulseWidths[idx], batch.getDebugBit(idx), batch.hasValidParity(idx), lane));
+            }
+
+            if(timestamps_.size() == chunkEvents_ && !flush()) return false;
+        }
+
+        return true;
+    }
+
+    /// @brief Append a statistics record
+    /// @param record The record
+    /// @return False if a full chunk could not be written
+    bool eventFileWriter::write(const eventFile::statisticsRecord & record){
+        statistics_.push_back(record);
+        return statistics_.size() < chunkEvents_ || flush();
+    }
+
+    /// @brief Append a statistics packet
+    /// @param packet The reassembled statistics packet (see statisticsAssembler)
+    /// @param timestamp Global time the packet was received at
+    /// @param lane Lane the packet was received on
+    /// @return False if a full chunk could not be written
+    bool eventFileWriter::write(const statisticsPacket & packet, std::uint64_t timestamp, std::uint16_t lane){
+        eventFile::statisticsRecord record = {};
+        record.timestamp = timestamp;
+        record.fifoDrop = packet.getFifoDrop();
+        record.pulseWidthDrop = packet.getPulseWidthDrop();
+        record.darkCountDrop = packet.getDarkCountDrop();
+        record.triggerDrop = packet.getTriggerDrop();
+        record.pulseError = packet.getPulseError();
+        record.lane = lane;
+
+        return write(record);
+    }
+
+    /// @brief Encode the pending events and statistics as one chunk and write it
+    /// @return False if the chunk could not be written
+    bool eventFileWriter::flush(){
+        if(fd_ < 0) return false;
+
+        std::size_t events = timestamps_.size();
+        if(!events && statistics_.empty()) return true;
+
+        //Zigzag encoded differences, the widest one gives the width of the column
+        std::uint64_t widest = 0;
+        for(std::size_t idx = 1; idx < events; idx++){
+            std::int64_t difference = (std::int64_t)(timestamps_[idx] - timestamps_[idx - 1]);
+            std::uint64_t encoded = ((std::uint64_t)difference << 1) ^ (std::uint64_t)(difference >> 63);
+            widest |= encoded;
+        }
+        std::uint32_t width = widest ? 64 - __builtin_clzll(widest) : 0;
+
+        std::size_t headerWords = sizeof(eventFile::chunkHeader) / 8;
+        std::size_t timestampSize = timestampWords(events, width);
+        std::size_t fieldSize = fieldWords(events);
+        std::size_t statisticsSize = statistics_.size() * sizeof(eventFile::statisticsRecord) / 8;
+        std::size_t chunkWords = headerWords + timestampSize + fieldSize + statisticsSize;
+
+        chunkBuffer_.assign(chunkWords, 0);
+
+        eventFile::chunkHeader header = {};
+        std::memcpy(header.magic, chunkMagic, sizeof(chunkMagic));
+        header.eventCount = events;
+        header.statisticsCount = statistics_.size();
+        header.deltaBits = width;
+        header.firstTimestamp = events ? timestamps_.front() : 0;
+        header.lastTimestamp = events ? timestamps_.back() : 0;
+        header.chunkSize = chunkWords * 8;
+        std::memcpy(chunkBuffer_.data(), &header, sizeof(header));
+
+        //Pack the differences LSB first
+        std::uint64_t * packed = chunkBuffer_.data() + headerWords;
+        if(width){
+            std::size_t bitPosition = width;
+            for(std::size_t idx = 1; idx < events; idx++, bitPosition += width){
+                std::int64_t difference = (std::int64_t)(timestamps_[idx] - timestamps_[idx - 1]);
+                std::uint64_t encoded = ((std::uint64_t)difference << 1) ^ (std::uint64_t)(difference >> 63);
+
+                std::size_t word = bitPosition / 64, offset = bitPosition % 64;
+                packed[word] |= encoded << offset;
+                if(offset + width > 64) packed[word + 1] |= encoded >> (64 - offset);
+            }
+        }
+
+        std::memcpy(packed + timestampSize, fields_.data(), events * sizeof(std::uint32_t));
+        std::memcpy(packed + timestampSize + fieldSize, statistics_.data(), statistics_.size() * sizeof(eventFile::statisticsRecord));
+
+        if(!writeAll(chunkBuffer_.data(), chunkWords * 8)) return false;
+
+        writtenEvents_ += events;
+        writtenChunks_++;
+        timestamps_.clear();
+        fields_.clear();
+        statistics_.clear();
+
+        return true;
+    }
+
+    std::uint64_t eventFileWriter::getWrittenEvents() const{
+        return this->writtenEvents_;
+    }
+
+    std::uint64_t eventFileWriter::getWrittenChunks() const{
+        return this->writtenChunks_;
+    }
+
+    std::size_t eventChunk::getEventCount() const{
+        return header_->eventCount;
+    }
+
+    std::size_t eventChunk::getStatisticsCount() const{
+        return header_->statisticsCount;
+    }
+
+    std::uint64_t eventChunk::getFirstTimestamp() const{
+        return header_->firstTimestamp;
+    }
+
+    std::uint64_t eventChunk::getLastTimestamp() const{
+        return header_->lastTimestamp;
+    }
+
+    const std::uint32_t * eventChunk::getFields() const{
+        return fields_;
+    }
+
+    const eventFile::statisticsRecord * eventChunk::getStatistics() const{
+        return statistics_;
+    }
+
+    /// @brief Decode the timestamp column of the chunk
+    /// @param timestamps Output array of getEventCount() global timestamps
+    void eventChunk::decodeTimestamps(std::uint64_t * timestamps) const{
+        std::uint32_t width = header_->deltaBits;
+        std::uint64_t mask = width == 64 ? ~(std::uint64_t)0 : ((std::uint64_t)1 << width) - 1;
+        std::uint64_t timestamp = header_->firstTimestamp;
+
+        if(!width){
+            std::fill(timestamps, timestamps + header_->eventCount, timestamp);
+            return;
+        }
+
+        std::size_t bitPosition = 0;
+        for(std::size_t idx = 0; idx < header_->eventCount; idx++, bitPosition += width){
+            std::size_t word = bitPosition / 64, offset = bitPosition % 64;
+            std::uint64_t packed = timestamps_[word] >> offset;
+            if(offset + width > 64) packed |= timestamps_[word + 1] << (64 - offset);
+            packed &= mask;
+
+            timestamp += (packed >> 1) ^ (~(packed & 1) + 1);
+            timestamps[idx] = timestamp;
+        }
+    }
+
+    eventFileReader::~eventFileReader(){
+        close();
+    }
+
+    /// @brief Map the file and validate its header
+    /// @param path Path of the file
+    /// @return True if the file is a readable event file of a supported version
+    bool eventFileReader::open(const std::string & path){
+        close();
+
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if(fd_ < 0) return false;
+
+        struct stat status;
+        if(fstat(fd_, &status) != 0 || (std::size_t)status.st_size < sizeof(eventFile::fileHeader)){
+            close();
+            return false;
+        }
+
+        void * map = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if(map == MAP_FAILED){
+            close();
+            return false;
+        }
+        map_ = static_cast<const std::uint8_t *>(map);
+        size_ = status.st_size;
+
+        //The chunks are read front to back
+        madvise(map, size_, MADV_SEQUENTIAL);
+
+        const eventFile::fileHeader * header = reinterpret_cast<const eventFile::fileHeader *>(map_);
+        if(std::memcmp(header->magic, fileMagic, sizeof(fileMagic)) != 0 || header->version != eventFile::version
+           || header->headerSize < sizeof(eventFile::fileHeader) || header->headerSize % 8 || header->headerSize > size_){
+            close();
+            return false;
+        }
+
+        rewind();
+        return true;
+    }
+
+    void eventFileReader::close(){
+        if(map_) munmap(const_cast<std::uint8_t *>(map_), size_);
+        if(fd_ >= 0) ::close(fd_);
+
+        map_ = nullptr;
+        fd_ = -1;
+        size_ = 0;
+        offset_ = 0;
+    }
+
+    bool eventFileReader::isOpen() const{
+        return map_ != nullptr;
+    }
+
+    void eventFileReader::rewind(){
+        if(map_) offset_ = reinterpret_cast<const eventFile::fileHeader *>(map_)->headerSize;
+    }
+
+    /// @brief Move to the next chunk of the file
+    /// @param chunk View of the chunk
+    /// @return False at the end of the file or if the chunk is malformed (truncated file)
+    bool eventFileReader::nextChunk(eventChunk & chunk){
+        if(!map_ || offset_ + sizeof(eventFile::chunkHeader) > size_) return false;
+
+        const eventFile::chunkHeader * header = reinterpret_cast<const eventFile::chunkHeader *>(map_ + offset_);
+        if(std::memcmp(header->magic, chunkMagic, sizeof(chunkMagic)) != 0 || header->deltaBits > 64) return false;
+
+        std::size_t timestampSize = timestampWords(header->eventCount, header->deltaBits);
+        std::size_t fieldSize = fieldWords(header->eventCount);
+        std::size_t statisticsSize = (std::size_t)header->statisticsCount * sizeof(eventFile::statisticsRecord) / 8;
+        std::size_t chunkSize = sizeof(eventFile::chunkHeader) + (timestampSize + fieldSize + statisticsSize) * 8;
+
+        if(header->chunkSize != chunkSize || chunkSize > size_ - offset_) return false;
+
+        const std::uint64_t * columns = reinterpret_cast<const std::uint64_t *>(header + 1);
+        chunk.header_ = header;
+        chunk.timestamps_ = columns;
+        chunk.fields_ = reinterpret_cast<const std::uint32_t *>(columns + timestampSize);
+        chunk.statistics_ = reinterpret_cast<const eventFile::statisticsRecord *>(columns + timestampSize + fieldSize);
+
+        offset_ += chunkSize;
+        return true;
+    }
+}
@@ -0,0 +1,177 @@
+#include "event_filter.hpp"
+#include "event_parity.hpp"
+
+namespace fastic{
+
+    namespace{
+#if defined(__AVX2__)
+        //Dword permutations moving the kept qwords of a vector (bit i of the index keeps qword i) to its front
+        struct compactionTable {
+            alignas(32) std::int32_t indices[16][8];
+
+            constexpr compactionTable() : indices{}{
+                for(int mask = 0; mask < 16; mask++){
+                    int position = 0;
+                    for(int qword = 0; qword < 4; qword++){
+                        if(!((mask >> qword) & 1)) continue;
+                        indices[mask][2 * position] = 2 * qword;
+                        indices[mask][2 * position + 1] = 2 * qword + 1;
+                        position++;
+                    }
+                }
+            }
+        };
+
+        constexpr compactionTable compaction;
+
+        //Sum of the four qwords
+        inline std::uint64_t horizontalSum(__m256i value){
+            __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+            return _mm_cvtsi128_si64(_mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum)));
+        }
+#endif
+    }
+
+    eventFilter::eventFilter() : eventFilter(config()){
+    }
+
+    /// @brief Construct the filter
+    /// @param config Criteria of the kept events
+    eventFilter::eventFilter(const config & config) :
+        config_(config)
+    {
+        passThrough_ = config_.channels == 0xFFFF && (config_.types & 0x0F) == 0x0F
+                    && config_.minPulseWidth == 0 && config_.maxPulseWidth >= 0x3FFF
+                    && config_.parity == parityPolicy::accept && !config_.rejectDebug;
+    }
+
+    /// @brief Check a single raw event word against all the criteria
+    /// @param rawData Raw 64bit data word of the event
+    /// @return True if the event passes the filter
+    bool eventFilter::accepts(std::uint64_t rawData) const{
+        std::uint16_t pulseWidth = (rawData >> 6) & 0x3FFF;
+        bool parityOk = eventParity::check(rawData);
+
+        return ((config_.channels >> (rawData >> 60)) & 1)
+            && ((config_.types >> ((rawData >> 58) & 0x03)) & 1)
+            && pulseWidth >= config_.minPulseWidth && pulseWidth <= config_.maxPulseWidth
+            && (config_.parity == parityPolicy::accept || parityOk == (config_.parity == parityPolicy::rejectInvalid))
+            && !(config_.rejectDebug && ((rawData >> 5) & 1));
+    }
+
+    /// @brief Filter raw event words and compact the survivors
+    /// @param rawData Pointer to the raw (descrambled) 64bit data words
+    /// @param count Number of data words
+    /// @param survivors Output of the kept words in their order, either rawData itself or a buffer of at least count words
+    /// @return Number of kept words
+    std::size_t eventFilter::apply(const std::uint64_t * rawData, std::size_t count, std::uint64_t * survivors){
+        std::array<std::uint64_t, criterionCount> rejects = {};
+        std::size_t kept = 0;
+        std::size_t idx = 0;
+
+        const bool checkParity = config_.parity != parityPolicy::accept;
+        const bool keepInvalid = config_.parity == parityPolicy::keepInvalid;
+
+#if defined(__AVX2__)
+        const __m256i channels = _mm256_set1_epi64x(config_.channels);
+        const __m256i types = _mm256_set1_epi64x(config_.types);
+        const __m256i minPulseWidth = _mm256_set1_epi64x(config_.minPulseWidth);
+        const __m256i maxPulseWidth = _mm256_set1_epi64x(config_.maxPulseWidth);
+        const __m256i pulseWidthMask = _mm256_set1_epi64x(0x3FFF);
+        const __m256i typeMask = _mm256_set1_epi64x(0x03);
+        const __m256i signBit = _mm256_set1_epi64x((std::int64_t)1 << 63);
+        const __m256i debugEnable = config_.rejectDebug ? signBit : _mm256_setzero_si256();
+        const __m256i parityInvert = keepInvalid ? signBit : _mm256_setzero_si256();
+
+        //Reject counts of the vector path, one lane per word position
+        __m256i channelRejects = _mm256_setzero_si256();
+        __m256i typeRejects = _mm256_setzero_si256();
+        __m256i pulseWidthRejects = _mm256_setzero_si256();
+        __m256i parityRejects = _mm256_setzero_si256();
+        __m256i debugRejects = _mm256_setzero_si256();
+
+        //Every criterion flags the rejected words in the sign bit, the kept words are permuted to the front and stored at once
+        for(; idx + 4 <= count; idx += 4){
+            __m256i data = _mm256_loadu_si256((const __m256i *)(rawData + idx));
+
+            //The configured bit of the channel / type moved to the sign bit and inverted
+            __m256i channelReject = _mm256_xor_si256(_mm256_slli_epi64(_mm256_srlv_epi64(channels, _mm256_srli_epi64(data, 60)), 63), signBit);
+            __m256i typeReject = _mm256_xor_si256(_mm256_slli_epi64(_mm256_srlv_epi64(types, _mm256_and_si256(_mm256_srli_epi64(data, 58), typeMask)), 63), signBit);
+
+            //The pulse width has 14 bits, the signed comparison is exact
+            __m256i pulseWidth = _mm256_and_si256(_mm256_srli_epi64(data, 6), pulseWidthMask);
+            __m256i pulseWidthReject = _mm256_or_si256(_mm256_cmpgt_epi64(minPulseWidth, pulseWidth), _mm256_cmpgt_epi64(pulseWidth, maxPulseWidth));
+
+            __m256i debugReject = _mm256_and_si256(_mm256_slli_epi64(data, 58), debugEnable);
+
+            __m256i parityReject = _mm256_setzero_si256();
+            if(checkParity) parityReject = _mm256_and_si256(_mm256_xor_si256(eventParity::errors(data), parityInvert), signBit);
+
+            channelRejects = _mm256_add_epi64(channelRejects, _mm256_srli_epi64(channelReject, 63));
+            typeRejects = _mm256_add_epi64(typeRejects, _mm256_srli_epi64(typeReject, 63));
+            pulseWidthRejects = _mm256_add_epi64(pulseWidthRejects, _mm256_srli_epi64(pulseWidthReject, 63));
+            parityRejects = _mm256_add_epi64(parityRejects, _mm256_srli_epi64(parityReject, 63));
+            debugRejects = _mm256_add_epi64(debugRejects, _mm256_srli_epi64(debugReject, 63));
+
+            //The store covers at most the four words just loaded, so the output may be the input itself
+            __m256i reject = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(channelReject, typeReject), _mm256_or_si256(pulseWidthReject, debugReject)), parityReject);
+            unsigned int keep = ~_mm256_movemask_pd(_mm256_castsi256_pd(reject)) & 0x0F;
+            __m256i permutation = _mm256_load_si256((const __m256i *)compaction.indices[keep]);
+            _mm256_storeu_si256((__m256i *)(survivors + kept), _mm256_permutevar8x32_epi32(data, permutation));
+            kept += __builtin_popcount(keep);
+        }
+
+        rejects[0] = horizontalSum(channelRejects);
+        rejects[1] = horizontalSum(typeRejects);
+        rejects[2] = horizontalSum(pulseWidthRejects);
+        rejects[3] = horizontalSum(parityRejects);
+        rejects[4] = horizontalSum(debugRejects);
+#endif
+
+        //Scalar path for the rest of the words (or all of them without AVX2)
+        for(; idx < count; idx++){
+            std::uint64_t data = rawData[idx];
+            std::uint16_t pulseWidth = (data >> 6) & 0x3FFF;
+
+            bool channelReject = !((config_.channels >> (data >> 60)) & 1);
+            bool typeReject = !((config_.types >> ((data >> 58) & 0x03)) & 1);
+            bool pulseWidthReject = pulseWidth < config_.minPulseWidth || pulseWidth > config_.maxPulseWidth;
+            bool parityReject = checkParity && (eventParity::check(data) == keepInvalid);
+            bool debugReject = config_.rejectDebug && ((data >> 5) & 1);
+
+            rejects[0] += channelReject;
+            rejects[1] += typeReject;
+            rejects[2] += pulseWidthReject;
+            rejects[3] += parityReject;
+            rejects[4] += debugReject;
+
+            //Written unconditionally, only the kept words advance the output
+            survivors[kept] = data;
+            kept += !(channelReject | typeReject | pulseWidthReject | parityReject | debugReject);
+        }
+
+        aurora::addCounter(events_, count);
+        aurora::addCounter(accepted_, kept);
+        for(std::size_t criterion = 0; criterion < criterionCount; criterion++){
+            if(rejects[criterion]) aurora::addCounter(rejects_[criterion], rejects[criterion]);
+        }
+
+        return kept;
+    }
+
+    const eventFilter::config & eventFilter::getConfig() const{
+        return config_;
+    }
+
+    std::uint64_t eventFilter::getEvents() const{
+        return events_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t eventFilter::getAccepted() const{
+        return accepted_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t eventFilter::getRejects(criterion criterion) const{
+        return rejects_[static_cast<std::size_t>(criterion)].load(std::memory_order_relaxed);
+    }
+}
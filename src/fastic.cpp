@@ -8,14 +8,8 @@ namespace fastic{
     bool eventPacket::calculateParity(T data){
         static_assert(std::is_integral_v<T>, "The data needs to be of integral type");
         
-        T out = data ^ (data >> 1);
-
-        for(std::uint16_t shift = 2; shift < sizeof(T)*4; shift *= 2){
-            out = out ^ (out >> shift);
-        }
-
-        //Return 0 if the parity is even 
-        return out & 1;
+        //Return 0 if the parity is even (compiles to a single popcnt where available)
+        return __builtin_parityll(static_cast<unsigned long long>(data));
     }
 
     eventPacket::eventPacket(aurora::dataPacket packet){
@@ -23,11 +17,11 @@ namespace fastic{
 
         //Parse channel data and calculate parity
         this->eventChannel_ = static_cast<eventPacket::channel>(this->rawData_ >> 60);
-        this->eventChannelParity_ = calculateParity(this->eventChannel_);
+        this->eventChannelParity_ = calculateParity(static_cast<std::uint8_t>(this->eventChannel_));
 
         //Parse type data and calculate parity
         this->eventType_ = static_cast<eventPacket::type>((this->rawData_ >> 58) & 0x03);
-        this->eventTypeParity_ = calculateParity(this->eventType_);
+        this->eventTypeParity_ = calculateParity(static_cast<std::uint8_t>(this->eventType_));
 
         //Parse timestamp data and calculate parity
         this->eventTimestamp_ = (this->rawData_ >> 20) & 0x3FFFFF;
@@ -38,6 +32,29 @@ namespace fastic{
         this->eventPulseWidthParity_ = calculateParity(this->eventPulseWidth_);
     }
 
+    eventPacket::eventPacket(type type, channel channel, std::uint32_t timestamp, std::uint16_t pulseWidth) :
+        eventChannel_(static_cast<eventPacket::channel>(static_cast<std::uint8_t>(channel) & 0x0F)),
+        eventType_(static_cast<eventPacket::type>(static_cast<std::uint8_t>(type) & 0x03)),
+        eventTimestamp_(timestamp & 0x3FFFFF),
+        eventPulseWidth_(pulseWidth & 0x3FFF)
+    {
+        this->eventChannelParity_ = calculateParity(static_cast<std::uint8_t>(this->eventChannel_));
+        this->eventTypeParity_ = calculateParity(static_cast<std::uint8_t>(this->eventType_));
+        this->eventTimestampParity_ = calculateParity(this->eventTimestamp_);
+        this->eventPulseWidthParity_ = calculateParity(this->eventPulseWidth_);
+
+        //Every parity bit makes its field even, the combined one all the fields together
+        this->rawData_ = ((std::uint64_t)this->eventChannel_ << 60) | ((std::uint64_t)this->eventType_ << 58)
+                       | ((std::uint64_t)this->eventTimestamp_ << 20) | ((std::uint64_t)this->eventPulseWidth_ << 6)
+                       | ((std::uint64_t)this->eventChannelParity_ << 4) | ((std::uint64_t)this->eventTypeParity_ << 3)
+                       | ((std::uint64_t)this->eventTimestampParity_ << 2) | ((std::uint64_t)this->eventPulseWidthParity_ << 1)
+                       | (std::uint64_t)(this->eventChannelParity_ ^ this->eventTypeParity_ ^ this->eventTimestampParity_ ^ this->eventPulseWidthParity_);
+    }
+
+    aurora::dataPacket eventPacket::toDataPacket() const{
+        return aurora::dataPacket(this->rawData_);
+    }
+
     eventPacket::channel eventPacket::getChannel(bool & isValid){
         isValid = (this->eventChannelParity_ == static_cast<bool>((this->rawData_ >> 4) & 1));
         return this->eventChannel_; 
@@ -66,6 +83,130 @@ namespace fastic{
         return ((this->eventChannelParity_ ^ this->eventTypeParity_ ^ this->eventTimestampParity_ ^ this->eventPulseWidthParity_) == static_cast<bool>(this->rawData_ & 1));
     }
 
+    std::uint8_t eventPacket::getParityErrors(){
+        return (this->eventChannelParity_ != static_cast<bool>((this->rawData_ >> 4) & 1))
+             | (this->eventTypeParity_ != static_cast<bool>((this->rawData_ >> 3) & 1)) << 1
+             | (this->eventTimestampParity_ != static_cast<bool>((this->rawData_ >> 2) & 1)) << 2
+             | (this->eventPulseWidthParity_ != static_cast<bool>((this->rawData_ >> 1) & 1)) << 3
+             | (!hasValidParity()) << 4;
+    }
+
+    statisticsPacket::statisticsPacket(std::array<aurora::controlPacket, 2> packets){
+        //Each half occupies the low 48 bits of its control frame data
+        std::uint64_t first = packets[0].getData() & 0xFFFFFFFFFFFF;
+        std::uint64_t second = packets[1].getData() & 0xFFFFFFFFFFFF;
+
+        this->statFifoDrop_ = (first >> 28) & 0xFFFFF;
+        this->statPwidthDrop_ = (first >> 8) & 0xFFFFF;
+        //The dark count field straddles the halves, 8 bits in the first one and 12 in the second one
+        this->statDcountDrop_ = ((first & 0xFF) << 12) | ((second >> 36) & 0xFFF);
+        this->statTriggerDrop_ = (second >> 16) & 0xFFFFF;
+        this->statPulseError_ = second & 0xFFFF;
+    }
+
+    statisticsPacket::statisticsPacket(std::uint32_t fifo, std::uint32_t pulsewidth, std::uint32_t darkcount, std::uint32_t trigger, std::uint16_t pulseError) :
+        statFifoDrop_(fifo & 0xFFFFF),
+        statPwidthDrop_(pulsewidth & 0xFFFFF),
+        statDcountDrop_(darkcount & 0xFFFFF),
+        statTriggerDrop_(trigger & 0xFFFFF),
+        statPulseError_(pulseError)
+    {
+    }
+
+    std::array<aurora::controlPacket, 2> statisticsPacket::toControlPackets() const{
+        std::uint64_t darkCount = this->statDcountDrop_;
+        std::uint64_t first = ((std::uint64_t)this->statFifoDrop_ << 28) | ((std::uint64_t)this->statPwidthDrop_ << 8) | (darkCount >> 12);
+        std::uint64_t second = ((darkCount & 0xFFF) << 36) | ((std::uint64_t)this->statTriggerDrop_ << 16) | this->statPulseError_;
+
+        return {aurora::controlPacket(((std::uint64_t)firstBlockType << 56) | first), aurora::controlPacket(((std::uint64_t)secondBlockType << 56) | second)};
+    }
+
+    std::uint32_t statisticsPacket::getFifoDrop() const{
+        return this->statFifoDrop_;
+    }
+
+    std::uint32_t statisticsPacket::getPulseWidthDrop() const{
+        return this->statPwidthDrop_;
+    }
+
+    std::uint32_t statisticsPacket::getDarkCountDrop() const{
+        return this->statDcountDrop_;
+    }
+
+    std::uint32_t statisticsPacket::getTriggerDrop() const{
+        return this->statTriggerDrop_;
+    }
 
+    std::uint16_t statisticsPacket::getPulseError() const{
+        return this->statPulseError_;
+    }
+
+    /// @brief Pass the next control packet of the stream to the reassembly
+    /// @param control Control packet, the ones which are not statistics halves are ignored
+    /// @param packet Receives the statistics packet once both halves are in
+    /// @return True if packet was filled with a complete statistics packet
+    bool statisticsAssembler::push(const aurora::controlPacket & control, statisticsPacket & packet){
+        aurora::packet::btf blockType = control.getBlockType();
+
+        if(blockType == statisticsPacket::firstBlockType){
+            //The previous first half never got its second one
+            incompletePackets_ += hasFirstHalf_;
+            firstHalf_ = control.getData();
+            hasFirstHalf_ = true;
+            return false;
+        }
+
+        if(blockType != statisticsPacket::secondBlockType) return false;
+
+        if(!hasFirstHalf_){
+            incompletePackets_++;
+            return false;
+        }
+
+        packet = statisticsPacket({aurora::controlPacket(firstHalf_), control});
+        hasFirstHalf_ = false;
+        return true;
+    }
+
+    void statisticsAssembler::reset(){
+        incompletePackets_ += hasFirstHalf_;
+        hasFirstHalf_ = false;
+    }
+
+    std::uint64_t statisticsAssembler::getIncompletePackets() const{
+        return incompletePackets_;
+    }
+
+    extensionPacket::extensionPacket(aurora::controlPacket packet){
+        //The 48 bit packet occupies the low bits of the control frame data
+        std::uint64_t data = packet.getData();
+
+        this->extPacketCount_ = (data >> 25) & 0x7FFFFF;
+        this->extCoarseCounter = (data >> 1) & 0xFFFFFF;
+        this->statReset_ = data & 1;
+    }
+
+    extensionPacket::extensionPacket(std::uint32_t packetCount, std::uint32_t coarseCounter, bool reset) :
+        extPacketCount_(packetCount & 0x7FFFFF),
+        extCoarseCounter(coarseCounter & 0xFFFFFF),
+        statReset_(reset)
+    {
+    }
+
+    aurora::controlPacket extensionPacket::toControlPacket() const{
+        return aurora::controlPacket(((std::uint64_t)blockType << 56) | ((std::uint64_t)this->extPacketCount_ << 25) | ((std::uint64_t)this->extCoarseCounter << 1) | (this->statReset_ ? 1 : 0));
+    }
+
+    std::uint32_t extensionPacket::getPacketCount(){
+        return this->extPacketCount_;
+    }
+
+    std::uint32_t extensionPacket::getCoarseCounter(){
+        return this->extCoarseCounter;
+    }
+
+    bool extensionPacket::getReset(){
+        return this->statReset_;
+    }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,189 @@
+#include "histogram.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace fastic{
+
+    namespace{
+#if defined(__AVX2__)
+        //Narrow the low dwords of two vectors of four qwords into one vector of eight dwords
+        inline __m256i packLowDwords(__m256i low, __m256i high){
+            const __m256i evenDwords = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            return _mm256_permute2x128_si256(_mm256_permutevar8x32_epi32(low, evenDwords), _mm256_permutevar8x32_epi32(high, evenDwords), 0x20);
+        }
+#endif
+
+        inline void incrementBin(std::atomic<std::uint32_t> & bin){
+            bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Construct a cleared accumulator
+    /// @param toaShift Lowest timestamp bit of the fine ToA bins
+    eventHistograms::accumulator::accumulator(unsigned int toaShift) :
+        toaShift_(std::min(toaShift, maxToaShift))
+    {
+        clear();
+    }
+
+    void eventHistograms::accumulator::increment(const std::uint32_t * pulseWidthIndices, const std::uint32_t * toaIndices, std::size_t count){
+        for(std::size_t idx = 0; idx < count; idx++){
+            incrementBin(pulseWidth_[pulseWidthIndices[idx]]);
+            incrementBin(toa_[toaIndices[idx]]);
+        }
+    }
+
+    /// @brief Account a run of raw event words
+    /// @param rawData Pointer to the raw (descrambled) 64bit data words
+    /// @param count Number of data words
+    void eventHistograms::accumulator::add(const std::uint64_t * rawData, std::size_t count){
+        //The bin indices of a block are computed first, the increments then run back to back
+        alignas(64) std::uint32_t pulseWidthIndices[blockSize];
+        alignas(64) std::uint32_t toaIndices[blockSize];
+
+#if defined(__AVX2__)
+        const __m256i maxChannelType = _mm256_set1_epi32(slotCount * typeCount - 1);
+        const __m256i maxSlot = _mm256_set1_epi32(slotCount - 1);
+        const __m256i pulseWidthMask = _mm256_set1_epi32(pulseWidthBins - 1);
+        const __m256i toaMask = _mm256_set1_epi32(toaBins - 1);
+        const __m128i toaShift = _mm_cvtsi32_si128(20 + toaShift_);
+#endif
+
+        for(std::size_t offset = 0; offset < count; offset += blockSize){
+            const std::uint64_t * block = rawData + offset;
+            std::size_t size = std::min(blockSize, count - offset);
+            std::size_t idx = 0;
+
+#if defined(__AVX2__)
+            //Eight events per iteration, the fields are narrowed to dwords and combined to the indices
+            for(; idx + 8 <= size; idx += 8){
+                __m256i dataLow = _mm256_loadu_si256((const __m256i *)(block + idx));
+                __m256i dataHigh = _mm256_loadu_si256((const __m256i *)(block + idx + 4));
+
+                __m256i channelType = _mm256_min_epu32(packLowDwords(_mm256_srli_epi64(dataLow, 58), _mm256_srli_epi64(dataHigh, 58)), maxChannelType);
+                __m256i pulseWidth = _mm256_and_si256(packLowDwords(_mm256_srli_epi64(dataLow, 6), _mm256_srli_epi64(dataHigh, 6)), pulseWidthMask);
+                _mm256_store_si256((__m256i *)(pulseWidthIndices + idx), _mm256_or_si256(_mm256_slli_epi32(channelType, pulseWidthBits), pulseWidth));
+
+                __m256i slot = _mm256_min_epu32(packLowDwords(_mm256_srli_epi64(dataLow, 60), _mm256_srli_epi64(dataHigh, 60)), maxSlot);
+                __m256i toa = _mm256_and_si256(packLowDwords(_mm256_srl_epi64(dataLow, toaShift), _mm256_srl_epi64(dataHigh, toaShift)), toaMask);
+                _mm256_store_si256((__m256i *)(toaIndices + idx), _mm256_or_si256(_mm256_slli_epi32(slot, toaBits), toa));
+            }
+#endif
+
+            for(; idx < size; idx++){
+                pulseWidthIndices[idx] = pulseWidthIndex(block[idx]);
+                toaIndices[idx] = toaIndex(block[idx], toaShift_);
+            }
+
+            increment(pulseWidthIndices, toaIndices, size);
+        }
+
+        aurora::addCounter(events_, count);
+    }
+
+    /// @brief Account all the events of a decoded batch
+    /// @param batch Decoded events
+    void eventHistograms::accumulator::add(const eventBatch & batch){
+        alignas(64) std::uint32_t pulseWidthIndices[blockSize];
+        alignas(64) std::uint32_t toaIndices[blockSize];
+
+        const std::uint8_t * channels = batch.getChannels();
+        const std::uint8_t * types = batch.getTypes();
+        const std::uint16_t * pulseWidths = batch.getPulseWidths();
+        const std::uint32_t * timestamps = batch.getTimestamps();
+
+        for(std::size_t offset = 0; offset < batch.size(); offset += blockSize){
+            std::size_t size = std::min(blockSize, batch.size() - offset);
+
+            //Plain column arithmetic, vectorized by the compiler
+            for(std::size_t idx = 0; idx < size; idx++){
+                std::uint32_t channelType = std::min<std::uint32_t>(channels[offset + idx] * typeCount + types[offset + idx], slotCount * typeCount - 1);
+                std::uint32_t slot = std::min<std::uint32_t>(channels[offset + idx], slotCount - 1);
+                pulseWidthIndices[idx] = (channelType << pulseWidthBits) | pulseWidths[offset + idx];
+                toaIndices[idx] = (slot << toaBits) | ((timestamps[offset + idx] >> toaShift_) & (toaBins - 1));
+            }
+
+            increment(pulseWidthIndices, toaIndices, size);
+        }
+
+        aurora::addCounter(events_, batch.size());
+    }
+
+    void eventHistograms::accumulator::clear(){
+        for(std::atomic<std::uint32_t> & bin : pulseWidth_) bin.store(0, std::memory_order_relaxed);
+        for(std::atomic<std::uint32_t> & bin : toa_) bin.store(0, std::memory_order_relaxed);
+        events_.store(0, std::memory_order_relaxed);
+    }
+
+    std::uint64_t eventHistograms::accumulator::getEvents() const{
+        return events_.load(std::memory_order_relaxed);
+    }
+
+    const std::uint64_t * eventHistograms::snapshot::getPulseWidth(eventPacket::channel channel, eventPacket::type type) const{
+        return pulseWidth.data() + ((std::size_t)channel * typeCount + (std::size_t)type) * pulseWidthBins;
+    }
+
+    const std::uint64_t * eventHistograms::snapshot::getToa(eventPacket::channel channel) const{
+        return toa.data() + (std::size_t)channel * toaBins;
+    }
+
+    std::uint64_t eventHistograms::snapshot::getChannelEvents(eventPacket::channel channel) const{
+        const std::uint64_t * bins = getToa(channel);
+        std::uint64_t events = 0;
+        for(std::size_t bin = 0; bin < toaBins; bin++) events += bins[bin];
+        return events;
+    }
+
+    std::uint64_t eventHistograms::snapshot::getInvalidChannelEvents() const{
+        const std::uint64_t * bins = toa.data() + channelCount * toaBins;
+        std::uint64_t events = 0;
+        for(std::size_t bin = 0; bin < toaBins; bin++) events += bins[bin];
+        return events;
+    }
+
+    /// @brief Construct the histograms with cleared accumulators
+    /// @param accumulatorCount Number of accumulators, one for every writing thread
+    /// @param toaShift Lowest timestamp bit of the fine ToA bins (at most maxToaShift)
+    eventHistograms::eventHistograms(std::size_t accumulatorCount, unsigned int toaShift) :
+        toaShift_(std::min(toaShift, maxToaShift))
+    {
+        for(std::size_t idx = 0; idx < accumulatorCount; idx++){
+            accumulators_.push_back(std::make_unique<accumulator>(toaShift_));
+        }
+    }
+
+    eventHistograms::accumulator & eventHistograms::getAccumulator(std::size_t index){
+        return *accumulators_[index];
+    }
+
+    std::size_t eventHistograms::getAccumulatorCount() const{
+        return accumulators_.size();
+    }
+
+    /// @brief Sum the bins of all the accumulators without stopping their writers
+    /// @return Merged histograms
+    eventHistograms::snapshot eventHistograms::getSnapshot() const{
+        snapshot merged;
+        merged.pulseWidth.assign(slotCount * typeCount * pulseWidthBins, 0);
+        merged.toa.assign(slotCount * toaBins, 0);
+        merged.toaShift = toaShift_;
+
+        for(const std::unique_ptr<accumulator> & source : accumulators_){
+            for(std::size_t bin = 0; bin < merged.pulseWidth.size(); bin++){
+                merged.pulseWidth[bin] += source->pulseWidth_[bin].load(std::memory_order_relaxed);
+            }
+            for(std::size_t bin = 0; bin < merged.toa.size(); bin++){
+                merged.toa[bin] += source->toa_[bin].load(std::memory_order_relaxed);
+            }
+            merged.events += source->getEvents();
+        }
+
+        return merged;
+    }
+
+    void eventHistograms::clear(){
+        for(std::unique_ptr<accumulator> & target : accumulators_) target->clear();
+    }
+}
@@ -0,0 +1,192 @@
+#include "metrics.hpp"
+
+namespace aurora{
+
+    double getTicksPerNanosecond(){
+#if defined(__x86_64__) || defined(__i386__)
+        //The TSC runs at a constant rate on the supported CPUs, measure it once over a few milliseconds
+        static const double ticksPerNanosecond = [](){
+            auto start = std::chrono::steady_clock::now();
+            std::uint64_t startTicks = readTicks();
+            auto end = start;
+
+            do{
+                end = std::chrono::steady_clock::now();
+            }while(end - start < std::chrono::milliseconds(5));
+
+            std::uint64_t ticks = readTicks() - startTicks;
+            return (double)ticks / std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        }();
+
+        return ticksPerNanosecond;
+#else
+        return 1.0;
+#endif
+    }
+
+    stageTiming::stageTiming(const stageTiming & other){
+        *this = other;
+    }
+
+    stageTiming & stageTiming::operator=(const stageTiming & other){
+        copyCounter(ticks_, other.ticks_);
+        copyCounter(calls_, other.calls_);
+        copyCounter(items_, other.items_);
+        return *this;
+    }
+
+    void stageTiming::add(std::uint64_t ticks, std::uint64_t items){
+        addCounter(ticks_, ticks);
+        addCounter(calls_, 1);
+        addCounter(items_, items);
+    }
+
+    void stageTiming::merge(const stageTiming & other){
+        addCounter(ticks_, other.getTicks());
+        addCounter(calls_, other.getCalls());
+        addCounter(items_, other.getItems());
+    }
+
+    std::uint64_t stageTiming::getTicks() const{
+        return ticks_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t stageTiming::getCalls() const{
+        return calls_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t stageTiming::getItems() const{
+        return items_.load(std::memory_order_relaxed);
+    }
+
+    double stageTiming::getTicksPerItem() const{
+        std::uint64_t items = getItems();
+        return items ? (double)getTicks() / items : 0.0;
+    }
+
+    double stageTiming::getNanoseconds() const{
+        return ticksToNanoseconds(getTicks());
+    }
+
+    double stageTiming::getNanosecondsPerItem() const{
+        return getTicksPerItem() / getTicksPerNanosecond();
+    }
+
+    rxMetrics::rxMetrics(const rxMetrics & other){
+        *this = other;
+    }
+
+    rxMetrics & rxMetrics::operator=(const rxMetrics & other){
+        copyCounter(frames_, other.frames_);
+        copyCounter(dataFrames_, other.dataFrames_);
+        copyCounter(controlFrames_, other.controlFrames_);
+        copyCounter(headerErrors_, other.headerErrors_);
+        copyCounter(syncAttempts_, other.syncAttempts_);
+        copyCounter(syncFailures_, other.syncFailures_);
+        copyCounter(relocks_, other.relocks_);
+
+        for(std::size_t idx = 0; idx < blockTypeCount; idx++){
+            copyCounter(blockTypes_[idx], other.blockTypes_[idx]);
+        }
+
+        stages_ = other.stages_;
+        return *this;
+    }
+
+    /// @brief Block type field belonging to a counter index
+    /// @param index Counter index
+    /// @return The block type field, 0 for the counter shared by the unknown types
+    std::uint8_t rxMetrics::blockTypeOf(std::size_t index){
+        static constexpr std::uint8_t blockTypes[blockTypeCount] = {0x78, 0xaa, 0x2d, 0x1e, 0xe1, 0xd2, 0x99, 0x55, 0xb4, 0xcc, 0x66, 0x33, 0x4b, 0x87, 0xff, 0x00};
+        return index < blockTypeCount ? blockTypes[index] : 0;
+    }
+
+    /// @brief Publish the counts of a decode call
+    /// @param counts Counts collected by the call
+    void rxMetrics::add(const decodeCounts & counts){
+        addCounter(frames_, counts.frames);
+        addCounter(dataFrames_, counts.dataFrames);
+        addCounter(controlFrames_, counts.controlFrames);
+        addCounter(headerErrors_, counts.headerErrors);
+
+        for(std::size_t idx = 0; idx < blockTypeCount; idx++){
+            if(counts.blockTypes[idx]) addCounter(blockTypes_[idx], counts.blockTypes[idx]);
+        }
+    }
+
+    /// @brief Account an alignment acquisition
+    /// @param success True if the alignment was found
+    /// @param ticks Duration of the acquisition
+    void rxMetrics::addSync(bool success, std::uint64_t ticks){
+        addCounter(syncAttempts_, 1);
+        if(!success) addCounter(syncFailures_, 1);
+        stages_[static_cast<std::size_t>(stage::sync)].add(ticks, 1);
+    }
+
+    void rxMetrics::addRelock(){
+        addCounter(relocks_, 1);
+    }
+
+    void rxMetrics::addStage(stage stage, std::uint64_t ticks, std::uint64_t items){
+        stages_[static_cast<std::size_t>(stage)].add(ticks, items);
+    }
+
+    void rxMetrics::merge(const rxMetrics & other){
+        addCounter(frames_, other.getFrames());
+        addCounter(dataFrames_, other.getDataFrames());
+        addCounter(controlFrames_, other.getControlFrames());
+        addCounter(headerErrors_, other.getHeaderErrors());
+        addCounter(syncAttempts_, other.getSyncAttempts());
+        addCounter(syncFailures_, other.getSyncFailures());
+        addCounter(relocks_, other.getRelocks());
+
+        for(std::size_t idx = 0; idx < blockTypeCount; idx++){
+            addCounter(blockTypes_[idx], other.blockTypes_[idx].load(std::memory_order_relaxed));
+        }
+
+        for(std::size_t idx = 0; idx < stages_.size(); idx++){
+            stages_[idx].merge(other.stages_[idx]);
+        }
+    }
+
+    std::uint64_t rxMetrics::getFrames() const{
+        return frames_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t rxMetrics::getDataFrames() const{
+        return dataFrames_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t rxMetrics::getControlFrames() const{
+        return controlFrames_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t rxMetrics::getHeaderErrors() const{
+        return headerErrors_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t rxMetrics::getSyncAttempts() const{
+        return syncAttempts_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t rxMetrics::getSyncFailures() const{
+        return syncFailures_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t rxMetrics::getRelocks() const{
+        return relocks_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t rxMetrics::getBlockTypeCount(std::uint8_t blockType) const{
+        return blockTypes_[blockTypeIndex(blockType)].load(std::memory_order_relaxed);
+    }
+
+    const stageTiming & rxMetrics::getStage(stage stage) const{
+        return stages_[static_cast<std::size_t>(stage)];
+    }
+
+    double rxMetrics::getHeaderErrorRate() const{
+        std::uint64_t frames = getFrames();
+        return frames ? (double)getHeaderErrors() / frames : 0.0;
+    }
+}
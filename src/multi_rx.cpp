@@ -0,0 +1,318 @@
+#include "multi_rx.hpp"
+#include <chrono>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace fastic{
+
+    multiRx::lane::lane(std::size_t inputCapacity, std::size_t outputCapacity, const eventFilter::config & filterConfig) :
+        receiver(nullptr, 0),
+        input(inputCapacity),
+        output(outputCapacity),
+        completedBuffers(0),
+        filter(filterConfig)
+    {
+        pending.reserve(maxSliceEvents_);
+    }
+
+    /// @brief Construct the receiver and start the workers
+    /// @param laneCount Number of Aurora lanes
+    /// @param workerCount Number of worker threads, every lane is decoded by exactly one of them
+    /// @param eventQueueCapacity Capacity of the decoded event queue of every lane
+    /// @param bufferQueueCapacity Capacity of the raw buffer queue of every lane
+    /// @param cores Cores to pin the workers to (worker i to cores[i % size]), cores outside of the process cpuset are not used. By default worker i runs on the i-th core of the cpuset
+    /// @param filter Criteria of the events passed to the consumer, by default all of them
+    multiRx::multiRx(std::size_t laneCount, std::size_t workerCount, std::size_t eventQueueCapacity, std::size_t bufferQueueCapacity, std::vector<int> cores, const eventFilter::config & filter) :
+        workerCount_(std::max<std::size_t>(1, std::min(workerCount, laneCount))),
+        running_(true)
+    {
+        for(std::size_t idx = 0; idx < laneCount; idx++){
+            lanes_.push_back(std::make_unique<lane>(bufferQueueCapacity, eventQueueCapacity, filter));
+        }
+
+        for(std::size_t worker = 0; worker < workerCount_; worker++){
+            workerStates_.push_back(std::make_unique<workerState>());
+        }
+
+#if defined(__linux__)
+        //Only the cores the process may run on (taskset, cgroup cpuset) are used for pinning
+        cpu_set_t allowedSet;
+        CPU_ZERO(&allowedSet);
+        std::vector<int> allowedCores;
+        if(sched_getaffinity(0, sizeof(allowedSet), &allowedSet) == 0){
+            for(int core = 0; core < CPU_SETSIZE; core++){
+                if(CPU_ISSET(core, &allowedSet)) allowedCores.push_back(core);
+            }
+        }
+#endif
+
+        std::vector<std::future<int>> pinnedCores;
+        for(std::size_t worker = 0; worker < workerCount_; worker++){
+            int core = -1;
+#if defined(__linux__)
+            //Keep the worker and with it the state of its lanes on one core
+            if(cores.empty()){
+                if(!allowedCores.empty()) core = allowedCores[worker % allowedCores.size()];
+            }else{
+                core = cores[worker % cores.size()];
+                if(core < 0 || core >= CPU_SETSIZE || !CPU_ISSET(core, &allowedSet)) core = -1;
+            }
+#endif
+            std::promise<int> pinned;
+            pinnedCores.push_back(pinned.get_future());
+            workers_.emplace_back(&multiRx::workerLoop, this, worker, core, std::move(pinned));
+        }
+
+        //Every worker pins itself before its first decode and reports the core it got
+        for(std::future<int> & pinnedCore : pinnedCores){
+            workerCores_.push_back(pinnedCore.get());
+        }
+    }
+
+    multiRx::~multiRx(){
+        stop();
+    }
+
+    void multiRx::stop(){
+        running_.store(false, std::memory_order_relaxed);
+
+        for(std::size_t worker = 0; worker < workerStates_.size(); worker++){
+            wake(worker);
+        }
+
+        for(std::thread & worker : workers_){
+            if(worker.joinable()) worker.join();
+        }
+    }
+
+    /// @brief Pin the calling thread to one core
+    /// @param core Core to pin to, -1 to leave the thread unpinned
+    /// @return False if the thread was not pinned
+    bool multiRx::pinThread(int core){
+        if(core < 0) return false;
+
+#if defined(__linux__)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(core, &cpuSet);
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+        return false;
+#endif
+    }
+
+    /// @brief Decode the lanes of one worker until the receiver is stopped
+    /// @param worker Index of the worker
+    /// @param core Core to pin the worker to, -1 to leave it unpinned
+    /// @param pinned Set to the core the worker runs on, -1 if it is not pinned
+    void multiRx::workerLoop(std::size_t worker, int core, std::promise<int> pinned){
+        //Pin before anything is decoded, so the lane state is first touched on its core
+        pinned.set_value(pinThread(core) ? core : -1);
+
+        int idleRounds = 0;
+
+        while(running_.load(std::memory_order_relaxed)){
+            bool idle = true;
+
+            for(std::size_t laneIdx = worker; laneIdx < lanes_.size(); laneIdx += workerCount_){
+                lane & currentLane = *lanes_[laneIdx];
+
+                //A lane with events still waiting for its consumer decodes no further, the other lanes go on
+                if(currentLane.pendingHead < currentLane.pending.size()){
+                    if(flushPending(currentLane)) idle = false;
+                    if(currentLane.pendingHead < currentLane.pending.size()) continue;
+                }
+
+                if(!currentLane.hasCurrent){
+                    if(!currentLane.input.pop(currentLane.current)) continue;
+                    currentLane.currentOffset = 0;
+                    currentLane.hasCurrent = true;
+                }
+                idle = false;
+
+                decodeSlice(currentLane);
+            }
+
+            if(!idle){
+                idleRounds = 0;
+            }else if(++idleRounds < idleSpinRounds_){
+                std::this_thread::yield();
+            }else{
+                park(worker);
+                idleRounds = 0;
+            }
+        }
+    }
+
+    /// @brief Decode the next slice of the lane's current buffer into its event queue
+    /// @param currentLane Lane with a buffer to decode
+    void multiRx::decodeSlice(lane & currentLane){
+        const job & currentJob = currentLane.current;
+        std::size_t sliceSize = std::min(sliceWords_, currentJob.size - currentLane.currentOffset);
+
+        std::uint64_t startTicks = aurora::readTicks();
+        decoderMetrics::parityCounts counts;
+        //The statistics of the slice are stamped with the time its decoding started
+        std::uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        //Filter the raw words and decode the survivors straight into the event queue, once it is full the rest of the slice waits in the lane
+        auto queueEvents = [&](const std::uint64_t * events, std::size_t count){
+            for(std::size_t idx = 0; idx < count; idx++){
+                eventPacket event{aurora::dataPacket(events[idx])};
+                counts.add(event.getParityErrors());
+                if(currentLane.pending.size() != currentLane.pendingHead || !currentLane.output.push(event)){
+                    currentLane.pending.push_back(event);
+                }
+            }
+        };
+
+        currentLane.receiver.feedPayloads(currentJob.data + currentLane.currentOffset, sliceSize, [&](const std::uint64_t * payloads, std::size_t count){
+            currentLane.filter.forward(payloads, count, queueEvents);
+        }, [&](const aurora::controlPacket & control){
+            currentLane.health.push(control, now);
+        });
+
+        currentLane.metrics.add(counts);
+        currentLane.metrics.addDecode(aurora::readTicks() - startTicks, counts.events);
+
+        currentLane.currentOffset += sliceSize;
+        if(currentLane.currentOffset < currentJob.size) return;
+
+        currentLane.hasCurrent = false;
+        if(currentJob.pool) currentJob.pool->release(currentJob.poolIndex);
+
+        //Only this worker writes the counter, no read-modify-write is needed
+        currentLane.completedBuffers.store(currentLane.completedBuffers.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// @brief Move the pending events of the lane to its event queue as far as there is room
+    /// @param currentLane Lane to flush
+    /// @return Number of events moved
+    std::size_t multiRx::flushPending(lane & currentLane){
+        std::size_t first = currentLane.pendingHead;
+
+        while(currentLane.pendingHead < currentLane.pending.size() && currentLane.output.push(currentLane.pending[currentLane.pendingHead])){
+            currentLane.pendingHead++;
+        }
+
+        std::size_t moved = currentLane.pendingHead - first;
+        if(currentLane.pendingHead == currentLane.pending.size()){
+            currentLane.pending.clear();
+            currentLane.pendingHead = 0;
+        }
+
+        return moved;
+    }
+
+    bool multiRx::hasWork(std::size_t worker) const{
+        for(std::size_t laneIdx = worker; laneIdx < lanes_.size(); laneIdx += workerCount_){
+            const lane & currentLane = *lanes_[laneIdx];
+
+            if(currentLane.pendingHead < currentLane.pending.size()){
+                if(currentLane.output.size() < currentLane.output.capacity()) return true;
+            }else if(currentLane.hasCurrent || currentLane.input.size()){
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// @brief Put an idle worker to sleep until wake is called for it
+    /// @param worker Index of the worker, called from the worker itself
+    void multiRx::park(std::size_t worker){
+        workerState & state = *workerStates_[worker];
+        std::unique_lock<std::mutex> lock(state.mutex);
+
+        //Announce the sleep before the last look at the queues, a submit or drain after the look then sees the flag (and the look sees the work before it)
+        state.sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if(hasWork(worker) || !running_.load(std::memory_order_relaxed)){
+            state.sleeping.store(false, std::memory_order_relaxed);
+            return;
+        }
+
+        state.wakeup.wait(lock, [&state]{ return !state.sleeping.load(std::memory_order_relaxed); });
+    }
+
+    /// @brief Wake the worker if it sleeps, called after work for it was published
+    /// @param worker Index of the worker
+    void multiRx::wake(std::size_t worker){
+        workerState & state = *workerStates_[worker];
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(!state.sleeping.load(std::memory_order_relaxed)) return;
+
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.sleeping.store(false, std::memory_order_relaxed);
+        }
+        state.wakeup.notify_one();
+    }
+
+    /// @brief Queue a raw buffer for decoding, the buffer has to stay valid until getCompletedBuffers reports it done
+    /// @param lane Index of the lane the buffer was received on
+    /// @param data Pointer to the raw data with 32bit MSB unscrambled data words
+    /// @param size Number of words in the buffer
+    /// @return False if the lane's buffer queue is full and the buffer was not queued
+    bool multiRx::submit(std::size_t lane, const std::uint32_t * data, std::size_t size){
+        if(!lanes_[lane]->input.push(job{data, size, nullptr, 0})) return false;
+
+        wake(getLaneWorker(lane));
+        return true;
+    }
+
+    /// @brief Queue a pool buffer for decoding, the buffer is recycled by the worker
+    /// @param lane Index of the lane the buffer was received on
+    /// @param pool Pool owning the buffer
+    /// @param index Index of the buffer in the pool
+    /// @param size Number of 32bit words filled in the buffer
+    /// @return False if the lane's buffer queue is full and the buffer was not queued (it stays with the caller)
+    bool multiRx::submit(std::size_t lane, aurora::bufferPool & pool, std::size_t index, std::size_t size){
+        if(!lanes_[lane]->input.push(job{pool.getBuffer(index), size, &pool, index})) return false;
+
+        wake(getLaneWorker(lane));
+        return true;
+    }
+
+    std::uint64_t multiRx::getCompletedBuffers(std::size_t lane) const{
+        return lanes_[lane]->completedBuffers.load(std::memory_order_acquire);
+    }
+
+    const aurora::rxMetrics & multiRx::getRxMetrics(std::size_t lane) const{
+        return lanes_[lane]->receiver.getMetrics();
+    }
+
+    const decoderMetrics & multiRx::getDecoderMetrics(std::size_t lane) const{
+        return lanes_[lane]->metrics;
+    }
+
+    const chipHealth & multiRx::getChipHealth(std::size_t lane) const{
+        return lanes_[lane]->health;
+    }
+
+    const eventFilter & multiRx::getFilter(std::size_t lane) const{
+        return lanes_[lane]->filter;
+    }
+
+    std::size_t multiRx::getLaneCount() const{
+        return lanes_.size();
+    }
+
+    std::size_t multiRx::getWorkerCount() const{
+        return this->workerCount_;
+    }
+
+    std::size_t multiRx::getLaneWorker(std::size_t lane) const{
+        return lane % this->workerCount_;
+    }
+
+    int multiRx::getWorkerCore(std::size_t worker) const{
+        return this->workerCores_[worker];
+    }
+}
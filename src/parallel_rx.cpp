@@ -0,0 +1,258 @@
+#include "parallel_rx.hpp"
+
+#include <algorithm>
+
+namespace aurora{
+
+    /// @brief Construct the decoder
+    /// @param workerCount Number of decoding threads, 0 for one per core
+    /// @param chunkWords Size of the chunks in words, the output equals rx fed chunks of this size
+    /// @param syncErrorTresholdPercentage Sync error treshold of the receivers (see rx)
+    /// @param syncErrorSampleSize Sync sample size of the receivers (see rx)
+    parallelRx::parallelRx(std::size_t workerCount, std::size_t chunkWords, std::uint8_t syncErrorTresholdPercentage, int syncErrorSampleSize) :
+        workerCount_(workerCount ? workerCount : std::max(1u, std::thread::hardware_concurrency())),
+        chunkWords_(std::max<std::size_t>(chunkWords, 64)),
+        syncErrorTresholdPercentage_(syncErrorTresholdPercentage),
+        syncErrorSampleSize_(syncErrorSampleSize)
+    {
+        //Two chunks per worker keep the workers busy while the sink consumes the oldest one
+        for(std::size_t idx = 0; idx < 2 * workerCount_; idx++){
+            chunks_.emplace_back(new chunk());
+        }
+    }
+
+    parallelRx::~parallelRx(){
+        finish();
+    }
+
+    /// @brief Capture the streaming state of a receiver
+    /// @param receiver Receiver after a chunk passed to feed
+    /// @return The state the next chunk starts from
+    parallelRx::streamState parallelRx::saveState(const rx & receiver){
+        streamState state;
+        state.synced = receiver.synced_;
+        state.streamStarted = receiver.streamStarted_;
+        state.bitSlip = receiver.bitSlip_;
+        state.carryBuffer = receiver.carryBuffer_;
+        state.carryWords = receiver.carryWords_;
+        state.streamPosition = receiver.streamPosition_;
+        state.previousData = receiver.previousData_;
+        state.hasPreviousData = receiver.hasPreviousData_;
+        state.lockErrors = receiver.lockErrors_;
+        state.lockHistory = receiver.lockHistory_;
+        state.syncBuffer = receiver.syncBuffer_;
+        return state;
+    }
+
+    /// @brief Continue a stream in a fresh receiver
+    /// @param receiver Receiver which did not decode anything yet
+    /// @param state State of the stream before the next chunk
+    void parallelRx::loadState(rx & receiver, const streamState & state){
+        //Without sync the next chunk starts a new stream on the input collected so far
+        if(!state.synced){
+            receiver.syncBuffer_ = state.syncBuffer;
+            return;
+        }
+
+        receiver.synced_ = true;
+        receiver.streamStarted_ = state.streamStarted;
+        receiver.bitSlip_ = state.bitSlip;
+        receiver.carryBuffer_ = state.carryBuffer;
+        receiver.carryWords_ = state.carryWords;
+        receiver.streamPosition_ = state.streamPosition;
+        receiver.previousData_ = state.previousData;
+        receiver.hasPreviousData_ = state.hasPreviousData;
+        receiver.lockErrors_ = state.lockErrors;
+        receiver.lockHistory_ = state.lockHistory;
+    }
+
+    /// @brief Compare the state a chunk was decoded from with the real one
+    /// @param exit State the previous chunk ended with
+    /// @param entry State the chunk was decoded from
+    /// @return True if the decoding of the chunk does not depend on the difference
+    bool parallelRx::continues(const streamState & exit, const streamState & entry){
+        if(exit.synced != entry.synced) return false;
+        //Both start a new stream with a full synchronization on the same input
+        if(!exit.synced) return exit.syncBuffer == entry.syncBuffer;
+
+        return exit.streamStarted == entry.streamStarted
+            && (exit.streamStarted || exit.bitSlip == entry.bitSlip)
+            && exit.carryWords == entry.carryWords
+            && std::equal(exit.carryBuffer.begin(), exit.carryBuffer.begin() + exit.carryWords, entry.carryBuffer.begin())
+            && exit.streamPosition == entry.streamPosition
+            && exit.hasPreviousData == entry.hasPreviousData
+            && (!exit.hasPreviousData || exit.previousData == entry.previousData)
+            && exit.lockErrors == entry.lockErrors
+            && exit.lockHistory == entry.lockHistory;
+    }
+
+    /// @brief Guess the state of the stream at a chunk boundary from the raw data
+    /// @param begin First word of the chunk, at least three words into the capture
+    /// @return The state an rx would carry into the chunk if the stream ran undisturbed through the boundary
+    parallelRx::streamState parallelRx::guessEntry(std::size_t begin) const{
+        streamState state;
+
+        //The best scored alignment is taken whatever its score, a wrong guess is caught when the entry is compared to the real state
+        int score, sampledFrames;
+        std::uint8_t alignment = rx::acquireAlignment(data_, size_ * 32, begin * 32, syncErrorSampleSize_, score, sampledFrames);
+        if(!sampledFrames) return state;
+
+        //The first frame which does not lie completely in the previous chunk
+        std::size_t boundary = begin * 32;
+        std::size_t frame = alignment ? boundary + alignment - 66 : boundary;
+
+        state.synced = true;
+        state.streamStarted = true;
+        state.bitSlip = frame % 66;
+
+        std::size_t carryStart = frame / 32;
+        state.carryWords = begin - carryStart;
+        std::copy(data_ + carryStart, data_ + begin, state.carryBuffer.begin());
+        state.streamPosition = frame - carryStart * 32;
+
+        //The descrambler only needs the previous payload, which is still scrambled in the capture
+        if(frame >= 66){
+            state.previousData = rx::extractPacketData(data_, frame - 66);
+            state.hasPreviousData = true;
+        }
+
+        //Lock window of the preceding frames, the newest in the LSB
+        for(std::size_t idx = 0; idx < 64 && frame >= 66 * (idx + 1); idx++){
+            std::uint8_t syncBits = rx::extractSyncBits(data_, frame - 66 * (idx + 1));
+            bool invalidHeader = (syncBits == 0b00 || syncBits == 0b11);
+            state.lockHistory |= (std::uint64_t)invalidHeader << idx;
+            state.lockErrors += invalidHeader;
+        }
+
+        return state;
+    }
+
+    /// @brief Decode a chunk from its entry state
+    /// @param target The chunk
+    void parallelRx::decodeChunk(chunk & target) const{
+        target.receiver.reset(new rx(nullptr, 0, syncErrorTresholdPercentage_, syncErrorSampleSize_));
+        loadState(*target.receiver, target.entry);
+
+        std::size_t size = target.end - target.begin;
+        target.syncBits.clear();
+        target.payloads.clear();
+        target.syncBits.reserve(size * 32 / 66 + 2);
+        target.payloads.reserve(size * 32 / 66 + 2);
+
+        target.receiver->feedFrames(data_ + target.begin, size, [&target](std::uint8_t syncBits, std::uint64_t data){
+            target.syncBits.push_back(syncBits);
+            target.payloads.push_back(data);
+        });
+
+        target.exit = saveState(*target.receiver);
+    }
+
+    void parallelRx::workerLoop(){
+        while(true){
+            std::size_t index = nextChunk_.fetch_add(1, std::memory_order_relaxed);
+            if(index >= chunkCount_) return;
+
+            //The slot is reused once the chunk decoded into it chunks_.size() chunks before was handed out
+            chunk & target = *chunks_[index % chunks_.size()];
+            while(target.index.load(std::memory_order_acquire) != index){
+                if(cancelled_.load(std::memory_order_relaxed)) return;
+                std::this_thread::yield();
+            }
+
+            target.begin = index * chunkWords_;
+            target.end = std::min(size_, target.begin + chunkWords_);
+            target.entry = index ? guessEntry(target.begin) : streamState();
+            decodeChunk(target);
+
+            target.ready.store(true, std::memory_order_release);
+        }
+    }
+
+    /// @brief Start the workers on a capture
+    /// @param data Pointer to the raw capture
+    /// @param size Number of words of the capture
+    void parallelRx::start(const std::uint32_t * data, std::size_t size){
+        finish();
+
+        data_ = data;
+        size_ = size;
+        chunkCount_ = (size + chunkWords_ - 1) / chunkWords_;
+        nextChunk_.store(0, std::memory_order_relaxed);
+        cancelled_.store(false, std::memory_order_relaxed);
+        acceptedChunks_ = 0;
+        state_ = streamState();
+
+        for(std::size_t idx = 0; idx < chunks_.size(); idx++){
+            chunks_[idx]->ready.store(false, std::memory_order_relaxed);
+            chunks_[idx]->index.store(idx, std::memory_order_relaxed);
+        }
+
+        std::size_t workers = std::min(workerCount_, chunkCount_);
+        for(std::size_t idx = 0; idx < workers; idx++){
+            workers_.emplace_back(&parallelRx::workerLoop, this);
+        }
+    }
+
+    /// @brief Take the next chunk in order
+    /// @return The decoded chunk or nullptr once all of them were handed out
+    const parallelRx::chunk * parallelRx::acceptChunk(){
+        if(acceptedChunks_ >= chunkCount_) return nullptr;
+
+        chunk & target = *chunks_[acceptedChunks_ % chunks_.size()];
+        while(!target.ready.load(std::memory_order_acquire)) std::this_thread::yield();
+
+        decodedChunks_++;
+        if(!continues(state_, target.entry)){
+            //The guess missed the real state (a relock or a lost sync near the boundary), decode the chunk as rx would
+            target.entry = state_;
+            decodeChunk(target);
+            redecodedChunks_++;
+        }
+
+        state_ = target.exit;
+        metrics_.merge(target.receiver->getMetrics());
+        return &target;
+    }
+
+    void parallelRx::releaseChunk(){
+        chunk & target = *chunks_[acceptedChunks_ % chunks_.size()];
+        target.ready.store(false, std::memory_order_relaxed);
+        target.index.store(acceptedChunks_ + chunks_.size(), std::memory_order_release);
+        acceptedChunks_++;
+    }
+
+    void parallelRx::finish(){
+        //The workers end once all the chunks were taken
+        for(std::thread & worker : workers_) worker.join();
+        workers_.clear();
+    }
+
+    void parallelRx::cancel(){
+        cancelled_.store(true, std::memory_order_relaxed);
+        finish();
+    }
+
+    std::size_t parallelRx::getWorkerCount() const{
+        return this->workerCount_;
+    }
+
+    std::size_t parallelRx::getChunkWords() const{
+        return this->chunkWords_;
+    }
+
+    bool parallelRx::isSynchronized() const{
+        return this->state_.synced;
+    }
+
+    const rxMetrics & parallelRx::getMetrics() const{
+        return this->metrics_;
+    }
+
+    std::uint64_t parallelRx::getDecodedChunks() const{
+        return this->decodedChunks_;
+    }
+
+    std::uint64_t parallelRx::getRedecodedChunks() const{
+        return this->redecodedChunks_;
+    }
+}
@@ -0,0 +1,500 @@
+#include "stream_reader.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define STREAM_READER_IO_URING 1
+#endif
+
+namespace aurora{
+
+    /// @brief Construct the reader
+    /// @param pool Pool of the buffers the input is read into
+    /// @param queueDepth Maximum number of buffers read ahead of the consumer (reads in flight and filled buffers not handed out)
+    /// @param preferred Backend to use if it is available, io_uring falls back to the blocking reads
+    streamReader::streamReader(bufferPool & pool, std::size_t queueDepth, backend preferred) :
+        pool_(pool),
+        slots_(queueDepth ? queueDepth : 1),
+        preferred_(preferred)
+    {
+    }
+
+    streamReader::~streamReader(){
+        close();
+    }
+
+    /// @brief Open a capture file or a device
+    /// @param path Path of the input
+    /// @return True if the input was opened
+    bool streamReader::open(const std::string & path){
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) return false;
+
+        if(!open(fd)){
+            ::close(fd);
+            return false;
+        }
+
+        ownsFd_ = true;
+        return true;
+    }
+
+    /// @brief Read from an opened descriptor, the reading starts at its current position
+    /// @param fd Descriptor opened for reading
+    /// @return True if the reader is ready
+    bool streamReader::open(int fd){
+        close();
+        if(fd < 0 || !pool_.isAllocated()) return false;
+
+        struct stat status;
+        if(fstat(fd, &status) != 0) return false;
+
+        //Character devices are treated as streams, their offset is usually ignored or has another meaning
+        seekable_ = S_ISREG(status.st_mode) || S_ISBLK(status.st_mode);
+        inputSize_ = S_ISREG(status.st_mode) ? status.st_size : 0;
+
+        if(seekable_){
+            off_t position = lseek(fd, 0, SEEK_CUR);
+            nextOffset_ = position > 0 ? position : 0;
+        }
+
+        fd_ = fd;
+        ownsFd_ = false;
+        bytesRead_ = 0;
+        reads_ = 0;
+        stalls_ = 0;
+        backend_ = (preferred_ == backend::ioUring && setupRing()) ? backend::ioUring : backend::blocking;
+
+        return true;
+    }
+
+    void streamReader::close(){
+        if(backend_ == backend::ioUring){
+            drainInFlight();
+            closeRing();
+        }
+
+        if(ownsFd_ && fd_ >= 0) ::close(fd_);
+
+        fd_ = -1;
+        ownsFd_ = false;
+        backend_ = backend::none;
+        submitted_ = 0;
+        delivered_ = 0;
+        inFlight_ = 0;
+        nextOffset_ = 0;
+        inputSize_ = 0;
+        inputEnded_ = false;
+        endReached_ = false;
+        finished_ = false;
+        error_ = 0;
+    }
+
+    /// @brief Create the io_uring and register the pool buffers with it
+    /// @return False if io_uring is not available
+    bool streamReader::setupRing(){
+#if defined(STREAM_READER_IO_URING)
+        struct io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        ringFd_ = syscall(__NR_io_uring_setup, (unsigned)slots_.size(), &params);
+        if(ringFd_ < 0){
+            ringFd_ = -1;
+            return false;
+        }
+
+#if defined(IORING_FEAT_RW_CUR_POS)
+        bool currentPosition = params.features & IORING_FEAT_RW_CUR_POS;
+#else
+        bool currentPosition = false;
+#endif
+        //A stream is read at its current position (offset -1), which older kernels do not support
+        if(!seekable_ && !currentPosition){
+            closeRing();
+            return false;
+        }
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+
+#if defined(IORING_FEAT_SINGLE_MMAP)
+        bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+#else
+        bool singleMap = false;
+#endif
+        if(singleMap) sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+        sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+        if(sqRing_ == MAP_FAILED){
+            sqRing_ = nullptr;
+            closeRing();
+            return false;
+        }
+
+        if(singleMap){
+            cqRing_ = sqRing_;
+        }else{
+            cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+            if(cqRing_ == MAP_FAILED){
+                cqRing_ = nullptr;
+                closeRing();
+                return false;
+            }
+        }
+
+        sqes_ = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+        if(sqes_ == MAP_FAILED){
+            sqes_ = nullptr;
+            closeRing();
+            return false;
+        }
+
+        std::uint8_t * sqRing = static_cast<std::uint8_t *>(sqRing_);
+        std::uint8_t * cqRing = static_cast<std::uint8_t *>(cqRing_);
+        sqTail_ = reinterpret_cast<unsigned *>(sqRing + params.sq_off.tail);
+        sqMask_ = reinterpret_cast<unsigned *>(sqRing + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned *>(sqRing + params.sq_off.array);
+        cqHead_ = reinterpret_cast<unsigned *>(cqRing + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned *>(cqRing + params.cq_off.tail);
+        cqMask_ = reinterpret_cast<unsigned *>(cqRing + params.cq_off.ring_mask);
+        cqes_ = cqRing + params.cq_off.cqes;
+
+        //Registered buffers are pinned once instead of on every read, a failure (RLIMIT_MEMLOCK) only leaves the plain reads
+        //A fixed read names its buffer in the 16bit buf_index, a larger pool is read without the registration
+        if(pool_.getBufferCount() > (std::size_t)std::numeric_limits<decltype(io_uring_sqe::buf_index)>::max() + 1) return true;
+
+        std::vector<struct iovec> buffers(pool_.getBufferCount());
+        for(std::size_t idx = 0; idx < buffers.size(); idx++){
+            buffers[idx].iov_base = pool_.getBuffer<void>(idx);
+            buffers[idx].iov_len = pool_.getBufferSize();
+        }
+        registeredBuffers_ = syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_BUFFERS, buffers.data(), (unsigned)buffers.size()) == 0;
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void streamReader::closeRing(){
+        //Closing the ring also drops the buffer registration
+        if(sqes_) munmap(sqes_, sqesSize_);
+        if(cqRing_ && cqRing_ != sqRing_) munmap(cqRing_, cqRingSize_);
+        if(sqRing_) munmap(sqRing_, sqRingSize_);
+        if(ringFd_ >= 0) ::close(ringFd_);
+
+        sqes_ = nullptr;
+        cqRing_ = nullptr;
+        sqRing_ = nullptr;
+        ringFd_ = -1;
+        pendingSubmissions_ = 0;
+        registeredBuffers_ = false;
+    }
+
+    /// @brief Queue the read of the missing part of a slot, passed to the kernel by the next enter
+    /// @param sequence Sequence number of the read
+    void streamReader::queueRead(std::uint64_t sequence){
+#if defined(STREAM_READER_IO_URING)
+        slot & read = slots_[sequence % slots_.size()];
+        std::uint8_t * target = pool_.getBuffer<std::uint8_t>(read.bufferIndex) + read.bytes;
+
+        //Only this thread produces the submissions, the kernel reads the tail
+        unsigned tail = *sqTail_;
+        unsigned entry = tail & *sqMask_;
+        struct io_uring_sqe * sqe = static_cast<struct io_uring_sqe *>(sqes_) + entry;
+        std::memset(sqe, 0, sizeof(*sqe));
+
+        if(registeredBuffers_){
+            sqe->opcode = IORING_OP_READ_FIXED;
+            sqe->addr = reinterpret_cast<std::uint64_t>(target);
+            sqe->len = read.capacity - read.bytes;
+            sqe->buf_index = read.bufferIndex;
+        }else{
+            read.vector.iov_base = target;
+            read.vector.iov_len = read.capacity - read.bytes;
+            sqe->opcode = IORING_OP_READV;
+            sqe->addr = reinterpret_cast<std::uint64_t>(&read.vector);
+            sqe->len = 1;
+        }
+
+        sqe->fd = fd_;
+        sqe->off = seekable_ ? read.offset + read.bytes : (std::uint64_t)-1;
+        sqe->user_data = sequence;
+        //The reads of a stream run one after the other, queueChain ends the chain at its last read
+        if(!seekable_) sqe->flags = IOSQE_IO_LINK;
+
+        sqArray_[entry] = entry;
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+        pendingSubmissions_++;
+        inFlight_++;
+        reads_++;
+#else
+        (void)sequence;
+#endif
+    }
+
+    /// @brief Queue the reads of a stream as one chain of linked reads, which the kernel runs in the chain order
+    void streamReader::queueChain(){
+#if defined(STREAM_READER_IO_URING)
+        //Two chains would read the stream concurrently, the next one starts once the previous one completed
+        if(inFlight_) return;
+
+        unsigned queued = 0;
+
+        //A short read breaks the chain and cancels the reads behind it, they are resumed first and in their order
+        for(std::uint64_t sequence = delivered_; sequence < submitted_; sequence++){
+            slot & read = slots_[sequence % slots_.size()];
+            if(!read.done){
+                queueRead(sequence);
+                queued++;
+            }else if(read.end || read.error){
+                //The reads cancelled behind the end of the input are not repeated
+                inputEnded_ = true;
+                break;
+            }
+        }
+
+        std::uint64_t sequence;
+        while(submitted_ - delivered_ < slots_.size() && startRead(sequence)){
+            queueRead(sequence);
+            queued++;
+        }
+
+        if(queued){
+            struct io_uring_sqe * sqes = static_cast<struct io_uring_sqe *>(sqes_);
+            sqes[(*sqTail_ - 1) & *sqMask_].flags &= ~IOSQE_IO_LINK;
+        }
+#endif
+    }
+
+    /// @brief Pass the queued reads to the kernel and wait for completions
+    /// @param minComplete Number of completions to wait for
+    /// @return False on a failure of the ring
+    bool streamReader::enter(unsigned minComplete){
+#if defined(STREAM_READER_IO_URING)
+        while(true){
+            int submitted = syscall(__NR_io_uring_enter, ringFd_, pendingSubmissions_, minComplete, minComplete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if(submitted < 0){
+                if(errno == EINTR) continue;
+                error_ = errno;
+                return false;
+            }
+
+            pendingSubmissions_ -= std::min<unsigned>(submitted, pendingSubmissions_);
+            if(!pendingSubmissions_) return true;
+        }
+#else
+        (void)minComplete;
+        return false;
+#endif
+    }
+
+    void streamReader::reapCompletions(){
+#if defined(STREAM_READER_IO_URING)
+        //Only this thread consumes the completions, the kernel writes the tail
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        const struct io_uring_cqe * cqes = static_cast<const struct io_uring_cqe *>(cqes_);
+
+        for(; head != tail; head++){
+            const struct io_uring_cqe & cqe = cqes[head & *cqMask_];
+            inFlight_--;
+            completeRead(cqe.user_data, cqe.res);
+        }
+
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+#endif
+    }
+
+    /// @brief Account the result of a read and resume it if the buffer is not complete yet
+    /// @param sequence Sequence number of the read
+    /// @param result Bytes read or the negative error number
+    void streamReader::completeRead(std::uint64_t sequence, long result){
+        slot & read = slots_[sequence % slots_.size()];
+
+        if(result == -EINTR || result == -EAGAIN || result == -ECANCELED){
+            //Retried as it is (a read of a stream is cancelled by a short read before it in its chain)
+        }else if(result < 0){
+            read.error = -result;
+            read.done = true;
+        }else if(result == 0){
+            read.end = true;
+            read.done = true;
+        }else{
+            read.bytes += result;
+            bytesRead_ += result;
+            //A seekable input fills the whole buffer (a short read is resumed at its end), a stream hands out whatever whole words it got
+            read.done = read.bytes == read.capacity || (!seekable_ && read.bytes % sizeof(std::uint32_t) == 0);
+        }
+
+        //The reads of a stream are resumed by the next chain to keep them in order
+        if(!read.done && backend_ == backend::ioUring && seekable_) queueRead(sequence);
+    }
+
+    /// @brief Fill a slot by blocking reads
+    /// @param sequence Sequence number of the read
+    void streamReader::readBlocking(std::uint64_t sequence){
+        slot & read = slots_[sequence % slots_.size()];
+
+        while(!read.done){
+            std::uint8_t * target = pool_.getBuffer<std::uint8_t>(read.bufferIndex) + read.bytes;
+            ssize_t result = seekable_ ? pread(fd_, target, read.capacity - read.bytes, read.offset + read.bytes)
+                                       : ::read(fd_, target, read.capacity - read.bytes);
+            reads_++;
+
+            if(result < 0 && errno == EAGAIN) std::this_thread::yield();
+            completeRead(sequence, result < 0 ? -errno : result);
+        }
+    }
+
+    /// @brief Take the next free buffer for the next read
+    /// @param sequence Sequence number assigned to the read
+    /// @return False if the input was read to its end or no buffer is free
+    bool streamReader::startRead(std::uint64_t & sequence){
+        if(seekable_ && inputSize_ && nextOffset_ >= inputSize_) inputEnded_ = true;
+        if(inputEnded_) return false;
+
+        std::size_t index;
+        if(!pool_.acquire(index)) return false;
+
+        sequence = submitted_++;
+        slot & read = slots_[sequence % slots_.size()];
+        read.bufferIndex = index;
+        read.offset = nextOffset_;
+        read.bytes = 0;
+        read.capacity = pool_.getBufferSize();
+        read.done = false;
+        read.end = false;
+        read.error = 0;
+
+        //The last read of a file only asks for the rest of it
+        if(inputSize_) read.capacity = std::min<std::uint64_t>(read.capacity, inputSize_ - nextOffset_);
+        nextOffset_ += read.capacity;
+
+        return true;
+    }
+
+    /// @brief Wait for all the reads in flight and return the buffers not handed out to the pool
+    void streamReader::drainInFlight(){
+        if(backend_ == backend::ioUring){
+            //The kernel may still write into the buffers of the reads in flight
+            while(inFlight_ && enter(1)) reapCompletions();
+        }
+
+        for(; delivered_ < submitted_; delivered_++){
+            pool_.release(slots_[delivered_ % slots_.size()].bufferIndex);
+        }
+    }
+
+    /// @brief Wait for the next buffer of the input
+    /// @param index Index of the filled pool buffer, it has to be released to the pool by the consumer
+    /// @param words Number of the 32bit words in the buffer
+    /// @return False at the end of the input or on a read error (see getError)
+    bool streamReader::next(std::size_t & index, std::size_t & words){
+        if(finished_ || backend_ == backend::none) return false;
+
+        if(endReached_){
+            //The reads issued behind the end of the input bring nothing
+            drainInFlight();
+            finished_ = true;
+            return false;
+        }
+
+        std::uint64_t sequence;
+        bool waiting = false;
+
+        while(true){
+            if(backend_ == backend::ioUring && seekable_){
+                //Keep the queue full
+                while(submitted_ - delivered_ < slots_.size() && startRead(sequence)) queueRead(sequence);
+            }else if(backend_ == backend::ioUring){
+                queueChain();
+            }else if(submitted_ == delivered_ && startRead(sequence)){
+                readBlocking(sequence);
+            }
+
+            if(submitted_ != delivered_ && slots_[delivered_ % slots_.size()].done) break;
+
+            if(submitted_ == delivered_){
+                if(inputEnded_){
+                    finished_ = true;
+                    return false;
+                }
+
+                //Every buffer is held by the consumer, sleep until one of them comes back
+                if(!waiting) stalls_++;
+                waiting = true;
+                pool_.waitForFree();
+                continue;
+            }
+
+            if(!enter(1)){
+                drainInFlight();
+                finished_ = true;
+                return false;
+            }
+            reapCompletions();
+        }
+
+        //The reads queued above go to the kernel before the consumer gets the buffer
+        if(pendingSubmissions_) enter(0);
+
+        slot & read = slots_[delivered_++ % slots_.size()];
+        if(read.end || read.error){
+            inputEnded_ = true;
+            endReached_ = true;
+            error_ = read.error;
+        }
+
+        words = read.bytes / sizeof(std::uint32_t);
+        if(!words || read.error){
+            pool_.release(read.bufferIndex);
+            return next(index, words);
+        }
+
+        index = read.bufferIndex;
+        return true;
+    }
+
+    streamReader::backend streamReader::getBackend() const{
+        return this->backend_;
+    }
+
+    bool streamReader::hasRegisteredBuffers() const{
+        return this->registeredBuffers_;
+    }
+
+    std::size_t streamReader::getQueueDepth() const{
+        return slots_.size();
+    }
+
+    int streamReader::getError() const{
+        return this->error_;
+    }
+
+    std::uint64_t streamReader::getBytesRead() const{
+        return this->bytesRead_;
+    }
+
+    std::uint64_t streamReader::getReads() const{
+        return this->reads_;
+    }
+
+    std::uint64_t streamReader::getStalls() const{
+        return this->stalls_;
+    }
+}
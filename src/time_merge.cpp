@@ -0,0 +1,112 @@
+#include "time_merge.hpp"
+
+namespace fastic{
+
+    /// @brief Construct the merger
+    /// @param laneCount Number of merged lanes
+    /// @param reorderWindow Maximal distance (in ToA ticks) an event may lag behind the newest event of its lane
+    /// @param laneCapacity Number of pending events per lane (rounded up to a power of two)
+    timeMerger::timeMerger(std::size_t laneCount, std::uint64_t reorderWindow, std::size_t laneCapacity) : reorderWindow_(reorderWindow)
+    {
+        std::size_t capacity = 1;
+        while(capacity < laneCapacity) capacity <<= 1;
+        laneMask_ = capacity - 1;
+
+        //One extra lane which always stays empty pads the leaves of the tree
+        lanes_.resize(laneCount + 1);
+        for(std::size_t lane = 0; lane < laneCount; lane++){
+            lanes_[lane].events.resize(capacity);
+        }
+        lanes_[laneCount].horizon = emptyLane_;
+        heads_.assign(laneCount + 1, emptyLane_);
+
+        leafOffset_ = 1;
+        while(leafOffset_ < laneCount) leafOffset_ <<= 1;
+
+        tree_.assign(2 * leafOffset_, (std::uint16_t)laneCount);
+        for(std::size_t lane = 0; lane < laneCount; lane++){
+            tree_[leafOffset_ + lane] = (std::uint16_t)lane;
+        }
+        for(std::size_t node = leafOffset_ - 1; node > 0; node--){
+            tree_[node] = tree_[2 * node];
+        }
+    }
+
+    /// @brief Replay the matches on the path from the leaf of the lane to the root
+    /// @param lane Lane whose head changed
+    void timeMerger::updateTree(std::size_t lane){
+        for(std::size_t node = (leafOffset_ + lane) / 2; node > 0; node /= 2){
+            std::uint16_t left = tree_[2 * node];
+            std::uint16_t right = tree_[2 * node + 1];
+            tree_[node] = headTimestamp(right) < headTimestamp(left) ? right : left;
+        }
+    }
+
+    /// @brief Time up to which no lane can produce any more events
+    std::uint64_t timeMerger::mergeHorizon() const{
+        std::uint64_t horizon = emptyLane_;
+        for(std::size_t lane = 0; lane + 1 < lanes_.size(); lane++){
+            horizon = std::min(horizon, lanes_[lane].horizon);
+        }
+        return horizon;
+    }
+
+    /// @brief Add an event to the buffer of its lane
+    /// @param event Event with the reconstructed global timestamp
+    /// @return False if the lane is invalid or its buffer is full
+    bool timeMerger::push(const timedEvent & event){
+        if((std::size_t)event.lane + 1 >= lanes_.size()) return false;
+
+        //The event would break the order of the already emitted stream
+        if(event.timestamp < lastEmitted_){
+            lateEvents_++;
+            return true;
+        }
+
+        laneBuffer & buffer = lanes_[event.lane];
+        if(buffer.count > laneMask_) return false;
+
+        //Insertion from the back, the events of a lane are nearly sorted so this rarely moves more than a few
+        std::size_t position = (buffer.head + buffer.count) & laneMask_;
+        std::size_t moved = 0;
+        while(moved < buffer.count){
+            std::size_t previous = (position - 1) & laneMask_;
+            if(buffer.events[previous].timestamp <= event.timestamp) break;
+            buffer.events[position] = buffer.events[previous];
+            position = previous;
+            moved++;
+        }
+        buffer.events[position] = event;
+        buffer.count++;
+
+        if(event.timestamp > reorderWindow_) buffer.horizon = std::max(buffer.horizon, event.timestamp - reorderWindow_);
+
+        //Only a new head changes the tree
+        if(moved + 1 == buffer.count){
+            heads_[event.lane] = event.timestamp;
+            updateTree(event.lane);
+        }
+
+        return true;
+    }
+
+    /// @brief Move the horizon of a lane without any event (idle lanes would hold the merge back)
+    /// @param lane Lane index
+    /// @param timestamp Current global time of the lane
+    void timeMerger::advance(std::size_t lane, std::uint64_t timestamp){
+        if(lane + 1 >= lanes_.size() || timestamp <= reorderWindow_) return;
+        lanes_[lane].horizon = std::max(lanes_[lane].horizon, timestamp - reorderWindow_);
+    }
+
+    std::size_t timeMerger::getPendingEvents() const{
+        std::size_t pending = 0;
+        for(const laneBuffer & buffer : lanes_){
+            pending += buffer.count;
+        }
+        return pending;
+    }
+
+    std::uint64_t timeMerger::getLateEvents() const{
+        return this->lateEvents_;
+    }
+}
@@ -0,0 +1,56 @@
+#include "time_reconstruction.hpp"
+
+namespace fastic{
+
+    /// @brief Construct the reconstructor of one lane
+    /// @param coarseShift Coarse counter tick expressed in ToA ticks as a power of two
+    timeReconstructor::timeReconstructor(unsigned int coarseShift) : coarseShift_(coarseShift)
+    {
+    }
+
+    /// @brief Re-anchor the time base to the coarse counter of an extension packet
+    /// @param packet The extension packet received on the lane
+    void timeReconstructor::extension(extensionPacket packet){
+        std::uint32_t coarseCounter = packet.getCoarseCounter();
+        std::uint32_t packetCount = packet.getPacketCount();
+
+        if(packet.getReset()){
+            //The counters restarted, continue the time base from the last known coarse time
+            coarseBase_ = lastCoarse_;
+            resetCounter_++;
+        }else if(hasExtension_){
+            //The coarse counter wrapped around its 24 bits
+            if(coarseCounter < lastCoarseCounter_) coarseBase_ += (std::uint64_t)1 << 24;
+
+            //Compare the packets the chip sent with the events received since the last extension packet
+            std::uint32_t sentPackets = (packetCount - lastPacketCount_) & 0x7FFFFF;
+            if(sentPackets > eventsSinceExtension_) lostPackets_ += sentPackets - eventsSinceExtension_;
+        }
+
+        lastCoarse_ = coarseBase_ + coarseCounter;
+        lastCoarseCounter_ = coarseCounter;
+        lastPacketCount_ = packetCount;
+        eventsSinceExtension_ = 0;
+        hasExtension_ = true;
+        extensionCounter_++;
+
+        //The following events lie within one ToA period after the coarse time, center the reference on it
+        reference_ = (lastCoarse_ << coarseShift_) + timestampPeriod_ / 2;
+    }
+
+    std::uint64_t timeReconstructor::getLostPackets() const{
+        return this->lostPackets_;
+    }
+
+    std::uint32_t timeReconstructor::getResetCount() const{
+        return this->resetCounter_;
+    }
+
+    std::uint64_t timeReconstructor::getExtensionCount() const{
+        return this->extensionCounter_;
+    }
+
+    std::uint64_t timeReconstructor::getOutOfOrderEvents() const{
+        return this->outOfOrderEvents_;
+    }
+}
@@ -0,0 +1,109 @@
+#include "tx.hpp"
+
+namespace aurora{
+
+    /// @brief Construct the transmitter
+    /// @param bitSlip Number of zero bits sent before the first frame (0 - 65)
+    /// @param scramblerState Initial scrambler state (the scrambled payload preceding the stream)
+    tx::tx(std::uint8_t bitSlip, std::uint64_t scramblerState) :
+        scramblerState_(scramblerState),
+        bitSlip_(bitSlip % 66)
+    {
+    }
+
+    /// @brief Begin the stream with the bitslip bits
+    /// @param words Output of the whole zero words
+    /// @return Number of words written
+    std::size_t tx::start(std::uint32_t * words){
+        if(started_) return 0;
+        started_ = true;
+
+        std::size_t written = 0;
+        for(unsigned int bits = bitSlip_; bits >= 32; bits -= 32){
+            words[written++] = 0;
+        }
+
+        pendingBits_ = 0;
+        pendingCount_ = bitSlip_ % 32;
+        return written;
+    }
+
+    /// @brief Scramble and frame payloads of one kind
+    /// @param payloads Descrambled payloads
+    /// @param count Number of payloads
+    /// @param words Output of the whole words, room for getMaxWords(count) words is enough
+    /// @param control True for control frames, false for data frames
+    /// @return Number of words written
+    std::size_t tx::encode(const std::uint64_t * payloads, std::size_t count, std::uint32_t * words, bool control){
+        std::uint8_t syncBits = control ? controlHeader : dataHeader;
+        std::uint64_t state = scramblerState_;
+        std::size_t written = start(words);
+
+        for(std::size_t idx = 0; idx < count; idx++){
+            written += appendFrame(syncBits, scramble(payloads[idx], state), words + written);
+        }
+
+        scramblerState_ = state;
+        frameCounter_ += count;
+        return written;
+    }
+
+    /// @brief Scramble and frame payloads with their own sync headers
+    /// @param payloads Descrambled payloads
+    /// @param syncBits Sync header of every frame (any 2bit value, the invalid 00 and 11 included)
+    /// @param count Number of payloads
+    /// @param words Output of the whole words, room for getMaxWords(count) words is enough
+    /// @return Number of words written
+    std::size_t tx::encode(const std::uint64_t * payloads, const std::uint8_t * syncBits, std::size_t count, std::uint32_t * words){
+        std::uint64_t state = scramblerState_;
+        std::size_t written = start(words);
+
+        for(std::size_t idx = 0; idx < count; idx++){
+            written += appendFrame(syncBits[idx], scramble(payloads[idx], state), words + written);
+        }
+
+        scramblerState_ = state;
+        frameCounter_ += count;
+        return written;
+    }
+
+    /// @brief End the stream
+    /// @param words Output of the last words
+    /// @return Number of words written
+    std::size_t tx::finish(std::uint32_t * words){
+        //A stream without any frame still carries its bitslip bits
+        std::size_t written = start(words);
+        if(!pendingCount_) return written;
+
+        words[written++] = (std::uint32_t)pendingBits_ << (32 - pendingCount_);
+        pendingBits_ = 0;
+        pendingCount_ = 0;
+        return written;
+    }
+
+    /// @brief Scramble a block of payloads
+    /// @param data Descrambled payloads, replaced by the scrambled ones
+    /// @param count Number of payloads
+    /// @param state Scrambled payload preceding the block
+    /// @return The last scrambled payload of the block
+    std::uint64_t tx::scrambleBlock(std::uint64_t * data, std::size_t count, std::uint64_t state){
+        //Every payload depends on the previous scrambled one, unlike the descrambler this does not vectorize
+        for(std::size_t idx = 0; idx < count; idx++){
+            data[idx] = scramble(data[idx], state);
+        }
+        return state;
+    }
+
+    std::size_t tx::getMaxWords(std::size_t frames){
+        //The frames, up to 65 bitslip bits and the padding of the last word
+        return (frames * 66 + 65 + 31) / 32;
+    }
+
+    std::uint64_t tx::getFrameCount() const{
+        return this->frameCounter_;
+    }
+
+    std::uint64_t tx::getScramblerState() const{
+        return this->scramblerState_;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <cstdio>
+
+/*
+    Minimal checks of the test executables
+
+    A failed CHECK prints its location and condition and is counted, the test goes on so one
+    run reports every mismatch. The main of a test returns checkResult(), ctest fails the
+    test on its non-zero exit code.
+*/
+
+namespace test{
+
+    inline int & failedChecks(){
+        static int failed = 0;
+        return failed;
+    }
+
+    inline int checkResult(){
+        if(failedChecks()) std::fprintf(stderr, "%d check(s) failed\n", failedChecks());
+        return failedChecks() ? 1 : 0;
+    }
+}
+
+#define CHECK(condition) \
+    do{ \
+        if(!(condition)){ \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test::failedChecks()++; \
+        } \
+    }while(0)
+
+#endif
@@ -0,0 +1,176 @@
+/*
+    Chip health model against the counts the chip sent
+
+    Statistics packets with free running counters, crossing the 20bit and 16bit wraps many
+    times, give totals equal to the sum of the increments and rates equal to the last
+    increment over the time between the reports. Halves without their partner are counted,
+    a reset drops only the reference. A reader polling while the writer updates always
+    gets a snapshot of one complete update.
+*/
+
+#include <cstdint>
+#include <cmath>
+#include <array>
+#include <atomic>
+#include <thread>
+#include "fastic.hpp"
+#include "chip_health.hpp"
+#include "check.hpp"
+
+namespace{
+    using counter = fastic::chipHealth::counter;
+    constexpr std::size_t counterCount = fastic::chipHealth::counterCount;
+
+    struct randomSource {
+        std::uint64_t state = 0x9E3779B97F4A7C15;
+
+        std::uint64_t next(std::uint64_t range){
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state % range;
+        }
+    };
+
+    //Free running counters of the chip, truncated to their width when sent
+    struct chipCounters {
+        std::array<std::uint64_t, counterCount> values = {};
+
+        fastic::statisticsPacket toPacket() const{
+            return fastic::statisticsPacket((std::uint32_t)values[0] & fastic::chipHealth::getCounterMask(counter::fifoDrop),
+                                            (std::uint32_t)values[1] & fastic::chipHealth::getCounterMask(counter::pulseWidthDrop),
+                                            (std::uint32_t)values[2] & fastic::chipHealth::getCounterMask(counter::darkCountDrop),
+                                            (std::uint32_t)values[3] & fastic::chipHealth::getCounterMask(counter::triggerDrop),
+                                            (std::uint16_t)(values[4] & fastic::chipHealth::getCounterMask(counter::pulseError)));
+        }
+    };
+
+    //Both halves of the packet through the reassembly, returns true if the second one completed it
+    bool pushPacket(fastic::chipHealth & health, const fastic::statisticsPacket & packet, std::uint64_t time){
+        std::array<aurora::controlPacket, 2> halves = packet.toControlPackets();
+        bool first = health.push(halves[0], time);
+        return !first && health.push(halves[1], time);
+    }
+
+    bool sameRate(double rate, double expected){
+        return std::fabs(rate - expected) <= 1e-9 * std::fabs(expected);
+    }
+
+    void testWraps(){
+        randomSource random;
+        fastic::chipHealth health;
+        chipCounters chip;
+
+        //Start just below the wraps, each increment stays below the width of its counter
+        for(std::size_t idx = 0; idx < counterCount; idx++){
+            chip.values[idx] = fastic::chipHealth::getCounterMask(static_cast<counter>(idx)) - random.next(1000);
+        }
+
+        std::array<std::uint64_t, counterCount> totals = {};
+        std::array<std::uint64_t, counterCount> lastDeltas = {};
+        std::uint64_t time = 5000000000;
+        std::uint64_t elapsed = 0;
+
+        //The first report only sets the reference
+        CHECK(pushPacket(health, chip.toPacket(), time));
+        fastic::chipHealth::snapshot state = health.getSnapshot();
+        CHECK(state.reports == 1);
+        CHECK(state.time == time);
+        for(std::size_t idx = 0; idx < counterCount; idx++) CHECK(state.totals[idx] == 0 && state.rates[idx] == 0.0);
+
+        for(int report = 0; report < 1000; report++){
+            for(std::size_t idx = 0; idx < counterCount; idx++){
+                std::uint64_t width = (std::uint64_t)fastic::chipHealth::getCounterMask(static_cast<counter>(idx)) + 1;
+                //Mostly small steps, now and then one of almost the full width
+                lastDeltas[idx] = random.next(8) ? random.next(width / 3) : width - 1 - random.next(100);
+                chip.values[idx] += lastDeltas[idx];
+                totals[idx] += lastDeltas[idx];
+            }
+            elapsed = 1000 + random.next(100000000);
+            time += elapsed;
+            CHECK(pushPacket(health, chip.toPacket(), time));
+        }
+
+        state = health.getSnapshot();
+        CHECK(state.reports == 1001);
+        CHECK(state.time == time);
+        CHECK(state.incompletePackets == 0);
+        for(std::size_t idx = 0; idx < counterCount; idx++){
+            CHECK(state.getTotal(static_cast<counter>(idx)) == totals[idx]);
+            CHECK(sameRate(state.getRate(static_cast<counter>(idx)), lastDeltas[idx] / (elapsed * 1e-9)));
+            //Far more than the counter can hold, so the wraps were resolved
+            CHECK(totals[idx] > 100 * (std::uint64_t)fastic::chipHealth::getCounterMask(static_cast<counter>(idx)));
+        }
+        CHECK(health.getReportCount() == 1001);
+
+        //A reset keeps the totals, the next report is a new reference whatever the counters jumped by
+        health.reset();
+        chip.values[0] += 12345;
+        CHECK(pushPacket(health, chip.toPacket(), time + 1000));
+        state = health.getSnapshot();
+        CHECK(state.getTotal(counter::fifoDrop) == totals[0]);
+        CHECK(state.getRate(counter::fifoDrop) == 0.0);
+
+        chip.values[0] += 7;
+        CHECK(pushPacket(health, chip.toPacket(), time + 2000));
+        CHECK(health.getSnapshot().getTotal(counter::fifoDrop) == totals[0] + 7);
+
+        //Halves without their partner are dropped and counted
+        std::array<aurora::controlPacket, 2> halves = chip.toPacket().toControlPackets();
+        CHECK(!health.push(halves[1], time + 3000));
+        CHECK(!health.push(halves[0], time + 3000));
+        CHECK(pushPacket(health, chip.toPacket(), time + 4000));
+        state = health.getSnapshot();
+        CHECK(state.incompletePackets == 2);
+        CHECK(state.getTotal(counter::fifoDrop) == totals[0] + 7);
+    }
+
+    void testSnapshots(){
+        //Every report adds the same step to all the counters, a consistent snapshot shows one report on all of them
+        const std::uint64_t reports = 200000;
+        const std::uint64_t period = 1000000;
+        const std::uint64_t step = 7;
+        fastic::chipHealth health;
+        std::atomic<bool> done{false};
+        std::atomic<std::uint64_t> snapshots{0};
+        std::uint64_t torn = 0;
+
+        std::thread reader([&](){
+            while(!done.load(std::memory_order_acquire)){
+                fastic::chipHealth::snapshot state = health.getSnapshot();
+                snapshots++;
+
+                //The first report is the reference, the counters wrap many times over the run
+                std::uint64_t expected = state.reports ? (state.reports - 1) * step : 0;
+                bool consistent = state.time == state.reports * period;
+                for(std::size_t idx = 0; idx < counterCount; idx++){
+                    consistent = consistent && state.totals[idx] == expected && state.rates[idx] == state.rates[0];
+                }
+                torn += !consistent;
+            }
+        });
+
+        //The writer starts once the reader polls and lets it in now and then, also on a single core
+        while(!snapshots.load()) std::this_thread::yield();
+
+        chipCounters chip;
+        for(std::uint64_t report = 0; report < reports; report++){
+            for(std::uint64_t & value : chip.values) value += step;
+            health.update(chip.toPacket(), (report + 1) * period);
+            if(report % 1000 == 0) std::this_thread::yield();
+        }
+        done.store(true, std::memory_order_release);
+        reader.join();
+
+        CHECK(snapshots > 0);
+        CHECK(torn == 0);
+        CHECK(health.getSnapshot().reports == reports);
+    }
+}
+
+int main(){
+    testWraps();
+    testSnapshots();
+
+    return test::checkResult();
+}
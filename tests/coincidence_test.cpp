@@ -0,0 +1,206 @@
+/*
+    Coincidence matcher against a brute force grouping
+
+    Random time ordered streams of triggers and hits on several lanes give the groups a
+    direct search over the whole stream finds: in the trigger mode the hits within +-window
+    of each trigger, in the cluster mode the hits up to window after the first hit of a
+    cluster with enough distinct (lane, channel) pairs. Both window edges are inclusive.
+*/
+
+#include <cstdint>
+#include <vector>
+#include <set>
+#include <utility>
+#include "fastic.hpp"
+#include "coincidence.hpp"
+#include "check.hpp"
+
+namespace{
+    using matcherMode = fastic::coincidenceMatcher::mode;
+
+    struct randomSource {
+        std::uint64_t state = 0x9E3779B97F4A7C15;
+
+        std::uint64_t next(std::uint64_t range){
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state % range;
+        }
+    };
+
+    //Group as the raw data of its trigger (0 in the cluster mode) and of its hits, the raw data are unique in the tests
+    struct group {
+        std::uint64_t trigger;
+        std::vector<std::uint64_t> hits;
+
+        bool operator==(const group & other) const{
+            return trigger == other.trigger && hits == other.hits;
+        }
+    };
+
+    //Event on a channel of a lane, the low bits of the raw data number the events
+    fastic::timedEvent makeEvent(std::uint64_t timestamp, std::uint16_t lane, fastic::eventPacket::channel channel, std::uint64_t number){
+        return {timestamp, ((std::uint64_t)channel << 60) | number, lane};
+    }
+
+    fastic::eventPacket::channel channelOf(const fastic::timedEvent & event){
+        return static_cast<fastic::eventPacket::channel>(event.rawData >> 60);
+    }
+
+    std::vector<fastic::timedEvent> makeStream(std::size_t count, std::uint64_t maxGap, randomSource & random){
+        std::vector<fastic::timedEvent> events;
+        std::uint64_t time = 100;
+        for(std::size_t idx = 0; idx < count; idx++){
+            time += random.next(maxGap + 1);
+            bool trigger = random.next(10) == 0;
+            auto channel = trigger ? fastic::eventPacket::channel::TRIGGER : static_cast<fastic::eventPacket::channel>(random.next(3));
+            events.push_back(makeEvent(time, (std::uint16_t)random.next(3), channel, idx + 1));
+        }
+        return events;
+    }
+
+    std::vector<group> match(matcherMode mode, std::uint64_t window, std::size_t minMultiplicity, const std::vector<fastic::timedEvent> & events, fastic::coincidenceMatcher * matcherOut = nullptr){
+        fastic::coincidenceMatcher matcher(mode, window, minMultiplicity);
+        std::vector<group> groups;
+        auto sink = [&groups](const fastic::coincidence & found){
+            group matched{found.trigger ? found.trigger->rawData : 0, {}};
+            for(std::size_t idx = 0; idx < found.hitCount; idx++) matched.hits.push_back(found.hits[idx].rawData);
+            groups.push_back(matched);
+        };
+
+        for(const fastic::timedEvent & event : events) matcher.push(event, sink);
+        matcher.flush(sink);
+
+        if(matcherOut) *matcherOut = matcher;
+        return groups;
+    }
+
+    std::vector<group> triggerReference(std::uint64_t window, std::size_t minMultiplicity, const std::vector<fastic::timedEvent> & events){
+        std::vector<group> groups;
+        for(const fastic::timedEvent & trigger : events){
+            if(!fastic::coincidenceMatcher::isTrigger(trigger)) continue;
+
+            group matched{trigger.rawData, {}};
+            for(const fastic::timedEvent & hit : events){
+                if(fastic::coincidenceMatcher::isTrigger(hit)) continue;
+                if(hit.timestamp + window >= trigger.timestamp && hit.timestamp <= trigger.timestamp + window) matched.hits.push_back(hit.rawData);
+            }
+            if(matched.hits.size() >= minMultiplicity) groups.push_back(matched);
+        }
+        return groups;
+    }
+
+    std::vector<group> clusterReference(std::uint64_t window, std::size_t minMultiplicity, const std::vector<fastic::timedEvent> & events){
+        std::vector<group> groups;
+        group open{0, {}};
+        std::uint64_t start = 0;
+        std::set<std::pair<std::uint16_t, fastic::eventPacket::channel>> channels;
+
+        auto close = [&](){
+            if(!open.hits.empty() && channels.size() >= minMultiplicity) groups.push_back(open);
+            open.hits.clear();
+            channels.clear();
+        };
+
+        for(const fastic::timedEvent & hit : events){
+            if(fastic::coincidenceMatcher::isTrigger(hit)) continue;
+            if(!open.hits.empty() && hit.timestamp > start + window) close();
+            if(open.hits.empty()) start = hit.timestamp;
+            open.hits.push_back(hit.rawData);
+            channels.insert({hit.lane, channelOf(hit)});
+        }
+        close();
+        return groups;
+    }
+}
+
+int main(){
+    using channel = fastic::eventPacket::channel;
+    randomSource random;
+
+    //Random streams against the brute force grouping, dense and sparse against the window
+    for(std::uint64_t maxGap : {3, 20, 200}){
+        std::vector<fastic::timedEvent> events = makeStream(3000, maxGap, random);
+        for(std::size_t minMultiplicity : {1, 2, 3}){
+            fastic::coincidenceMatcher matcher(matcherMode::trigger, 1);
+            std::vector<group> groups = match(matcherMode::trigger, 50, minMultiplicity, events, &matcher);
+            std::vector<group> expected = triggerReference(50, minMultiplicity, events);
+            CHECK(groups == expected);
+            CHECK(matcher.getGroupCount() == expected.size());
+            CHECK(matcher.getProcessedEvents() == events.size());
+
+            groups = match(matcherMode::cluster, 50, minMultiplicity, events, &matcher);
+            expected = clusterReference(50, minMultiplicity, events);
+            CHECK(groups == expected);
+            CHECK(matcher.getGroupCount() == expected.size());
+        }
+    }
+
+    //Trigger window edges: the hits at exactly +-window belong to the group, one tick further they do not
+    {
+        std::vector<fastic::timedEvent> events = {
+            makeEvent(889, 0, channel::CH0, 1),
+            makeEvent(890, 0, channel::CH1, 2),
+            makeEvent(1000, 1, channel::TRIGGER, 3),
+            makeEvent(1110, 0, channel::CH2, 4),
+            makeEvent(1111, 0, channel::CH3, 5)
+        };
+        std::vector<group> groups = match(matcherMode::trigger, 110, 1, events);
+        CHECK(groups.size() == 1);
+        CHECK(groups.size() == 1 && groups[0] == (group{events[2].rawData, {events[1].rawData, events[3].rawData}}));
+    }
+
+    //Cluster window edges: a hit at exactly window after the first one joins the cluster, one tick further starts the next
+    {
+        std::vector<fastic::timedEvent> events = {
+            makeEvent(1000, 0, channel::CH0, 1),
+            makeEvent(1040, 0, channel::CH1, 2),
+            makeEvent(1040, 0, channel::TRIGGER, 3),
+            makeEvent(1050, 1, channel::CH0, 4),
+            makeEvent(1101, 1, channel::CH1, 5),
+            makeEvent(1151, 2, channel::CH1, 6)
+        };
+        std::vector<group> groups = match(matcherMode::cluster, 50, 1, events);
+        CHECK(groups.size() == 2);
+        CHECK(groups.size() == 2 && groups[0] == (group{0, {events[0].rawData, events[1].rawData, events[3].rawData}}));
+        CHECK(groups.size() == 2 && groups[1] == (group{0, {events[4].rawData, events[5].rawData}}));
+    }
+
+    //Multiplicity: a trigger counts its hits, a cluster its distinct (lane, channel) pairs
+    {
+        std::vector<fastic::timedEvent> burst = {
+            makeEvent(1000, 0, channel::CH0, 1),
+            makeEvent(1001, 0, channel::CH0, 2),
+            makeEvent(1002, 0, channel::TRIGGER, 3),
+            makeEvent(1003, 0, channel::CH0, 4),
+            makeEvent(1004, 1, channel::CH0, 5)
+        };
+        CHECK(match(matcherMode::trigger, 10, 4, burst).size() == 1);
+        CHECK(match(matcherMode::trigger, 10, 5, burst).size() == 0);
+        //The same channel on two lanes are two pairs, the repeated hits of a pair count once
+        CHECK(match(matcherMode::cluster, 10, 2, burst).size() == 1);
+        CHECK(match(matcherMode::cluster, 10, 3, burst).size() == 0);
+
+        std::vector<group> groups = match(matcherMode::cluster, 10, 2, burst);
+        CHECK(groups.size() == 1 && groups[0].hits.size() == 4);
+    }
+
+    //Events breaking the time order are counted and left out
+    {
+        std::vector<fastic::timedEvent> events = {
+            makeEvent(1000, 0, channel::TRIGGER, 1),
+            makeEvent(1005, 0, channel::CH0, 2),
+            makeEvent(1004, 0, channel::CH1, 3),
+            makeEvent(1005, 1, channel::CH1, 4)
+        };
+        fastic::coincidenceMatcher matcher(matcherMode::trigger, 1);
+        std::vector<group> groups = match(matcherMode::trigger, 10, 1, events, &matcher);
+        CHECK(matcher.getUnorderedEvents() == 1);
+        CHECK(matcher.getProcessedEvents() == 3);
+        CHECK(matcher.getMatchedHits() == 2);
+        CHECK(groups.size() == 1 && groups[0] == (group{events[0].rawData, {events[1].rawData, events[3].rawData}}));
+    }
+
+    return test::checkResult();
+}
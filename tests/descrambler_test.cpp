@@ -0,0 +1,122 @@
+/*
+    Descrambler against the bit-serial reference
+
+    Built linked with the library (the block path -march=native selects) and with the receiver
+    compiled for a fixed instruction set (the scalar and the AVX2 block paths).
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <random>
+#include "aurora.hpp"
+#include "sample_databuff.hpp"
+#include "check.hpp"
+#include "reference.hpp"
+
+namespace{
+    //Descramble a run of payloads one by one with the reference
+    std::vector<std::uint64_t> referenceBlock(const std::vector<std::uint64_t> & scrambled, std::uint64_t previousData){
+        std::vector<std::uint64_t> data(scrambled);
+        for(std::uint64_t & word : data){
+            std::uint64_t scrambledWord = word;
+            reference::descramblePacketData(word, previousData);
+            previousData = scrambledWord;
+        }
+        return data;
+    }
+
+    void testWords(std::mt19937_64 & random){
+        for(int idx = 0; idx < 100000; idx++){
+            std::uint64_t current = random(), previous = random();
+            std::uint64_t expected = current;
+            reference::descramblePacketData(expected, previous);
+            aurora::rx::descramblePacketData(current, previous);
+            CHECK(current == expected);
+        }
+
+        //Single set bits show every tap on its own
+        for(int bit = 0; bit < 64; bit++){
+            for(std::uint64_t previous : {(std::uint64_t)0, (std::uint64_t)1 << bit}){
+                std::uint64_t current = previous ? 0 : (std::uint64_t)1 << bit;
+                std::uint64_t expected = current;
+                reference::descramblePacketData(expected, previous);
+                aurora::rx::descramblePacketData(current, previous);
+                CHECK(current == expected);
+            }
+        }
+    }
+
+    void testBlocks(std::mt19937_64 & random){
+        //Every length around the vector widths, so the vector body and the scalar tail both run
+        for(std::size_t count = 0; count <= 67; count++){
+            for(std::size_t offset = 0; offset < 3; offset++){
+                std::vector<std::uint64_t> scrambled(count);
+                for(std::uint64_t & word : scrambled) word = random();
+                std::uint64_t previous = random();
+
+                //An unaligned start of the block
+                std::vector<std::uint64_t> buffer(offset + count);
+                std::copy(scrambled.begin(), scrambled.end(), buffer.begin() + offset);
+                std::uint64_t state = aurora::rx::descramblePacketBlock(buffer.data() + offset, count, previous);
+
+                std::vector<std::uint64_t> expected = referenceBlock(scrambled, previous);
+                CHECK(std::equal(expected.begin(), expected.end(), buffer.begin() + offset));
+                CHECK(state == (count ? scrambled.back() : previous));
+            }
+        }
+
+        //A long stream descrambled block after block continues across the blocks
+        std::vector<std::uint64_t> scrambled(10007);
+        for(std::uint64_t & word : scrambled) word = random();
+        std::vector<std::uint64_t> data(scrambled);
+        std::uint64_t state = 0;
+        for(std::size_t begin = 0, block = 1; begin < data.size(); begin += block, block = block * 3 % 61 + 1){
+            std::size_t count = std::min(block, data.size() - begin);
+            state = aurora::rx::descramblePacketBlock(data.data() + begin, count, state);
+        }
+        CHECK(data == referenceBlock(scrambled, 0));
+    }
+
+    void testSampleCapture(){
+        const std::size_t words = sizeof(auroraData) / sizeof(auroraData[0]);
+        aurora::rx receiver(auroraData, words);
+        CHECK(receiver.synchronize());
+        receiver.processRxBuffer();
+
+        //The first frame only seeds the descrambler, packet idx is the frame idx + 1
+        const std::vector<aurora::packet> & packets = receiver.getPacketBuffer();
+        std::size_t frames = (words * 32 - receiver.getBitSlip()) / 66;
+        CHECK(packets.size() + 1 == frames);
+
+        for(std::size_t idx = 0; idx < packets.size(); idx++){
+            std::size_t position = receiver.getBitSlip() + 66 * (idx + 1);
+            std::uint64_t expected = aurora::rx::extractPacketData(auroraData, position);
+            reference::descramblePacketData(expected, aurora::rx::extractPacketData(auroraData, position - 66));
+            CHECK(packets[idx].data == expected);
+        }
+    }
+}
+
+int main(){
+#if defined(__GNUC__) && defined(__AVX512F__)
+    if(!__builtin_cpu_supports("avx512f")) return 77;
+#elif defined(__GNUC__) && defined(__AVX2__)
+    if(!__builtin_cpu_supports("avx2")) return 77;
+#endif
+
+#if defined(__AVX512F__)
+    std::printf("descramblePacketBlock path: AVX-512\n");
+#elif defined(__AVX2__)
+    std::printf("descramblePacketBlock path: AVX2\n");
+#else
+    std::printf("descramblePacketBlock path: scalar\n");
+#endif
+
+    std::mt19937_64 random(1);
+    testWords(random);
+    testBlocks(random);
+    testSampleCapture();
+
+    return test::checkResult();
+}
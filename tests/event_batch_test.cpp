@@ -0,0 +1,127 @@
+/*
+    Column decoder against the event packet
+
+    eventBatch decodes random words, valid events and corrupted ones into the fields,
+    parity and debug bits eventPacket finds word by word, with the metrics counting the
+    failed checks of every field, and encodes the columns back. The runs start at any
+    offset of the batch and have any length, so the vector body and the scalar head and
+    tail all run. Built linked with the library (the path -march=native selects) and with
+    the decoder compiled for a fixed instruction set (the scalar and the AVX2 paths).
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <random>
+#include "fastic.hpp"
+#include "decoder_metrics.hpp"
+#include "event_batch.hpp"
+#include "check.hpp"
+
+namespace{
+    //Random words, valid events and valid events with one flipped bit
+    std::vector<std::uint64_t> makeWords(std::size_t count, std::mt19937_64 & random){
+        std::vector<std::uint64_t> words(count);
+        for(std::uint64_t & word : words){
+            word = random();
+            if(word % 3 == 0) continue;
+
+            fastic::eventPacket event(static_cast<fastic::eventPacket::type>(word & 0x03), static_cast<fastic::eventPacket::channel>((word >> 2) % 9),
+                                      (std::uint32_t)(word >> 8), (std::uint16_t)(word >> 30));
+            std::uint64_t data = event.toDataPacket().getData() | (((word >> 44) & 1) << 5);
+            if(word % 3 == 1) data ^= (std::uint64_t)1 << ((word >> 50) % 64);
+            word = data;
+        }
+        return words;
+    }
+
+    void testDecode(std::mt19937_64 & random){
+        std::vector<std::uint64_t> words = makeWords(5000, random);
+
+        fastic::eventBatch batch;
+        fastic::decoderMetrics metrics;
+        batch.setMetrics(&metrics);
+
+        //Runs of every length around the vector width, appended at every offset of a bitmap byte
+        std::size_t decoded = 0;
+        for(std::size_t run = 0; decoded < words.size(); run = run % 19 + 1){
+            std::size_t count = std::min(run, words.size() - decoded);
+            batch.decode(words.data() + decoded, count);
+            decoded += count;
+        }
+        CHECK(batch.size() == words.size());
+
+        fastic::decoderMetrics::parityCounts expected;
+        for(std::size_t idx = 0; idx < words.size(); idx++){
+            fastic::eventPacket event{aurora::dataPacket(words[idx])};
+            bool isValid;
+            std::uint8_t parityErrors = event.getParityErrors();
+            expected.add(parityErrors);
+
+            CHECK(batch.getChannel(idx) == event.getChannel(isValid));
+            CHECK(batch.getType(idx) == event.getType(isValid));
+            CHECK(batch.getTimestamp(idx) == event.getTimestamp(isValid));
+            CHECK(batch.getPulseWidth(idx) == event.getPulseWidth(isValid));
+            CHECK(batch.getDebugBit(idx) == event.getDebugBit());
+            CHECK(batch.hasValidParity(idx) == !parityErrors);
+            CHECK(fastic::eventBatch::checkParity(words[idx]) == !parityErrors);
+            CHECK(fastic::eventBatch::checkParityFields(words[idx]) == parityErrors);
+        }
+
+        CHECK(metrics.getEvents() == words.size());
+        CHECK(metrics.getInvalidEvents() == expected.invalidEvents);
+        for(std::size_t field = 0; field < expected.fields.size(); field++){
+            CHECK(metrics.getParityErrors(static_cast<fastic::decoderMetrics::field>(field)) == expected.fields[field]);
+        }
+
+        //Decoding again into the cleared batch overwrites the bitmaps instead of merging into them
+        batch.clear();
+        std::vector<std::uint64_t> inverted(words.size());
+        for(std::size_t idx = 0; idx < words.size(); idx++) inverted[idx] = words[idx] ^ 0x21;
+        batch.decode(inverted.data() + 3, inverted.size() - 3);
+        for(std::size_t idx = 0; idx + 3 < inverted.size(); idx++){
+            CHECK(batch.hasValidParity(idx) == fastic::eventBatch::checkParity(inverted[idx + 3]));
+            CHECK(batch.getDebugBit(idx) == (((inverted[idx + 3] >> 5) & 1) != 0));
+        }
+    }
+
+    void testEncode(std::mt19937_64 & random){
+        std::vector<std::uint64_t> words = makeWords(1000, random);
+        fastic::eventBatch batch;
+        batch.decode(words.data(), words.size());
+
+        //Any start and length, the encoded words are the fields with all the parities filled in
+        for(std::size_t first = 0; first < 5; first++){
+            for(std::size_t count : {0, 1, 3, 4, 7, 9, 100, 995}){
+                std::vector<std::uint64_t> encoded(count);
+                batch.encode(first, count, encoded.data());
+                for(std::size_t idx = 0; idx < count; idx++){
+                    std::size_t position = first + idx;
+                    std::uint64_t expected = fastic::eventPacket(batch.getType(position), batch.getChannel(position), batch.getTimestamp(position),
+                                                                 batch.getPulseWidth(position)).toDataPacket().getData()
+                                           | ((std::uint64_t)batch.getDebugBit(position) << 5);
+                    CHECK(encoded[idx] == expected);
+                    CHECK(fastic::eventBatch::checkParity(encoded[idx]));
+                }
+            }
+        }
+    }
+}
+
+int main(){
+#if defined(__GNUC__) && defined(__AVX2__)
+    if(!__builtin_cpu_supports("avx2")) return 77;
+#endif
+
+#if defined(__AVX2__)
+    std::printf("eventBatch path: AVX2\n");
+#else
+    std::printf("eventBatch path: scalar\n");
+#endif
+
+    std::mt19937_64 random(7);
+    testDecode(random);
+    testEncode(random);
+
+    return test::checkResult();
+}
@@ -0,0 +1,113 @@
+/*
+    Event file written and read back
+
+    The events written one by one and as decoded batches, and the statistics records, come
+    back from the reader with every field, timestamp and lane intact.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <random>
+#include "event_file.hpp"
+#include "event_batch.hpp"
+#include "capture.hpp"
+#include "check.hpp"
+
+namespace{
+    const char * filePath = "event_file_test.bin";
+
+    struct writtenEvent {
+        std::uint64_t timestamp;
+        std::uint64_t rawData;
+        std::uint16_t lane;
+    };
+
+    void checkStored(const fastic::eventFile::storedEvent & stored, const writtenEvent & written){
+        fastic::eventPacket event{aurora::dataPacket(written.rawData)};
+        bool valid;
+
+        CHECK(stored.timestamp == written.timestamp);
+        CHECK(stored.lane == written.lane);
+        CHECK(stored.channel == (std::uint8_t)event.getChannel(valid));
+        CHECK(stored.type == (std::uint8_t)event.getType(valid));
+        CHECK(stored.pulseWidth == event.getPulseWidth(valid));
+        CHECK(stored.debug == event.getDebugBit());
+        CHECK(stored.parityOk == fastic::eventBatch::checkParity(written.rawData));
+    }
+}
+
+int main(){
+    std::mt19937_64 random(3);
+
+    //Events of two lanes with random fields, some of them with a broken parity
+    std::vector<std::uint64_t> raw(3001);
+    for(std::size_t idx = 0; idx < raw.size(); idx++){
+        raw[idx] = fastic::captureSynthesizer::eventWord((fastic::eventPacket::channel)(random() % 16), (fastic::eventPacket::type)(random() % 4),
+                                                         random() & 0x3FFFFF, random() & 0x3FFF, random() & 1);
+        if(idx % 97 == 3) raw[idx] ^= (std::uint64_t)1 << 40;
+    }
+
+    std::vector<writtenEvent> expected;
+    std::vector<std::uint64_t> timestamps(raw.size());
+    std::uint64_t time = 1000;
+    for(std::uint64_t & timestamp : timestamps){
+        //Small and large steps and the occasional step back keep the delta width changing
+        time += random() % 7 == 0 ? random() % 1000000 : random() % 100;
+        timestamp = random() % 53 == 0 ? time - 50 : time;
+    }
+
+    //Chunks much smaller than the events, so the file holds many of them
+    fastic::eventFileWriter writer(700);
+    CHECK(writer.open(filePath));
+
+    //The batch writer, with a batch decoded in two parts
+    fastic::eventBatch batch;
+    batch.decode(raw.data(), 5);
+    batch.decode(raw.data() + 5, 2000 - 5);
+    CHECK(writer.write(batch, timestamps.data(), 7));
+    for(std::size_t idx = 0; idx < 2000; idx++) expected.push_back({timestamps[idx], raw[idx], 7});
+
+    //The single event writer on another lane, the highest one the file can hold
+    for(std::size_t idx = 2000; idx < raw.size(); idx++){
+        CHECK(writer.write(fastic::timedEvent{timestamps[idx], raw[idx], fastic::eventFile::maxLane}));
+        expected.push_back({timestamps[idx], raw[idx], fastic::eventFile::maxLane});
+    }
+
+    //The lanes the field word can not hold are rejected by both writers
+    CHECK(!writer.write(fastic::timedEvent{time, raw[0], fastic::eventFile::maxLane + 1}));
+    CHECK(!writer.write(batch, timestamps.data(), fastic::eventFile::maxLane + 1));
+
+    CHECK(writer.write(fastic::statisticsPacket(1, 2, 3, 4, 5), 77, 3));
+    CHECK(writer.close());
+    CHECK(writer.getWrittenEvents() == expected.size());
+
+    fastic::eventFileReader reader;
+    CHECK(reader.open(filePath));
+
+    std::size_t index = 0;
+    std::uint64_t events = reader.forEachEvent([&](const fastic::eventFile::storedEvent & stored){
+        if(index < expected.size()) checkStored(stored, expected[index]);
+        index++;
+    });
+    CHECK(events == expected.size());
+    CHECK(index == expected.size());
+
+    std::size_t statistics = 0;
+    fastic::eventChunk chunk;
+    reader.rewind();
+    while(reader.nextChunk(chunk)){
+        for(std::size_t idx = 0; idx < chunk.getStatisticsCount(); idx++){
+            const fastic::eventFile::statisticsRecord & record = chunk.getStatistics()[idx];
+            CHECK(record.timestamp == 77 && record.lane == 3);
+            CHECK(record.fifoDrop == 1 && record.pulseWidthDrop == 2 && record.darkCountDrop == 3 && record.triggerDrop == 4 && record.pulseError == 5);
+            statistics++;
+        }
+    }
+    CHECK(statistics == 1);
+
+    reader.close();
+    std::remove(filePath);
+
+    return test::checkResult();
+}
@@ -0,0 +1,147 @@
+/*
+    Raw word filter against the event packet
+
+    eventFilter keeps exactly the words whose eventPacket fields pass the configured
+    criteria, in their order, and counts the rejects of every criterion on its own. Random
+    configurations and word counts around the vector width run the vector body and the
+    scalar tail, in place and into a separate buffer. Built linked with the library (the
+    path -march=native selects) and with the filter compiled for a fixed instruction set
+    (the scalar and the AVX2 paths).
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <array>
+#include <random>
+#include "fastic.hpp"
+#include "event_filter.hpp"
+#include "check.hpp"
+
+namespace{
+    using criterion = fastic::eventFilter::criterion;
+    using parityPolicy = fastic::eventFilter::parityPolicy;
+
+    //Random words, valid events and valid events with one flipped bit
+    std::vector<std::uint64_t> makeWords(std::size_t count, std::mt19937_64 & random){
+        std::vector<std::uint64_t> words(count);
+        for(std::uint64_t & word : words){
+            word = random();
+            if(word % 3 == 0) continue;
+
+            fastic::eventPacket event(static_cast<fastic::eventPacket::type>(word & 0x03), static_cast<fastic::eventPacket::channel>((word >> 2) % 9),
+                                      (std::uint32_t)(word >> 8), (std::uint16_t)(word >> 30));
+            std::uint64_t data = event.toDataPacket().getData() | (((word >> 44) & 1) << 5);
+            if(word % 3 == 1) data ^= (std::uint64_t)1 << ((word >> 50) % 64);
+            word = data;
+        }
+        return words;
+    }
+
+    fastic::eventFilter::config makeConfig(std::mt19937_64 & random){
+        fastic::eventFilter::config config;
+        config.channels = (std::uint16_t)random();
+        config.types = (std::uint8_t)(random() & 0x0F);
+        config.minPulseWidth = (std::uint16_t)(random() % 0x3000);
+        config.maxPulseWidth = (std::uint16_t)(config.minPulseWidth + random() % 0x2000);
+        config.parity = static_cast<parityPolicy>(random() % 3);
+        config.rejectDebug = random() & 1;
+        return config;
+    }
+
+    //Reject flags of a word, indexed by the criterion
+    std::array<bool, fastic::eventFilter::criterionCount> referenceRejects(const fastic::eventFilter::config & config, std::uint64_t word){
+        fastic::eventPacket event{aurora::dataPacket(word)};
+        bool isValid;
+        std::uint16_t pulseWidth = event.getPulseWidth(isValid);
+        bool parityOk = !event.getParityErrors();
+
+        return {
+            !((config.channels >> static_cast<unsigned int>(event.getChannel(isValid))) & 1),
+            !((config.types >> static_cast<unsigned int>(event.getType(isValid))) & 1),
+            pulseWidth < config.minPulseWidth || pulseWidth > config.maxPulseWidth,
+            config.parity != parityPolicy::accept && parityOk != (config.parity == parityPolicy::rejectInvalid),
+            config.rejectDebug && event.getDebugBit()
+        };
+    }
+
+    void testApply(std::mt19937_64 & random){
+        for(int round = 0; round < 200; round++){
+            fastic::eventFilter::config config = makeConfig(random);
+            if(round % 10 == 0) config = fastic::eventFilter::config();
+            fastic::eventFilter filter(config);
+
+            std::size_t count = random() % 70;
+            std::vector<std::uint64_t> words = makeWords(count, random);
+
+            std::vector<std::uint64_t> expected;
+            std::array<std::uint64_t, fastic::eventFilter::criterionCount> expectedRejects = {};
+            for(std::uint64_t word : words){
+                std::array<bool, fastic::eventFilter::criterionCount> rejects = referenceRejects(config, word);
+                bool rejected = false;
+                for(std::size_t idx = 0; idx < rejects.size(); idx++){
+                    expectedRejects[idx] += rejects[idx];
+                    rejected = rejected || rejects[idx];
+                }
+                if(!rejected) expected.push_back(word);
+                CHECK(filter.accepts(word) == !rejected);
+            }
+
+            //Into a separate buffer, then in place over the input
+            std::vector<std::uint64_t> survivors(count);
+            std::size_t kept = filter.apply(words.data(), count, survivors.data());
+            survivors.resize(kept);
+            CHECK(survivors == expected);
+
+            kept = filter.apply(words.data(), count, words.data());
+            words.resize(kept);
+            CHECK(words == expected);
+
+            CHECK(filter.getEvents() == 2 * count);
+            CHECK(filter.getAccepted() == 2 * expected.size());
+            for(std::size_t idx = 0; idx < expectedRejects.size(); idx++){
+                CHECK(filter.getRejects(static_cast<criterion>(idx)) == 2 * expectedRejects[idx]);
+            }
+        }
+    }
+
+    void testForward(std::mt19937_64 & random){
+        //Several blocks with a partial last one, the survivors of every block arrive in order
+        for(int round = 0; round < 10; round++){
+            fastic::eventFilter::config config = round ? makeConfig(random) : fastic::eventFilter::config();
+            fastic::eventFilter filter(config);
+            fastic::eventFilter reference(config);
+            std::vector<std::uint64_t> words = makeWords(3 * fastic::eventFilter::blockSize + 77 + round, random);
+
+            std::vector<std::uint64_t> expected(words.size());
+            expected.resize(reference.apply(words.data(), words.size(), expected.data()));
+
+            std::vector<std::uint64_t> forwarded;
+            filter.forward(words.data(), words.size(), [&forwarded](const std::uint64_t * survivors, std::size_t count){
+                CHECK(count > 0);
+                forwarded.insert(forwarded.end(), survivors, survivors + count);
+            });
+            CHECK(forwarded == expected);
+            CHECK(filter.getAccepted() == expected.size());
+            CHECK(filter.getEvents() == words.size());
+        }
+    }
+}
+
+int main(){
+#if defined(__GNUC__) && defined(__AVX2__)
+    if(!__builtin_cpu_supports("avx2")) return 77;
+#endif
+
+#if defined(__AVX2__)
+    std::printf("eventFilter path: AVX2\n");
+#else
+    std::printf("eventFilter path: scalar\n");
+#endif
+
+    std::mt19937_64 random(11);
+    testApply(random);
+    testForward(random);
+
+    return test::checkResult();
+}
@@ -0,0 +1,120 @@
+/*
+    Calibration histograms against a direct binning
+
+    Runs of random words of any length, spread over several accumulators, give the bins a
+    direct binning of their eventPacket fields gives, for every ToA shift. The single word,
+    run and decoded batch updates fill the same bins. Built linked with the library (the
+    path -march=native selects) and with the histograms compiled for a fixed instruction
+    set (the scalar and the AVX2 paths).
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "fastic.hpp"
+#include "event_batch.hpp"
+#include "histogram.hpp"
+#include "check.hpp"
+
+namespace{
+    using histograms = fastic::eventHistograms;
+
+    //Bins of the words counted one by one from the fields, the channel codes above TRIGGER in the last slot (as type 3 above code 9)
+    void referenceBins(const std::vector<std::uint64_t> & words, unsigned int toaShift, std::vector<std::uint64_t> & pulseWidth, std::vector<std::uint64_t> & toa){
+        pulseWidth.assign(histograms::slotCount * histograms::typeCount * histograms::pulseWidthBins, 0);
+        toa.assign(histograms::slotCount * histograms::toaBins, 0);
+
+        for(std::uint64_t word : words){
+            fastic::eventPacket event{aurora::dataPacket(word)};
+            bool isValid;
+            std::size_t channel = static_cast<std::size_t>(event.getChannel(isValid));
+            std::size_t type = static_cast<std::size_t>(event.getType(isValid));
+            std::size_t slot = std::min(channel, histograms::slotCount - 1);
+            if(channel > histograms::slotCount - 1) type = histograms::typeCount - 1;
+
+            pulseWidth[(slot * histograms::typeCount + type) * histograms::pulseWidthBins + event.getPulseWidth(isValid)]++;
+            toa[slot * histograms::toaBins + ((event.getTimestamp(isValid) >> toaShift) % histograms::toaBins)]++;
+        }
+    }
+
+    void testRuns(std::mt19937_64 & random){
+        for(unsigned int toaShift : {0u, 5u, histograms::maxToaShift, histograms::maxToaShift + 3}){
+            histograms histogram(3, toaShift);
+            std::vector<std::uint64_t> words;
+
+            //Runs of every length around the vector width and the block size, at any alignment of the input
+            std::vector<std::uint64_t> run(700);
+            for(std::size_t count : {0, 1, 5, 7, 8, 9, 15, 255, 256, 257, 300, 695}){
+                std::size_t offset = random() % 5;
+                for(std::size_t idx = 0; idx < count; idx++){
+                    //Few channel codes above TRIGGER, the valid slots get most of the events
+                    std::uint64_t word = random();
+                    if(word % 4) word = (word & ~((std::uint64_t)0xF << 60)) | (((word >> 1) % 9) << 60);
+                    run[offset + idx] = word;
+                    words.push_back(word);
+                }
+                histogram.getAccumulator(count % 3).add(run.data() + offset, count);
+            }
+
+            histograms::snapshot snapshot = histogram.getSnapshot();
+            std::vector<std::uint64_t> pulseWidth, toa;
+            referenceBins(words, std::min(toaShift, histograms::maxToaShift), pulseWidth, toa);
+
+            CHECK(snapshot.events == words.size());
+            CHECK(snapshot.toaShift == std::min(toaShift, histograms::maxToaShift));
+            CHECK(snapshot.pulseWidth == pulseWidth);
+            CHECK(snapshot.toa == toa);
+
+            std::uint64_t invalidChannels = 0;
+            for(std::uint64_t word : words) invalidChannels += (word >> 60) > static_cast<std::uint64_t>(fastic::eventPacket::channel::TRIGGER);
+            CHECK(snapshot.getInvalidChannelEvents() == invalidChannels);
+        }
+    }
+
+    void testUpdates(std::mt19937_64 & random){
+        //The same words one by one, as a run and as a decoded batch
+        std::vector<std::uint64_t> words(1000);
+        for(std::uint64_t & word : words) word = random();
+
+        fastic::eventBatch batch;
+        batch.decode(words.data(), words.size());
+
+        histograms single(1, 7), bulk(1, 7), decoded(1, 7);
+        for(std::uint64_t word : words) single.getAccumulator(0).add(word);
+        bulk.getAccumulator(0).add(words.data(), words.size());
+        decoded.getAccumulator(0).add(batch);
+
+        histograms::snapshot expected = single.getSnapshot();
+        histograms::snapshot fromRun = bulk.getSnapshot();
+        histograms::snapshot fromBatch = decoded.getSnapshot();
+        CHECK(fromRun.pulseWidth == expected.pulseWidth && fromRun.toa == expected.toa && fromRun.events == expected.events);
+        CHECK(fromBatch.pulseWidth == expected.pulseWidth && fromBatch.toa == expected.toa && fromBatch.events == expected.events);
+
+        //Clearing empties every bin
+        bulk.clear();
+        fromRun = bulk.getSnapshot();
+        CHECK(fromRun.events == 0);
+        CHECK(std::all_of(fromRun.pulseWidth.begin(), fromRun.pulseWidth.end(), [](std::uint64_t bin){ return bin == 0; }));
+        CHECK(std::all_of(fromRun.toa.begin(), fromRun.toa.end(), [](std::uint64_t bin){ return bin == 0; }));
+    }
+}
+
+int main(){
+#if defined(__GNUC__) && defined(__AVX2__)
+    if(!__builtin_cpu_supports("avx2")) return 77;
+#endif
+
+#if defined(__AVX2__)
+    std::printf("eventHistograms path: AVX2\n");
+#else
+    std::printf("eventHistograms path: scalar\n");
+#endif
+
+    std::mt19937_64 random(13);
+    testRuns(random);
+    testUpdates(random);
+
+    return test::checkResult();
+}
@@ -0,0 +1,232 @@
+/*
+    Multi-lane receiver against a single receiver per lane
+
+    Captures of several lanes, submitted in pool buffers of any size through small buffer
+    and event queues, come out of multiRx lane by lane as exactly the events one rx gives
+    for the same chunks, while the consumer lags behind and the workers park and wake. Every
+    pool buffer goes back to the pool, and the lanes are spread over the workers as
+    documented. A lost wakeup shows as a lane which stops before its deadline.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include "aurora.hpp"
+#include "buffer_pool.hpp"
+#include "multi_rx.hpp"
+#include "capture.hpp"
+#include "check.hpp"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace{
+    using steadyClock = std::chrono::steady_clock;
+
+    struct randomSource {
+        std::uint64_t state = 0x9E3779B97F4A7C15;
+
+        std::uint64_t next(std::uint64_t range){
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state % range;
+        }
+    };
+
+    //Capture of one lane cut into chunks of any size around the slice of the workers
+    struct laneCapture {
+        std::vector<std::uint32_t> words;
+        std::vector<std::size_t> chunkEnds;
+        std::vector<std::uint64_t> expected;    //Event words of a single rx fed the same chunks
+    };
+
+    std::uint64_t eventWord(const fastic::eventPacket & event){
+        return event.toDataPacket().getData();
+    }
+
+    laneCapture makeCapture(std::size_t lane, std::size_t maxChunkWords, randomSource & random){
+        fastic::captureSynthesizer::config config;
+        config.bitSlip = (lane * 23) % 66;
+        config.seed = lane + 1;
+        config.statisticsInterval = 100;
+        config.idleRate = 0.05;
+
+        fastic::captureSynthesizer synthesizer(config);
+        laneCapture capture;
+        synthesizer.generate(40000 + 5000 * lane, capture.words);
+        synthesizer.finish(capture.words);
+
+        for(std::size_t end = 0; end < capture.words.size();){
+            end = std::min(capture.words.size(), end + 1 + random.next(maxChunkWords));
+            capture.chunkEnds.push_back(end);
+        }
+
+        aurora::rx receiver(nullptr, 0);
+        std::size_t begin = 0;
+        for(std::size_t end : capture.chunkEnds){
+            receiver.feedPayloads(capture.words.data() + begin, end - begin, [&capture](const std::uint64_t * payloads, std::size_t count){
+                for(std::size_t idx = 0; idx < count; idx++) capture.expected.push_back(eventWord(fastic::eventPacket{aurora::dataPacket(payloads[idx])}));
+            }, [](const aurora::controlPacket &){});
+            begin = end;
+        }
+        return capture;
+    }
+
+    void testLanes(std::size_t laneCount, std::size_t workerCount){
+        const std::size_t maxChunkWords = 10000;
+        randomSource random;
+        std::vector<laneCapture> captures;
+        for(std::size_t lane = 0; lane < laneCount; lane++) captures.push_back(makeCapture(lane, maxChunkWords, random));
+
+        //Fewer buffers than the queues hold, the producer waits for the workers to release them
+        aurora::bufferPool pool(laneCount + 1, maxChunkWords * sizeof(std::uint32_t), false);
+        CHECK(pool.isAllocated());
+        fastic::multiRx receiver(laneCount, workerCount, 64, 2);
+
+        //Mapping of the lanes to the workers
+        CHECK(receiver.getLaneCount() == laneCount);
+        CHECK(receiver.getWorkerCount() == std::min(laneCount, workerCount));
+        for(std::size_t lane = 0; lane < laneCount; lane++) CHECK(receiver.getLaneWorker(lane) == lane % receiver.getWorkerCount());
+
+#if defined(__linux__)
+        //Each worker runs on the core of the process cpuset its index selects, unless the pinning failed
+        cpu_set_t allowedSet;
+        CPU_ZERO(&allowedSet);
+        std::vector<int> allowedCores;
+        if(sched_getaffinity(0, sizeof(allowedSet), &allowedSet) == 0){
+            for(int core = 0; core < CPU_SETSIZE; core++){
+                if(CPU_ISSET(core, &allowedSet)) allowedCores.push_back(core);
+            }
+        }
+        for(std::size_t worker = 0; worker < receiver.getWorkerCount() && !allowedCores.empty(); worker++){
+            int core = receiver.getWorkerCore(worker);
+            CHECK(core == -1 || core == allowedCores[worker % allowedCores.size()]);
+        }
+#endif
+
+        steadyClock::time_point deadline = steadyClock::now() + std::chrono::seconds(60);
+        std::atomic<bool> timedOut{false};
+
+        //One producer for all the lanes, pausing now and then so that the workers run dry and park
+        std::thread producer([&](){
+            randomSource pauses;
+            std::vector<std::size_t> nextChunk(laneCount, 0);
+            std::size_t remaining = 0;
+            for(const laneCapture & capture : captures) remaining += capture.chunkEnds.size();
+
+            while(remaining && !timedOut){
+                std::size_t lane = pauses.next(laneCount);
+                const laneCapture & capture = captures[lane];
+                if(nextChunk[lane] == capture.chunkEnds.size()) continue;
+
+                std::size_t index;
+                if(!pool.acquire(index)){
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                std::size_t begin = nextChunk[lane] ? capture.chunkEnds[nextChunk[lane] - 1] : 0;
+                std::size_t size = capture.chunkEnds[nextChunk[lane]] - begin;
+                std::memcpy(pool.getBuffer(index), capture.words.data() + begin, size * sizeof(std::uint32_t));
+
+                while(!receiver.submit(lane, pool, index, size) && !timedOut) std::this_thread::yield();
+                nextChunk[lane]++;
+                remaining--;
+
+                if(pauses.next(20) == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        });
+
+        //The consumer lags behind as well, the full event queues keep the events of a slice aside
+        std::vector<std::vector<std::uint64_t>> received(laneCount);
+        std::size_t complete = 0;
+        randomSource pauses;
+        while(complete < laneCount){
+            complete = 0;
+            for(std::size_t lane = 0; lane < laneCount; lane++){
+                receiver.drain(lane, [&received, lane](fastic::eventPacket & event){ received[lane].push_back(eventWord(event)); }, 1 + pauses.next(100));
+                complete += received[lane].size() >= captures[lane].expected.size();
+            }
+
+            if(pauses.next(50) == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if(steadyClock::now() > deadline){
+                timedOut = true;
+                break;
+            }
+        }
+        producer.join();
+        CHECK(!timedOut);
+
+        for(std::size_t lane = 0; lane < laneCount; lane++){
+            std::uint64_t chunks = captures[lane].chunkEnds.size();
+            while(receiver.getCompletedBuffers(lane) < chunks && steadyClock::now() < deadline) std::this_thread::yield();
+
+            CHECK(received[lane] == captures[lane].expected);
+            CHECK(receiver.getCompletedBuffers(lane) == chunks);
+            CHECK(receiver.getDecoderMetrics(lane).getEvents() == captures[lane].expected.size());
+            CHECK(receiver.getFilter(lane).getAccepted() == captures[lane].expected.size());
+        }
+
+        receiver.stop();
+        CHECK(pool.getFreeCount() == pool.getBufferCount());
+    }
+
+    void testWakeups(){
+        //Every buffer is submitted to a parked worker and must be decoded without any other nudge
+        fastic::captureSynthesizer::config config;
+        fastic::captureSynthesizer synthesizer(config);
+        std::vector<std::uint32_t> words;
+        synthesizer.generate(200000, words);
+        synthesizer.finish(words);
+
+        const std::size_t laneCount = 3;
+        const std::size_t chunkWords = 2000;
+        fastic::multiRx receiver(laneCount, 2, 256, 2);
+        std::vector<std::unique_ptr<aurora::rx>> references;
+        for(std::size_t lane = 0; lane < laneCount; lane++) references.push_back(std::make_unique<aurora::rx>(nullptr, 0));
+        std::vector<std::size_t> offsets(laneCount, 0);
+
+        for(std::size_t round = 0; round < 200; round++){
+            std::size_t lane = round % laneCount;
+            std::size_t size = std::min(chunkWords, words.size() - offsets[lane]);
+            const std::uint32_t * chunk = words.data() + offsets[lane];
+            offsets[lane] += size;
+
+            std::vector<std::uint64_t> expected;
+            references[lane]->feedPayloads(chunk, size, [&expected](const std::uint64_t * payloads, std::size_t count){
+                for(std::size_t idx = 0; idx < count; idx++) expected.push_back(eventWord(fastic::eventPacket{aurora::dataPacket(payloads[idx])}));
+            }, [](const aurora::controlPacket &){});
+
+            //Long enough for the worker to spin out and park
+            std::this_thread::sleep_for(std::chrono::microseconds(round % 2 ? 2000 : 50));
+            std::uint64_t completed = receiver.getCompletedBuffers(lane);
+            CHECK(receiver.submit(lane, chunk, size));
+
+            //The event queue is smaller than the chunk, every drain has to wake the worker for the rest
+            std::vector<std::uint64_t> received;
+            steadyClock::time_point deadline = steadyClock::now() + std::chrono::seconds(10);
+            while((received.size() < expected.size() || receiver.getCompletedBuffers(lane) == completed) && steadyClock::now() < deadline){
+                receiver.drain(lane, [&received](fastic::eventPacket & event){ received.push_back(eventWord(event)); });
+                if(round % 3 == 0) std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+            CHECK(received == expected);
+            CHECK(receiver.getCompletedBuffers(lane) == completed + 1);
+            if(received != expected) break;
+        }
+    }
+}
+
+int main(){
+    testLanes(5, 2);
+    testLanes(3, 8);
+    testWakeups();
+
+    return test::checkResult();
+}
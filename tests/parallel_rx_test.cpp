@@ -0,0 +1,122 @@
+/*
+    Parallel decoder against a single receiver
+
+    parallelRx decodes a capture into exactly the packets and counters of one rx fed the
+    same chunks in order, also when relocks and losses of sync fall near the chunk
+    boundaries. A sink throwing halfway through leaves the decoder usable.
+*/
+
+#include <cstdint>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include "aurora.hpp"
+#include "parallel_rx.hpp"
+#include "capture.hpp"
+#include "check.hpp"
+
+namespace{
+    struct decodedFrame {
+        decltype(aurora::packet::type) type;
+        std::uint64_t data;
+
+        bool operator==(const decodedFrame & other) const{
+            return type == other.type && data == other.data;
+        }
+    };
+
+    std::vector<std::uint32_t> makeCapture(int scenario){
+        fastic::captureSynthesizer::config config;
+        config.bitSlip = (scenario * 17) % 66;
+        config.seed = scenario + 1;
+        config.statisticsInterval = 100;
+        config.headerErrorRate = scenario >= 1 ? 0.002 : 0.0;
+        config.bitErrorRate = scenario >= 2 ? 2e-5 : 0.0;
+        config.idleRate = scenario == 3 ? 0.1 : 0.0;
+
+        fastic::captureSynthesizer synthesizer(config);
+        std::vector<std::uint32_t> words;
+        synthesizer.generate(200000, words);
+        synthesizer.finish(words);
+
+        if(scenario == 3){
+            //A garbage start, a dead link and a stuck one force new synchronizations and relocks
+            std::fill(words.begin(), words.begin() + 50, 0);
+            std::fill(words.begin() + 20000, words.begin() + 20400, 0);
+            std::fill(words.begin() + 70000, words.begin() + 72000, 0xFFFFFFFF);
+        }
+        return words;
+    }
+
+    void testCapture(const std::vector<std::uint32_t> & words, std::size_t chunkWords, std::size_t workers){
+        std::vector<decodedFrame> expected, decoded;
+
+        aurora::rx receiver(nullptr, 0);
+        for(std::size_t offset = 0; offset < words.size(); offset += chunkWords){
+            receiver.feed(words.data() + offset, std::min(chunkWords, words.size() - offset), [&expected](const aurora::packet & packet){
+                expected.push_back({packet.type, packet.data});
+            });
+        }
+
+        aurora::parallelRx decoder(workers, chunkWords);
+        decoder.decode(words.data(), words.size(), [&decoded](const aurora::packet & packet){
+            decoded.push_back({packet.type, packet.data});
+        });
+
+        CHECK(decoded == expected);
+        CHECK(decoder.isSynchronized() == receiver.isSynchronized());
+
+        const aurora::rxMetrics & single = receiver.getMetrics();
+        const aurora::rxMetrics & parallel = decoder.getMetrics();
+        CHECK(parallel.getFrames() == single.getFrames());
+        CHECK(parallel.getHeaderErrors() == single.getHeaderErrors());
+        CHECK(parallel.getRelocks() == single.getRelocks());
+        CHECK(parallel.getSyncAttempts() == single.getSyncAttempts());
+        CHECK(parallel.getSyncFailures() == single.getSyncFailures());
+
+        //The payload path gives the same data and control frames
+        std::size_t dataFrames = 0, controlFrames = 0;
+        decoder.decodePayloads(words.data(), words.size(), [&dataFrames](const std::uint64_t *, std::size_t count){ dataFrames += count; },
+                                                           [&controlFrames](const aurora::controlPacket &){ controlFrames++; });
+        CHECK(dataFrames == (std::size_t)std::count_if(expected.begin(), expected.end(), [](const decodedFrame & frame){ return frame.type == aurora::packet::type::data; }));
+        CHECK(controlFrames == (std::size_t)std::count_if(expected.begin(), expected.end(), [](const decodedFrame & frame){ return frame.type == aurora::packet::type::control; }));
+    }
+
+    void testThrowingSink(const std::vector<std::uint32_t> & words){
+        aurora::parallelRx decoder(3, 1000);
+
+        for(int pass = 0; pass < 3; pass++){
+            std::size_t frames = 0;
+            bool thrown = false;
+            try{
+                decoder.decodePayloads(words.data(), words.size(), [&frames](const std::uint64_t *, std::size_t count){
+                    frames += count;
+                    if(frames > 5000) throw std::runtime_error("sink failed");
+                }, [](const aurora::controlPacket &){});
+            }catch(const std::runtime_error &){
+                thrown = true;
+            }
+            CHECK(thrown);
+
+            //The next capture is decoded completely
+            std::size_t decoded = 0;
+            decoder.decodePayloads(words.data(), words.size(), [&decoded](const std::uint64_t *, std::size_t count){ decoded += count; },
+                                                               [](const aurora::controlPacket &){});
+            CHECK(decoded > 5000);
+        }
+    }
+}
+
+int main(){
+    for(int scenario = 0; scenario < 4; scenario++){
+        std::vector<std::uint32_t> words = makeCapture(scenario);
+
+        for(std::size_t chunkWords : {64, 1000, 65536}){
+            for(std::size_t workers : {1, 3}) testCapture(words, chunkWords, workers);
+        }
+    }
+
+    testThrowingSink(makeCapture(0));
+
+    return test::checkResult();
+}
@@ -0,0 +1,26 @@
+#ifndef TESTS_REFERENCE_H
+#define TESTS_REFERENCE_H
+
+#include <cstdint>
+
+/*
+    Straightforward implementations the optimized code is checked against
+*/
+
+namespace reference{
+
+    /// @brief Bit-serial descrambler of the x^58 + x^39 + 1 polynomial, the one rx used before the word-parallel version
+    /// @param currentData Scrambled payload, replaced by the descrambled one
+    /// @param previousData Scrambled payload preceding it
+    inline void descramblePacketData(std::uint64_t & currentData, std::uint64_t previousData){
+        for(int i = 63; i >= 0; i--){
+            // Shift back the new bit to the previous buffer
+            previousData = (previousData << 1) | ((currentData >> i) & 1);
+            // Clean out a bit in the current data buffer and replace it with the descrambled one
+            currentData = (currentData & ~((std::uint64_t)1 << i)) |
+                          ((std::uint64_t)(((previousData >> 0) & 1) ^ ((previousData >> 39) & 1) ^ ((previousData >> 58) & 1)) << i);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*
+    Streaming decoder against the whole buffer decode
+
+    A capture fed to rx::feed in chunks of any size gives the packets processRxBuffer
+    decodes from the whole capture at once, and the payloads the synthesizer sent.
+*/
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "aurora.hpp"
+#include "capture.hpp"
+#include "check.hpp"
+
+namespace{
+    struct decodedFrame {
+        decltype(aurora::packet::type) type;
+        std::uint64_t data;
+
+        bool operator==(const decodedFrame & other) const{
+            return type == other.type && data == other.data;
+        }
+    };
+
+    std::vector<decodedFrame> feedInChunks(const std::vector<std::uint32_t> & words, std::size_t chunkWords){
+        aurora::rx receiver(nullptr, 0);
+        std::vector<decodedFrame> frames;
+
+        for(std::size_t offset = 0; offset < words.size(); offset += chunkWords){
+            receiver.feed(words.data() + offset, std::min(chunkWords, words.size() - offset), [&frames](const aurora::packet & packet){
+                frames.push_back({packet.type, packet.data});
+            });
+        }
+
+        CHECK(receiver.isSynchronized());
+        return frames;
+    }
+
+    void testBitSlip(std::uint8_t bitSlip){
+        fastic::captureSynthesizer::config config;
+        config.bitSlip = bitSlip;
+        config.seed = bitSlip + 1;
+        config.statisticsInterval = 100;
+
+        fastic::captureSynthesizer synthesizer(config);
+        std::vector<std::uint32_t> words;
+        std::vector<std::uint64_t> payloads;
+        synthesizer.generate(20000, words, &payloads);
+        synthesizer.finish(words);
+
+        aurora::rx whole(words.data(), words.size());
+        CHECK(whole.synchronize());
+        CHECK(whole.getBitSlip() == bitSlip);
+        whole.processRxBuffer();
+
+        std::vector<decodedFrame> expected;
+        for(const aurora::packet & packet : whole.getPacketBuffer()) expected.push_back({packet.type, packet.data});
+
+        //The first frame only seeds the descrambler
+        CHECK(expected.size() + 1 == payloads.size());
+        for(std::size_t idx = 0; idx < expected.size() && idx + 1 < payloads.size(); idx++){
+            CHECK(expected[idx].data == payloads[idx + 1]);
+        }
+
+        //Chunks shorter than the sync sample, around it and longer than the capture
+        for(std::size_t chunkWords : {1, 2, 3, 12, 33, 135, 136, 1000, 1 << 20}){
+            CHECK(feedInChunks(words, chunkWords) == expected);
+        }
+    }
+}
+
+int main(){
+    for(std::uint8_t bitSlip : {0, 1, 23, 31, 32, 64, 65}) testBitSlip(bitSlip);
+
+    return test::checkResult();
+}
@@ -0,0 +1,145 @@
+/*
+    Stream reader against the input
+
+    Files of awkward sizes and pipes fed in random pieces are read byte for byte, with
+    io_uring and with blocking reads, at several queue depths and with a consumer holding
+    on to its buffers. A consumer holding every buffer while other threads return them late
+    puts the reader to sleep until the release. Every buffer goes back to the pool.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <deque>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
+#include "stream_reader.hpp"
+#include "buffer_pool.hpp"
+#include "check.hpp"
+
+namespace{
+    const char * filePath = "stream_reader_test.bin";
+
+    enum class input{
+        file,
+        pipe
+    };
+
+    //Read the whole input, the consumer keeps up to heldBuffers buffers before returning the oldest one
+    std::vector<std::uint8_t> readAll(aurora::streamReader & reader, aurora::bufferPool & pool, std::size_t heldBuffers){
+        std::vector<std::uint8_t> data;
+        std::deque<std::size_t> held;
+        std::size_t index, words;
+
+        while(reader.next(index, words)){
+            const std::uint8_t * buffer = pool.getBuffer<std::uint8_t>(index);
+            data.insert(data.end(), buffer, buffer + words * sizeof(std::uint32_t));
+
+            held.push_back(index);
+            if(held.size() > heldBuffers){
+                pool.release(held.front());
+                held.pop_front();
+            }
+        }
+
+        for(std::size_t buffer : held) pool.release(buffer);
+        return data;
+    }
+
+    void testRead(const std::vector<std::uint8_t> & data, aurora::streamReader::backend backend, input source, std::size_t depth, std::size_t bufferCount, std::size_t heldBuffers){
+        aurora::bufferPool pool(bufferCount, 4096, false);
+        aurora::streamReader reader(pool, depth, backend);
+        std::thread writer;
+        int pipeFds[2] = {-1, -1};
+
+        if(source == input::pipe){
+            CHECK(pipe(pipeFds) == 0);
+            writer = std::thread([&data, &pipeFds]{
+                //Pieces of random sizes, most of them ending inside a word
+                std::mt19937 random(data.size());
+                for(std::size_t offset = 0; offset < data.size();){
+                    ssize_t written = write(pipeFds[1], data.data() + offset, std::min<std::size_t>(1 + random() % 9000, data.size() - offset));
+                    if(written > 0) offset += written;
+                }
+                close(pipeFds[1]);
+            });
+            CHECK(reader.open(pipeFds[0]));
+        }else{
+            CHECK(reader.open(filePath));
+        }
+
+        std::vector<std::uint8_t> read = readAll(reader, pool, heldBuffers);
+
+        if(writer.joinable()) writer.join();
+        if(pipeFds[0] >= 0) close(pipeFds[0]);
+
+        //A trailing partial word is dropped
+        std::size_t expected = data.size() / sizeof(std::uint32_t) * sizeof(std::uint32_t);
+        CHECK(read.size() == expected);
+        CHECK(std::memcmp(read.data(), data.data(), std::min(read.size(), expected)) == 0);
+        CHECK(reader.getError() == 0);
+
+        reader.close();
+        CHECK(pool.getFreeCount() == bufferCount);
+    }
+
+    void testStall(const std::vector<std::uint8_t> & data, aurora::streamReader::backend backend){
+        //Every buffer is passed to a thread returning it a little later, the reader waits with none left
+        aurora::bufferPool pool(2, 4096, false);
+        aurora::streamReader reader(pool, 2, backend);
+        CHECK(reader.open(filePath));
+
+        std::vector<std::uint8_t> read;
+        std::vector<std::thread> releasers;
+        std::size_t index, words;
+        while(reader.next(index, words)){
+            const std::uint8_t * buffer = pool.getBuffer<std::uint8_t>(index);
+            read.insert(read.end(), buffer, buffer + words * sizeof(std::uint32_t));
+
+            releasers.emplace_back([&pool, index]{
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                pool.release(index);
+            });
+        }
+        for(std::thread & releaser : releasers) releaser.join();
+
+        CHECK(read.size() == data.size() / sizeof(std::uint32_t) * sizeof(std::uint32_t));
+        CHECK(std::memcmp(read.data(), data.data(), read.size()) == 0);
+        CHECK(reader.getError() == 0);
+        CHECK(reader.getStalls() > 0);
+
+        reader.close();
+        CHECK(pool.getFreeCount() == 2);
+    }
+}
+
+int main(){
+    std::mt19937_64 random(3);
+
+    for(std::size_t size : {0, 3, 4, 4096, 4099, 100000, 1000003}){
+        std::vector<std::uint8_t> data(size);
+        for(std::uint8_t & byte : data) byte = random();
+
+        FILE * file = std::fopen(filePath, "wb");
+        CHECK(file && std::fwrite(data.data(), 1, size, file) == size);
+        if(file) std::fclose(file);
+
+        for(aurora::streamReader::backend backend : {aurora::streamReader::backend::ioUring, aurora::streamReader::backend::blocking}){
+            for(input source : {input::file, input::pipe}){
+                for(std::size_t depth : {1, 3, 8}){
+                    testRead(data, backend, source, depth, 16, 0);
+                    //The consumer holds every buffer but one, the reader has to wait for it
+                    testRead(data, backend, source, depth, 4, 3);
+                }
+            }
+            if(size > 4 * 4096) testStall(data, backend);
+        }
+    }
+
+    std::remove(filePath);
+
+    return test::checkResult();
+}
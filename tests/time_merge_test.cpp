@@ -0,0 +1,152 @@
+/*
+    Merge of the lanes against a sort of all their events
+
+    Lanes with events jittered by less than the reorder window come out of timeMerger in
+    time order, none lost, whatever the emit points. An event behind the emitted stream is
+    counted as late and dropped, an idle lane holds the merge back until it is advanced.
+*/
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "time_merge.hpp"
+#include "check.hpp"
+
+namespace{
+    struct randomSource {
+        std::uint64_t state = 0x9E3779B97F4A7C15;
+
+        std::uint64_t next(std::uint64_t range){
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state % range;
+        }
+    };
+
+    bool earlier(const fastic::timedEvent & first, const fastic::timedEvent & second){
+        if(first.timestamp != second.timestamp) return first.timestamp < second.timestamp;
+        return first.rawData < second.rawData;
+    }
+
+    //Events of the lanes interleaved in arrival order, each lane jittered around the same rate
+    std::vector<fastic::timedEvent> makeArrivals(std::size_t laneCount, std::size_t eventsPerLane, std::uint64_t jitter, randomSource & random){
+        std::vector<fastic::timedEvent> arrivals;
+        for(std::size_t lane = 0; lane < laneCount; lane++){
+            std::uint64_t time = 1000;
+            for(std::size_t idx = 0; idx < eventsPerLane; idx++){
+                time += 1 + random.next(100);
+                std::uint64_t timestamp = time + jitter - random.next(jitter + 1);
+                arrivals.push_back({timestamp, arrivals.size(), (std::uint16_t)lane});
+            }
+        }
+
+        //The lanes arrive interleaved at random, each in its own order
+        std::vector<fastic::timedEvent> interleaved;
+        std::vector<std::size_t> next(laneCount, 0);
+        while(interleaved.size() < arrivals.size()){
+            std::size_t lane = random.next(laneCount);
+            if(next[lane] == eventsPerLane) continue;
+            interleaved.push_back(arrivals[lane * eventsPerLane + next[lane]]);
+            next[lane]++;
+        }
+        return interleaved;
+    }
+}
+
+int main(){
+    randomSource random;
+
+    //Ordering: every event comes out once, in time order, whatever the emit points
+    for(std::size_t emitEvery : {1, 7, 100, 100000}){
+        const std::size_t laneCount = 5;
+        const std::uint64_t reorderWindow = 4000;
+        std::vector<fastic::timedEvent> arrivals = makeArrivals(laneCount, 3000, 500, random);
+
+        fastic::timeMerger merger(laneCount, reorderWindow);
+        std::vector<fastic::timedEvent> merged;
+        auto sink = [&merged](const fastic::timedEvent & event){ merged.push_back(event); };
+
+        std::size_t emitted = 0;
+        for(std::size_t idx = 0; idx < arrivals.size(); idx++){
+            CHECK(merger.push(arrivals[idx]));
+            if(idx % emitEvery == 0) emitted += merger.emit(sink);
+        }
+        emitted += merger.flush(sink);
+
+        CHECK(emitted == arrivals.size());
+        CHECK(merged.size() == arrivals.size());
+        CHECK(merger.getPendingEvents() == 0);
+        CHECK(merger.getLateEvents() == 0);
+        CHECK(std::is_sorted(merged.begin(), merged.end(), [](const fastic::timedEvent & first, const fastic::timedEvent & second){ return first.timestamp < second.timestamp; }));
+
+        std::sort(arrivals.begin(), arrivals.end(), earlier);
+        std::sort(merged.begin(), merged.end(), earlier);
+        bool same = true;
+        for(std::size_t idx = 0; idx < merged.size() && idx < arrivals.size(); idx++){
+            same = same && merged[idx].timestamp == arrivals[idx].timestamp && merged[idx].rawData == arrivals[idx].rawData && merged[idx].lane == arrivals[idx].lane;
+        }
+        CHECK(same);
+    }
+
+    //Late events: behind the emitted stream they are counted and dropped, at its edge they are still merged
+    {
+        fastic::timeMerger merger(2, 100);
+        std::vector<fastic::timedEvent> merged;
+        auto sink = [&merged](const fastic::timedEvent & event){ merged.push_back(event); };
+
+        CHECK(merger.push({1000, 0, 0}));
+        CHECK(merger.push({1050, 1, 1}));
+        CHECK(merger.push({1200, 2, 0}));
+        CHECK(merger.push({1300, 3, 1}));
+        //Horizons 1100 and 1200, so the events up to 1100 can no longer be overtaken
+        CHECK(merger.emit(sink) == 2);
+        CHECK(merger.getPendingEvents() == 2);
+
+        CHECK(merger.push({1049, 4, 0}));
+        CHECK(merger.push({999, 5, 1}));
+        CHECK(merger.push({1050, 6, 1}));
+        CHECK(merger.getLateEvents() == 2);
+        CHECK(merger.getPendingEvents() == 3);
+
+        CHECK(merger.flush(sink) == 3);
+        CHECK(merged.size() == 5);
+        CHECK(merged[2].rawData == 6 && merged[3].rawData == 2 && merged[4].rawData == 3);
+    }
+
+    //Idle lanes: the merge waits for a lane without events until it is advanced
+    {
+        fastic::timeMerger merger(3, 10);
+        std::size_t emitted = 0;
+        auto sink = [&emitted](const fastic::timedEvent &){ emitted++; };
+
+        CHECK(merger.push({100, 0, 0}));
+        CHECK(merger.push({200, 1, 0}));
+        CHECK(merger.push({300, 2, 1}));
+        CHECK(merger.emit(sink) == 0);
+
+        //Horizons 190, 290 and 140
+        merger.advance(2, 150);
+        CHECK(merger.emit(sink) == 1);
+        //Horizons 190, 290 and 990, the event at 200 may still be overtaken on its own lane
+        merger.advance(2, 1000);
+        CHECK(merger.emit(sink) == 0);
+        //Horizons 390, 290 and 990
+        CHECK(merger.push({400, 3, 0}));
+        CHECK(merger.emit(sink) == 1);
+        CHECK(emitted == 2);
+        CHECK(merger.getPendingEvents() == 2);
+    }
+
+    //Lane bounds: an unknown lane is refused, a full lane asks for an emit first
+    {
+        fastic::timeMerger merger(1, 10, 4);
+        CHECK(!merger.push({100, 0, 1}));
+        for(std::uint64_t idx = 0; idx < 4; idx++) CHECK(merger.push({100 + idx, idx, 0}));
+        CHECK(!merger.push({200, 4, 0}));
+        CHECK(merger.flush([](const fastic::timedEvent &){}) == 4);
+        CHECK(merger.push({200, 4, 0}));
+    }
+
+    return test::checkResult();
+}
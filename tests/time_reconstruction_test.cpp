@@ -0,0 +1,145 @@
+/*
+    Time reconstruction against the known global times
+
+    A lane is synthesized from a 64bit truth time: events with their 22 bit ToA, extension
+    packets with the 24 bit coarse counter of the chip, idle gaps long enough for the coarse
+    counter to wrap, counter resets, dropped extension packets, lost event packets and a few
+    late events. Every event has to come back at its truth time.
+*/
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "fastic.hpp"
+#include "time_reconstruction.hpp"
+#include "check.hpp"
+
+namespace{
+    constexpr std::uint64_t toaPeriod = (std::uint64_t)1 << 22;
+
+    struct randomSource {
+        std::uint64_t state = 0x9E3779B97F4A7C15;
+
+        std::uint64_t next(std::uint64_t range){
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state % range;
+        }
+    };
+
+    //The chip side of the lane, its counters restart from zero at a reset
+    struct chip {
+        std::uint64_t offset = 0;           //Truth time of the last counter reset, a whole number of ToA periods
+        std::uint32_t packetCount = 0;
+
+        fastic::extensionPacket extension(std::uint64_t time, bool reset = false) const{
+            return fastic::extensionPacket(packetCount, (std::uint32_t)((time - offset) >> 22), reset);
+        }
+    };
+}
+
+int main(){
+    randomSource random;
+    fastic::timeReconstructor reconstructor;
+    chip lane;
+
+    std::uint64_t time = 12345;
+    std::uint64_t latestTime = 0;
+    std::uint64_t anchorTime = 0;           //Center of the window an extension packet left, late events only come past it
+    std::uint64_t expectedOutOfOrder = 0;
+    std::uint64_t lostEvents = 0;
+    std::uint64_t receivedExtensions = 0;
+    std::uint32_t lastCoarseCounter = 0;
+    std::uint32_t coarseWraps = 0;
+    std::uint32_t resets = 0;
+    std::size_t wrongTimestamps = 0;
+    bool previousLost = false;
+
+    auto sendExtension = [&](bool reset){
+        fastic::extensionPacket packet = lane.extension(time, reset);
+        coarseWraps += !reset && packet.getCoarseCounter() < lastCoarseCounter;
+        lastCoarseCounter = packet.getCoarseCounter();
+        anchorTime = (time & ~(toaPeriod - 1)) + toaPeriod / 2;
+
+        reconstructor.extension(packet);
+        receivedExtensions++;
+    };
+
+    sendExtension(false);
+
+    for(std::size_t event = 0; event < 40000; event++){
+        //Gaps stay below an eighth of the ToA period, so even across a lost event the ToA wraps can be followed
+        time += 1 + random.next(toaPeriod / 8);
+
+        if(event % 200 == 199){
+            std::uint64_t kind = random.next(8);
+            if(kind < 2){
+                //An idle gap of millions of ToA periods, only the extension packet can place the next event
+                time += (toaPeriod << 22) + (random.next((std::uint64_t)1 << 22) << 22);
+                sendExtension(false);
+            }else if(kind < 5){
+                //The extension packet is lost, the ToA wraps are followed from the events alone
+            }else{
+                sendExtension(false);
+            }
+
+            if(event % 8000 == 7999){
+                //The counters restart right after a received extension packet, the time base goes on from its coarse time
+                if(kind >= 2 && kind < 5) sendExtension(false);
+                lane.offset = time & ~(toaPeriod - 1);
+                lane.packetCount = 0;
+                sendExtension(true);
+                resets++;
+            }
+            previousLost = false;
+        }else if(!previousLost && random.next(64) == 0){
+            //The event packet is sent but never received
+            lane.packetCount++;
+            lostEvents++;
+            previousLost = true;
+            continue;
+        }
+
+        std::uint64_t eventTime = time;
+        if(event % 200 != 199 && latestTime > anchorTime && random.next(100) == 0){
+            //A late event, behind the latest one by less than the gaps
+            eventTime = latestTime - random.next(toaPeriod / 8);
+        }
+
+        lane.packetCount++;
+        previousLost = false;
+
+        expectedOutOfOrder += eventTime < latestTime;
+        latestTime = std::max(latestTime, eventTime);
+        wrongTimestamps += reconstructor.extend((std::uint32_t)(eventTime & (toaPeriod - 1))) != eventTime;
+    }
+
+    CHECK(wrongTimestamps == 0);
+    CHECK(expectedOutOfOrder > 0);
+    CHECK(reconstructor.getOutOfOrderEvents() == expectedOutOfOrder);
+    CHECK(reconstructor.getLostPackets() == lostEvents);
+    CHECK(reconstructor.getExtensionCount() == receivedExtensions);
+    CHECK(reconstructor.getResetCount() == resets);
+    //The idle gaps made the 24 bit coarse counter wrap several times
+    CHECK(coarseWraps >= 2);
+    CHECK(resets >= 2);
+
+    //The column overload gives the timestamps of the single event calls
+    fastic::timeReconstructor single;
+    fastic::timeReconstructor column;
+    std::vector<std::uint32_t> timestamps(5000);
+    std::vector<std::uint64_t> globalTimestamps(timestamps.size());
+    time = 0;
+    for(std::uint32_t & timestamp : timestamps){
+        time += random.next(toaPeriod / 4);
+        timestamp = (std::uint32_t)(time & (toaPeriod - 1));
+    }
+    column.extend(timestamps.data(), globalTimestamps.data(), timestamps.size());
+    for(std::size_t idx = 0; idx < timestamps.size(); idx++){
+        CHECK(single.extend(timestamps[idx]) == globalTimestamps[idx]);
+    }
+    CHECK(globalTimestamps.back() == time);
+
+    return test::checkResult();
+}
@@ -0,0 +1,67 @@
+/*
+    Transmitter against the receiver
+
+    Payloads framed by tx in chunks of any size at any bitslip are decoded by rx::feed into
+    the same payloads with the same kind of sync header.
+*/
+
+#include <cstdint>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "aurora.hpp"
+#include "tx.hpp"
+#include "check.hpp"
+
+namespace{
+    void testRoundTrip(std::uint8_t bitSlip, std::size_t chunkFrames, std::mt19937_64 & random){
+        const std::size_t frames = 5000;
+        std::vector<std::uint64_t> payloads(frames);
+        std::vector<std::uint8_t> syncBits(frames);
+
+        for(std::size_t idx = 0; idx < frames; idx++){
+            payloads[idx] = random();
+            //Some control frames and a few invalid headers, not enough to lose the lock
+            syncBits[idx] = idx % 37 == 5 ? aurora::tx::controlHeader : (idx % 1001 == 500 ? 0b11 : aurora::tx::dataHeader);
+        }
+
+        aurora::tx transmitter(bitSlip, random());
+        std::vector<std::uint32_t> words(aurora::tx::getMaxWords(frames));
+        std::size_t written = 0;
+        for(std::size_t idx = 0; idx < frames; idx += chunkFrames){
+            written += transmitter.encode(payloads.data() + idx, syncBits.data() + idx, std::min(chunkFrames, frames - idx), words.data() + written);
+        }
+        written += transmitter.finish(words.data() + written);
+
+        CHECK(written <= words.size());
+        CHECK(written == (frames * 66 + bitSlip + 31) / 32);
+        CHECK(transmitter.getFrameCount() == frames);
+
+        aurora::rx receiver(nullptr, 0);
+        std::vector<aurora::packet> packets;
+        receiver.feed(words.data(), written, [&packets](const aurora::packet & packet){ packets.push_back(packet); });
+
+        CHECK(receiver.isSynchronized());
+        CHECK(receiver.getBitSlip() == bitSlip);
+
+        //The first frame only seeds the descrambler
+        CHECK(packets.size() + 1 == frames);
+        for(std::size_t idx = 0; idx < packets.size() && idx + 1 < frames; idx++){
+            std::uint8_t sent = syncBits[idx + 1];
+            auto expected = sent == aurora::tx::dataHeader ? aurora::packet::type::data
+                                          : (sent == aurora::tx::controlHeader ? aurora::packet::type::control : aurora::packet::type::error);
+            CHECK(packets[idx].type == expected);
+            CHECK(packets[idx].data == payloads[idx + 1]);
+        }
+    }
+}
+
+int main(){
+    std::mt19937_64 random(1);
+
+    for(int bitSlip = 0; bitSlip < 66; bitSlip++){
+        for(std::size_t chunkFrames : {1, 3, 17, 5000}) testRoundTrip(bitSlip, chunkFrames, random);
+    }
+
+    return test::checkResult();
+}
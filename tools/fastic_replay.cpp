@@ -0,0 +1,339 @@
+/*
+    Replay of raw Aurora captures through the receiver
+
+    Memory maps a raw capture (or synthesizes one, or reads it through aurora::streamReader),
+    feeds it to aurora::rx in chunks at full speed and reports the throughput together with
+    the packet and error counts.
+
+    Usage: fastic_replay [options] [capture]
+        --synth FRAMES          Synthesize a capture of FRAMES frames instead of reading one
+        --slip BITS             Bitslip of the synthesized capture (0 - 65)
+        --header-errors RATE    Probability of a corrupted sync header per synthesized frame
+        --bit-errors RATE       Probability of a flipped bit of the synthesized stream
+        --idle RATE             Probability of an idle block in place of a synthesized event
+        --stats EVENTS          Synthesize a statistics packet every EVENTS events
+        --seed SEED             Seed of the synthesizer
+        --save PATH             Store the synthesized capture
+        --chunk WORDS           Size of the chunks passed to the receiver (default 65536)
+        --repeat COUNT          Number of replays of the capture (default 1)
+        --fused                 Decode straight into payloads (feedPayloads) instead of packets
+        --channels MASK         Keep only the events of the channels in MASK (bit 8 is the trigger)
+        --types MASK            Keep only the events of the types in MASK
+        --tot MIN:MAX           Keep only the events with the pulse width in MIN - MAX
+        --parity POLICY         Parity policy of the filter: accept, reject or invalid (keep only the invalid ones)
+        --reject-debug          Drop the events with the debug flag set
+        --histogram             Histogram the pulse width and fine ToA of the kept events per channel
+        --stream DEPTH          Read the capture with DEPTH reads in flight (io_uring) into chunk sized buffers instead of mapping it
+        --threads COUNT         Decode the chunks of a mapped or synthesized capture by COUNT threads (aurora::parallelRx), the output
+                                is that of a single replay fed in chunks, so it does not combine with --stream or --repeat
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include "aurora.hpp"
+#include "fastic.hpp"
+#include "decoder_metrics.hpp"
+#include "event_batch.hpp"
+#include "capture.hpp"
+#include "chip_health.hpp"
+#include "event_filter.hpp"
+#include "histogram.hpp"
+#include "stream_reader.hpp"
+#include "parallel_rx.hpp"
+
+namespace{
+    struct replayCounters {
+        std::uint64_t dataPackets = 0;
+        std::uint64_t controlPackets = 0;
+        std::uint64_t errorFrames = 0;
+        std::uint64_t extensionPackets = 0;
+        fastic::decoderMetrics::parityCounts parity;
+    };
+
+    void printUsage(const char * name){
+        std::fprintf(stderr, "Usage: %s [--synth FRAMES] [--slip BITS] [--header-errors RATE] [--bit-errors RATE] [--idle RATE] "
+                             "[--stats EVENTS] [--seed SEED] [--save PATH] [--chunk WORDS] [--repeat COUNT] [--fused] "
+                             "[--channels MASK] [--types MASK] [--tot MIN:MAX] [--parity accept|reject|invalid] [--reject-debug] [--histogram] [--stream DEPTH] [--threads COUNT] [capture]\n", name);
+    }
+}
+
+int main(int argc, char ** argv){
+    fastic::captureSynthesizer::config config;
+    fastic::eventFilter::config filterConfig;
+    std::size_t synthFrames = 0;
+    std::size_t chunkWords = 65536;
+    std::size_t repeat = 1;
+    std::size_t streamDepth = 0;
+    std::size_t threads = 0;
+    bool fused = false;
+    bool histogram = false;
+    std::string capturePath, savePath;
+
+    for(int idx = 1; idx < argc; idx++){
+        std::string option = argv[idx];
+        bool hasValue = idx + 1 < argc;
+
+        if(option == "--synth" && hasValue) synthFrames = std::strtoull(argv[++idx], nullptr, 0);
+        else if(option == "--slip" && hasValue) config.bitSlip = std::strtoul(argv[++idx], nullptr, 0) % 66;
+        else if(option == "--header-errors" && hasValue) config.headerErrorRate = std::strtod(argv[++idx], nullptr);
+        else if(option == "--bit-errors" && hasValue) config.bitErrorRate = std::strtod(argv[++idx], nullptr);
+        else if(option == "--idle" && hasValue) config.idleRate = std::strtod(argv[++idx], nullptr);
+        else if(option == "--stats" && hasValue) config.statisticsInterval = std::strtoul(argv[++idx], nullptr, 0);
+        else if(option == "--seed" && hasValue) config.seed = std::strtoull(argv[++idx], nullptr, 0);
+        else if(option == "--save" && hasValue) savePath = argv[++idx];
+        else if(option == "--chunk" && hasValue) chunkWords = std::max<std::size_t>(1, std::strtoull(argv[++idx], nullptr, 0));
+        else if(option == "--repeat" && hasValue) repeat = std::max<std::size_t>(1, std::strtoull(argv[++idx], nullptr, 0));
+        else if(option == "--fused") fused = true;
+        else if(option == "--channels" && hasValue) filterConfig.channels = std::strtoul(argv[++idx], nullptr, 0);
+        else if(option == "--types" && hasValue) filterConfig.types = std::strtoul(argv[++idx], nullptr, 0);
+        else if(option == "--tot" && hasValue){
+            char * end;
+            filterConfig.minPulseWidth = std::strtoul(argv[++idx], &end, 0);
+            filterConfig.maxPulseWidth = (*end == ':') ? std::strtoul(end + 1, nullptr, 0) : 0x3FFF;
+        }
+        else if(option == "--parity" && hasValue){
+            std::string policy = argv[++idx];
+            if(policy == "accept") filterConfig.parity = fastic::eventFilter::parityPolicy::accept;
+            else if(policy == "reject") filterConfig.parity = fastic::eventFilter::parityPolicy::rejectInvalid;
+            else if(policy == "invalid") filterConfig.parity = fastic::eventFilter::parityPolicy::keepInvalid;
+            else{
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if(option == "--reject-debug") filterConfig.rejectDebug = true;
+        else if(option == "--histogram") histogram = true;
+        else if(option == "--threads" && hasValue) threads = std::max<std::size_t>(1, std::strtoull(argv[++idx], nullptr, 0));
+        else if(option == "--stream" && hasValue) streamDepth = std::max<std::size_t>(1, std::strtoull(argv[++idx], nullptr, 0));
+        else if(option[0] != '-' && capturePath.empty()) capturePath = option;
+        else{
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    //The parallel decoder needs the whole capture at once and decodes it as one stream
+    if(threads && (streamDepth || repeat > 1)){
+        std::fprintf(stderr, "--threads can not be combined with --stream or --repeat\n");
+        return 1;
+    }
+
+    //Source of the replayed words
+    std::vector<std::uint32_t> synthesized;
+    fastic::captureFile capture;
+    const std::uint32_t * words = nullptr;
+    std::size_t wordCount = 0;
+
+    if(synthFrames){
+        fastic::captureSynthesizer synthesizer(config);
+        synthesizer.generate(synthFrames, synthesized);
+        synthesizer.finish(synthesized);
+
+        std::printf("synthesized %zu frames: %llu events, %llu extension packets, %llu statistics packets, %llu idles, %llu header errors, %llu bit errors\n",
+                    synthFrames, (unsigned long long)synthesizer.getEventCount(), (unsigned long long)synthesizer.getExtensionCount(),
+                    (unsigned long long)synthesizer.getStatisticsCount(),
+                    (unsigned long long)synthesizer.getIdleCount(), (unsigned long long)synthesizer.getHeaderErrors(), (unsigned long long)synthesizer.getBitErrors());
+
+        if(!savePath.empty() && !fastic::captureFile::write(savePath, synthesized.data(), synthesized.size())){
+            std::fprintf(stderr, "Failed to store the capture to %s\n", savePath.c_str());
+            return 1;
+        }
+
+        words = synthesized.data();
+        wordCount = synthesized.size();
+    }else if(!capturePath.empty() && streamDepth){
+        //Read pass by pass below
+    }else if(!capturePath.empty()){
+        if(!capture.open(capturePath)){
+            std::fprintf(stderr, "Failed to map the capture %s\n", capturePath.c_str());
+            return 1;
+        }
+
+        words = capture.data();
+        wordCount = capture.size();
+    }else{
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    aurora::rx receiver(nullptr, 0);
+    replayCounters counters;
+    fastic::chipHealth health;
+    fastic::eventFilter filter(filterConfig);
+    fastic::eventHistograms histograms(histogram ? 1 : 0);
+    std::uint64_t chunkTime = 0;
+
+    auto sink = [&counters, &health, &filter, &histograms, &chunkTime](const aurora::packet & packet){
+        if(packet.type == aurora::packet::type::data){
+            std::uint64_t event = packet.data;
+            if(!filter.apply(&event, 1, &event)) return;
+            if(histograms.getAccumulatorCount()) histograms.getAccumulator(0).add(event);
+            counters.dataPackets++;
+            counters.parity.add(fastic::eventBatch::checkParityFields(packet.data));
+        }else if(packet.type == aurora::packet::type::control){
+            counters.controlPackets++;
+            counters.extensionPackets += aurora::controlPacket(packet).getBlockType() == fastic::extensionPacket::blockType;
+            health.push(aurora::controlPacket(packet), chunkTime);
+        }else{
+            counters.errorFrames++;
+        }
+    };
+
+    auto dataSink = [&counters, &filter, &histograms](const std::uint64_t * payloads, std::size_t count){
+        filter.forward(payloads, count, [&counters, &histograms](const std::uint64_t * events, std::size_t kept){
+            if(histograms.getAccumulatorCount()) histograms.getAccumulator(0).add(events, kept);
+            counters.dataPackets += kept;
+            for(std::size_t idx = 0; idx < kept; idx++) counters.parity.add(fastic::eventBatch::checkParityFields(events[idx]));
+        });
+    };
+
+    auto controlSink = [&counters, &health, &chunkTime](const aurora::controlPacket & control){
+        counters.controlPackets++;
+        counters.extensionPackets += control.getBlockType() == fastic::extensionPacket::blockType;
+        health.push(control, chunkTime);
+    };
+
+    auto decodeChunk = [&](const std::uint32_t * chunk, std::size_t size){
+        chunkTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        if(fused){
+            receiver.feedPayloads(chunk, size, dataSink, controlSink);
+        }else{
+            receiver.feed(chunk, size, sink);
+        }
+    };
+
+    //The reads of the streamed capture run ahead of the decoding in a few chunk sized buffers
+    std::unique_ptr<aurora::bufferPool> pool;
+    std::unique_ptr<aurora::streamReader> reader;
+    if(streamDepth){
+        pool.reset(new aurora::bufferPool(streamDepth + 1, chunkWords * sizeof(std::uint32_t)));
+        reader.reset(new aurora::streamReader(*pool, streamDepth));
+    }
+    std::unique_ptr<aurora::parallelRx> parallel;
+    if(threads) parallel.reset(new aurora::parallelRx(threads, chunkWords));
+    std::size_t replayedWords = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for(std::size_t pass = 0; pass < repeat; pass++){
+        //Every replay is a new stream which has to be synchronized again
+        receiver.resetStream();
+        receiver.synced_ = false;
+        health.reset();
+
+        if(streamDepth){
+            if(!reader->open(capturePath)){
+                std::fprintf(stderr, "Failed to open the capture %s\n", capturePath.c_str());
+                return 1;
+            }
+
+            reader->run([&](std::size_t index, std::size_t size){
+                decodeChunk(pool->getBuffer(index), size);
+                pool->release(index);
+            });
+            if(reader->getError()) std::fprintf(stderr, "Failed to read the capture %s: %s\n", capturePath.c_str(), std::strerror(reader->getError()));
+
+            replayedWords += reader->getBytesRead() / sizeof(std::uint32_t);
+            continue;
+        }
+
+        if(parallel){
+            //The health monitor only gets the time of the whole pass
+            chunkTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            if(fused){
+                parallel->decodePayloads(words, wordCount, dataSink, controlSink);
+            }else{
+                parallel->decode(words, wordCount, sink);
+            }
+            replayedWords += wordCount;
+            continue;
+        }
+
+        for(std::size_t offset = 0; offset < wordCount; offset += chunkWords){
+            decodeChunk(words + offset, std::min(chunkWords, wordCount - offset));
+        }
+        replayedWords += wordCount;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    //The fused path drops the frames with an invalid header, only the receiver counts them
+    const aurora::rxMetrics & metrics = parallel ? parallel->getMetrics() : receiver.getMetrics();
+    if(fused) counters.errorFrames = metrics.getHeaderErrors();
+    double bytes = (double)replayedWords * sizeof(std::uint32_t);
+    std::uint64_t packets = counters.dataPackets + counters.controlPackets;
+
+    std::printf("replayed %.1f MB in %.3f s: %.3f GB/s, %.2f Mpackets/s\n", bytes / 1e6, seconds, bytes / seconds / 1e9, packets / seconds / 1e6);
+    if(streamDepth){
+        const char * backend = reader->getBackend() == aurora::streamReader::backend::ioUring ? (reader->hasRegisteredBuffers() ? "io_uring, registered buffers" : "io_uring") : "blocking reads";
+        std::printf("streamed with %s, queue depth %zu: %llu reads, %llu stalls\n", backend, reader->getQueueDepth(),
+                    (unsigned long long)reader->getReads(), (unsigned long long)reader->getStalls());
+    }
+    std::printf("data packets %llu, control packets %llu (extension %llu), error frames %llu, parity errors %llu, relocks %u, synchronized %s\n",
+                (unsigned long long)counters.dataPackets, (unsigned long long)counters.controlPackets, (unsigned long long)counters.extensionPackets,
+                (unsigned long long)counters.errorFrames, (unsigned long long)counters.parity.invalidEvents, (unsigned)metrics.getRelocks(),
+                (parallel ? parallel->isSynchronized() : receiver.isSynchronized()) ? "yes" : "no");
+    std::printf("parity errors by field: channel %llu, type %llu, timestamp %llu, pulse width %llu, combined %llu\n",
+                (unsigned long long)counters.parity.fields[0], (unsigned long long)counters.parity.fields[1], (unsigned long long)counters.parity.fields[2],
+                (unsigned long long)counters.parity.fields[3], (unsigned long long)counters.parity.fields[4]);
+
+    if(filter.getEvents() != filter.getAccepted()){
+        std::printf("filter kept %llu of %llu events, rejected by channel %llu, type %llu, pulse width %llu, parity %llu, debug %llu\n",
+                    (unsigned long long)filter.getAccepted(), (unsigned long long)filter.getEvents(),
+                    (unsigned long long)filter.getRejects(fastic::eventFilter::criterion::channel), (unsigned long long)filter.getRejects(fastic::eventFilter::criterion::type),
+                    (unsigned long long)filter.getRejects(fastic::eventFilter::criterion::pulseWidth), (unsigned long long)filter.getRejects(fastic::eventFilter::criterion::parity),
+                    (unsigned long long)filter.getRejects(fastic::eventFilter::criterion::debug));
+    }
+
+    const aurora::stageTiming & decode = metrics.getStage(aurora::rxMetrics::stage::decode);
+    const aurora::stageTiming & sync = metrics.getStage(aurora::rxMetrics::stage::sync);
+    std::printf("header error rate %.3g, decode %.2f ns/frame, %llu sync attempts (%llu failed) %.0f ns each\n",
+                metrics.getHeaderErrorRate(), decode.getNanosecondsPerItem(), (unsigned long long)metrics.getSyncAttempts(),
+                (unsigned long long)metrics.getSyncFailures(), sync.getNanosecondsPerItem());
+
+    std::printf("control frames by block type:");
+    for(std::size_t idx = 0; idx < aurora::rxMetrics::blockTypeCount; idx++){
+        std::uint8_t blockType = aurora::rxMetrics::blockTypeOf(idx);
+        std::uint64_t count = metrics.getBlockTypeCount(blockType);
+        if(!count) continue;
+
+        if(idx + 1 < aurora::rxMetrics::blockTypeCount){
+            std::printf(" 0x%02x %llu", blockType, (unsigned long long)count);
+        }else{
+            std::printf(" unknown %llu", (unsigned long long)count);
+        }
+    }
+    std::printf("\n");
+
+    fastic::chipHealth::snapshot chip = health.getSnapshot();
+    std::printf("statistics packets %llu (%llu incomplete halves): fifo drops %llu, pulse width drops %llu, dark count drops %llu, trigger drops %llu, pulse errors %llu\n",
+                (unsigned long long)chip.reports, (unsigned long long)chip.incompletePackets,
+                (unsigned long long)chip.getTotal(fastic::chipHealth::counter::fifoDrop), (unsigned long long)chip.getTotal(fastic::chipHealth::counter::pulseWidthDrop),
+                (unsigned long long)chip.getTotal(fastic::chipHealth::counter::darkCountDrop), (unsigned long long)chip.getTotal(fastic::chipHealth::counter::triggerDrop),
+                (unsigned long long)chip.getTotal(fastic::chipHealth::counter::pulseError));
+
+    if(histogram){
+        fastic::eventHistograms::snapshot histogramSnapshot = histograms.getSnapshot();
+        std::printf("histogrammed %llu events (%llu with an invalid channel)\n", (unsigned long long)histogramSnapshot.events,
+                    (unsigned long long)histogramSnapshot.getInvalidChannelEvents());
+
+        for(std::size_t channel = 0; channel < fastic::eventHistograms::channelCount; channel++){
+            fastic::eventPacket::channel channelId = static_cast<fastic::eventPacket::channel>(channel);
+            std::printf("  channel %zu: %llu events, pulse width peak by type", channel, (unsigned long long)histogramSnapshot.getChannelEvents(channelId));
+
+            for(std::size_t type = 0; type < fastic::eventHistograms::typeCount; type++){
+                const std::uint64_t * bins = histogramSnapshot.getPulseWidth(channelId, static_cast<fastic::eventPacket::type>(type));
+                std::size_t peak = std::max_element(bins, bins + fastic::eventHistograms::pulseWidthBins) - bins;
+                if(bins[peak]) std::printf(" %zu: %zu (%llu)", type, peak, (unsigned long long)bins[peak]);
+            }
+            std::printf("\n");
+        }
+    }
+
+    return 0;
+}